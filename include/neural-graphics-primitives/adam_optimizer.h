@@ -15,6 +15,9 @@
 #pragma once
 
 #include <neural-graphics-primitives/common.h>
+#include <neural-graphics-primitives/thread_pool.h>
+
+#include <vector>
 
 NGP_NAMESPACE_BEGIN
 
@@ -130,4 +133,82 @@ public:
 	} m_hparams;
 };
 
+// Adam over `size()` variables of `dims()` floats each, e.g. the extrinsics of all training cameras. The variables share their
+// hyperparameters and step count and are stored as a structure of arrays, such that one call steps all of them with SIMD.
+// The results are bit-identical to stepping an AdamOptimizer per variable.
+class BatchAdamOptimizer {
+public:
+	BatchAdamOptimizer(uint32_t dims, float learning_rate, float epsilon = 1e-08f, float beta1 = 0.9f, float beta2 = 0.99f)
+	: m_dims{dims}, m_hparams{learning_rate, epsilon, beta1, beta2} {}
+
+	// Appended variables are zero. Existing ones keep their state.
+	void resize(size_t size);
+
+	// `gradients` holds `dims()` consecutive floats per variable (e.g. an array of Eigen::Vector3f). The step uses the gradient
+	// `gradient_scale * gradients[i] + l2_reg * variable(i)`. Large batches are split across `pool` if one is given.
+	void step(const float* gradients, float gradient_scale = 1.0f, float l2_reg = 0.0f, ThreadPool* pool = nullptr);
+
+	void set_learning_rate(float lr) {
+		m_hparams.learning_rate = lr;
+	}
+
+	size_t size() const { return m_size; }
+	uint32_t dims() const { return m_dims; }
+
+	// The `size()` values of component `dim` of all variables.
+	float* variables(uint32_t dim) { return m_variable.data() + dim * m_size; }
+	const float* variables(uint32_t dim) const { return m_variable.data() + dim * m_size; }
+
+	template <typename T>
+	T variable(size_t i) const {
+		T result;
+		for (uint32_t dim = 0; dim < m_dims; ++dim) {
+			result[dim] = variables(dim)[i];
+		}
+		return result;
+	}
+
+	template <typename T>
+	void set_variable(size_t i, const T& value) {
+		for (uint32_t dim = 0; dim < m_dims; ++dim) {
+			variables(dim)[i] = value[dim];
+		}
+	}
+
+protected:
+	// Advances the moments by one step and either subtracts the resulting updates from the variables or, if `updates`
+	// is given, writes them there in the layout of the variables instead.
+	void step_moments(const float* gradients, float gradient_scale, float l2_reg, float actual_learning_rate, float* updates, ThreadPool* pool);
+
+	struct Hyperparameters {
+		float learning_rate;
+		float epsilon;
+		float beta1;
+		float beta2;
+	};
+
+	uint32_t m_dims;
+	size_t m_size = 0;
+	int m_iter = 0;
+	Hyperparameters m_hparams;
+
+	// `dims` arrays of `size` floats each
+	std::vector<float> m_first_moment;
+	std::vector<float> m_second_moment;
+	std::vector<float> m_variable;
+};
+
+// Batched counterpart of RotationAdamOptimizer. The moments are stepped with SIMD. The composition of each
+// variable's rotation with its update is not vectorized but split across the thread pool as well.
+class BatchRotationAdamOptimizer : public BatchAdamOptimizer {
+public:
+	BatchRotationAdamOptimizer(float learning_rate, float epsilon = 1e-08f, float beta1 = 0.9f, float beta2 = 0.99f)
+	: BatchAdamOptimizer{3, learning_rate, epsilon, beta1, beta2} {}
+
+	void step(const float* gradients, float gradient_scale = 1.0f, float l2_reg = 0.0f, ThreadPool* pool = nullptr);
+
+private:
+	std::vector<float> m_updates;
+};
+
 NGP_NAMESPACE_END
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+/** @file   alias_table.h
+ *  @author Thomas Müller, NVIDIA
+ *  @brief  Walker's alias method for drawing from discrete distributions in constant time.
+ *          Construction and sampling are usable from both host and device code.
+ */
+
+#pragma once
+
+#include <neural-graphics-primitives/common.h>
+
+NGP_NAMESPACE_BEGIN
+
+struct AliasEntry {
+	// Probability of keeping this entry rather than switching to `alias`
+	float prob;
+	uint32_t alias;
+	// Probability mass of this entry under the tabulated distribution
+	float pmf;
+};
+
+// Largest float below 1
+static constexpr float ALIAS_ONE_MINUS_EPSILON = 0.99999994f;
+
+// Builds the alias table of the distribution whose probability masses were written to `table[i].pmf` by the caller.
+// The masses must sum to 1 up to rounding. Runs in O(n) without scratch memory, such that one thread can build
+// each of many small tables in parallel.
+NGP_HOST_DEVICE inline void build_alias_table(AliasEntry* table, uint32_t n) {
+	// Entries with a scaled mass below 1 ("small") are completed by a donation of the next entry with a scaled mass
+	// of at least 1 ("large"). `alias == i` marks the entries that are not completed yet.
+	for (uint32_t i = 0; i < n; ++i) {
+		table[i].prob = table[i].pmf * (float)n;
+		table[i].alias = i;
+	}
+
+	auto next_small = [&](uint32_t i) {
+		while (i < n && table[i].prob >= 1.0f) ++i;
+		return i;
+	};
+
+	auto next_large = [&](uint32_t i) {
+		while (i < n && table[i].prob < 1.0f) ++i;
+		return i;
+	};
+
+	uint32_t scan = next_small(0);
+	uint32_t large = next_large(0);
+	uint32_t small = scan;
+	while (small < n && large < n) {
+		table[small].alias = large;
+		table[large].prob = (table[large].prob + table[small].prob) - 1.0f;
+
+		if (table[large].prob < 1.0f) {
+			// The donor became small itself. If the scan for small entries already passed it, complete it next.
+			uint32_t donor = large;
+			large = next_large(large + 1);
+			if (donor < scan) {
+				small = donor;
+				continue;
+			}
+		}
+
+		scan = next_small(scan + 1);
+		small = scan;
+	}
+
+	// The remaining entries have a scaled mass of 1 up to rounding
+	for (uint32_t i = 0; i < n; ++i) {
+		if (table[i].alias == i) {
+			table[i].prob = 1.0f;
+		}
+	}
+}
+
+// Draws an index from the table using the uniform `sample` in [0, 1), which is then replaced by a
+// fresh uniform sample in [0, 1) that is independent of the drawn index.
+NGP_HOST_DEVICE inline uint32_t sample_alias_table(const AliasEntry* table, uint32_t n, float& sample) {
+	float scaled = sample * (float)n;
+	uint32_t i = (uint32_t)scaled < n - 1 ? (uint32_t)scaled : n - 1;
+	float u = scaled - (float)i;
+	u = u < ALIAS_ONE_MINUS_EPSILON ? u : ALIAS_ONE_MINUS_EPSILON;
+
+	const AliasEntry& entry = table[i];
+	uint32_t result;
+	if (u < entry.prob) {
+		sample = u / entry.prob;
+		result = i;
+	} else {
+		sample = (u - entry.prob) / (1.0f - entry.prob);
+		result = entry.alias;
+	}
+
+	sample = sample < ALIAS_ONE_MINUS_EPSILON ? sample : ALIAS_ONE_MINUS_EPSILON;
+	return result;
+}
+
+NGP_NAMESPACE_END
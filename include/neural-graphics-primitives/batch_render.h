@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+/** @file   batch_render.h
+ *  @author Thomas Müller, NVIDIA
+ *  @brief  Backend-agnostic orchestration of batched multi-view rendering: views are
+ *          rendered into alternating slots while the previous view is read back.
+ */
+
+#pragma once
+
+#include <neural-graphics-primitives/common.h>
+#include <neural-graphics-primitives/thread_pool.h>
+
+#include <future>
+#include <string>
+#include <vector>
+
+NGP_NAMESPACE_BEGIN
+
+// Number of render targets a backend needs to provide. While view i is rendered
+// into slot i % BATCH_RENDER_N_SLOTS, view i-1 is read back from the other slot.
+static constexpr uint32_t BATCH_RENDER_N_SLOTS = 2;
+
+struct BatchRenderView {
+	Eigen::Matrix<float, 3, 4> camera_matrix;
+	Eigen::Vector2i resolution;
+	uint32_t spp;
+	// Index of the view's first sample, such that callers can refine a view progressively.
+	uint32_t spp_offset = 0;
+	// Backends derive the focal length from their own settings unless it is set here.
+	Eigen::Vector2f focal_length = Eigen::Vector2f::Zero();
+	// Offset (in floats) of the view's RGBA pixels within the output buffer
+	size_t offset;
+
+	size_t n_floats() const {
+		return (size_t)resolution.x() * resolution.y() * 4;
+	}
+};
+
+struct BatchRenderPlan {
+	std::vector<BatchRenderView> views;
+	size_t n_floats = 0;
+	bool uniform_resolution = true;
+	Eigen::Vector2i max_resolution = Eigen::Vector2i::Zero();
+};
+
+// `camera_matrices` holds `n_views` row-major 3x4 matrices (the layout of a (N, 3, 4) numpy array).
+// `resolutions` and `spps` either contain a single entry that applies to all views or one entry per view.
+inline BatchRenderPlan plan_batch_render(const float* camera_matrices, size_t n_views, const std::vector<Eigen::Vector2i>& resolutions, const std::vector<uint32_t>& spps) {
+	if (resolutions.size() != 1 && resolutions.size() != n_views) {
+		throw std::runtime_error{"Batch render: expected 1 or " + std::to_string(n_views) + " resolutions but got " + std::to_string(resolutions.size()) + "."};
+	}
+
+	if (spps.size() != 1 && spps.size() != n_views) {
+		throw std::runtime_error{"Batch render: expected 1 or " + std::to_string(n_views) + " spp values but got " + std::to_string(spps.size()) + "."};
+	}
+
+	BatchRenderPlan plan;
+	plan.views.resize(n_views);
+
+	for (size_t i = 0; i < n_views; ++i) {
+		BatchRenderView& view = plan.views[i];
+
+		for (int row = 0; row < 3; ++row) {
+			for (int col = 0; col < 4; ++col) {
+				view.camera_matrix(row, col) = camera_matrices[i*12 + row*4 + col];
+			}
+		}
+
+		view.resolution = resolutions[resolutions.size() == 1 ? 0 : i];
+		view.spp = spps[spps.size() == 1 ? 0 : i];
+
+		if (view.resolution.x() <= 0 || view.resolution.y() <= 0) {
+			throw std::runtime_error{"Batch render: view " + std::to_string(i) + " has an invalid resolution."};
+		}
+
+		if (view.spp == 0) {
+			throw std::runtime_error{"Batch render: view " + std::to_string(i) + " requests 0 samples per pixel."};
+		}
+
+		view.offset = plan.n_floats;
+		plan.n_floats += view.n_floats();
+
+		plan.uniform_resolution &= view.resolution == plan.views[0].resolution;
+		plan.max_resolution = plan.max_resolution.cwiseMax(view.resolution);
+	}
+
+	return plan;
+}
+
+// Renders all views of `plan` into `out`, which must hold `plan.n_floats` floats.
+//  - `render_view(const BatchRenderView& view, uint32_t slot)` renders a view into a backend slot and blocks until done.
+//  - `read_back(const BatchRenderView& view, uint32_t slot, float* dst)` copies the slot's RGBA pixels to `dst`.
+// Read-backs run on `pool` and overlap with rendering the next view.
+template <typename R, typename B>
+void render_batch(const BatchRenderPlan& plan, float* out, ThreadPool& pool, R&& render_view, B&& read_back) {
+	std::future<void> read_backs[BATCH_RENDER_N_SLOTS];
+
+	// Pending read-backs reference this stack frame; wait for them even if rendering throws.
+	ScopeGuard read_back_guard{[&]() {
+		for (auto& f : read_backs) {
+			if (f.valid()) {
+				f.wait();
+			}
+		}
+	}};
+
+	for (size_t i = 0; i < plan.views.size(); ++i) {
+		const BatchRenderView& view = plan.views[i];
+		uint32_t slot = (uint32_t)(i % BATCH_RENDER_N_SLOTS);
+
+		// The slot is free once the view that was last rendered into it has been read back
+		if (read_backs[slot].valid()) {
+			read_backs[slot].get();
+		}
+
+		render_view(view, slot);
+
+		read_backs[slot] = pool.enqueueTask([&read_back, &view, slot, out]() {
+			read_back(view, slot, out + view.offset);
+		});
+	}
+
+	for (auto& f : read_backs) {
+		if (f.valid()) {
+			f.get();
+		}
+	}
+}
+
+NGP_NAMESPACE_END
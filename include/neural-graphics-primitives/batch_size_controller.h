@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+/** @file   batch_size_controller.h
+ *  @author Thomas Müller, NVIDIA
+ *  @brief  Adapts the number of rays per NeRF training batch to the number of samples they produce.
+ */
+
+#pragma once
+
+#include <neural-graphics-primitives/common.h>
+
+NGP_NAMESPACE_BEGIN
+
+// Chooses the number of rays per training batch such that the batch contains a target number of samples.
+// Measurements may arrive several batches after the batch was generated. Each measurement is therefore
+// related to the number of rays that its own batch was generated with, i.e. the controller estimates the
+// number of samples per ray rather than correcting the current number of rays by the measured error,
+// which would overshoot and oscillate as soon as the feedback is delayed.
+class BatchSizeController {
+public:
+	// `smoothing` in [0, 1) averages the estimate over past measurements. 0 uses the latest measurement only.
+	BatchSizeController(float smoothing = 0.0f, uint32_t max_rays_per_batch = 1u << 18)
+	: m_smoothing{smoothing}, m_max_rays_per_batch{max_rays_per_batch} {}
+
+	// Records that a batch generated from `rays_per_batch` rays contained `batch_size` samples.
+	void measure(uint32_t rays_per_batch, uint32_t batch_size) {
+		if (rays_per_batch == 0 || batch_size == 0) {
+			return;
+		}
+
+		if (m_n_measurements++ == 0) {
+			m_rays = (float)rays_per_batch;
+			m_samples = (float)batch_size;
+		} else {
+			m_rays = m_smoothing * m_rays + (1 - m_smoothing) * (float)rays_per_batch;
+			m_samples = m_smoothing * m_samples + (1 - m_smoothing) * (float)batch_size;
+		}
+	}
+
+	// Number of rays that is expected to yield `target_batch_size` samples, or `fallback` without measurements.
+	uint32_t rays_per_batch(uint32_t target_batch_size, uint32_t fallback) const {
+		if (m_n_measurements == 0) {
+			return fallback;
+		}
+
+		uint32_t result = (uint32_t)(m_rays * (float)target_batch_size / m_samples);
+		result = (result + BATCH_SIZE_MULTIPLE - 1) / BATCH_SIZE_MULTIPLE * BATCH_SIZE_MULTIPLE;
+		return std::min(std::max(result, BATCH_SIZE_MULTIPLE), m_max_rays_per_batch);
+	}
+
+	float samples_per_ray() const {
+		return m_n_measurements == 0 ? 0.0f : m_samples / m_rays;
+	}
+
+	uint32_t n_measurements() const { return m_n_measurements; }
+
+	void reset() {
+		m_n_measurements = 0;
+	}
+
+private:
+	float m_smoothing;
+	uint32_t m_max_rays_per_batch;
+
+	uint32_t m_n_measurements = 0;
+	float m_rays = 0.0f;
+	float m_samples = 0.0f;
+};
+
+NGP_NAMESPACE_END
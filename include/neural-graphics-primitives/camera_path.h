@@ -34,6 +34,7 @@ struct CameraKeyframe {
 	float scale; // not a scale factor as in scaling the world, but the value of m_scale (setting the focal plane along with slice)
 	float fov;
 	float dof;
+	float ortho_scale = 1.0f; // magnification of the orthographic projection, i.e. the value of m_zoom
 	Eigen::Matrix<float, 3, 4> m() const {
 		Eigen::Matrix<float, 3, 4> rv;
 		rv.col(3) = T;
@@ -49,13 +50,13 @@ struct CameraKeyframe {
 	}
 
 	CameraKeyframe() = default;
-	CameraKeyframe(const Eigen::Vector4f &r, const Eigen::Vector3f &t, float sl, float sc, float fv, float df) : R(r), T(t), slice(sl), scale(sc), fov(fv), dof(df) {}
-	CameraKeyframe(Eigen::Matrix<float, 3, 4> m, float sl, float sc, float fv, float df) : slice(sl), scale(sc), fov(fv), dof(df) { T=m.col(3); R=Eigen::Quaternionf(m.block<3,3>(0,0)).coeffs();  }
-	CameraKeyframe operator*(float f) const { return {R*f,T*f,slice*f,scale*f,fov*f,dof*f}; }
+	CameraKeyframe(const Eigen::Vector4f &r, const Eigen::Vector3f &t, float sl, float sc, float fv, float df, float os = 1.0f) : R(r), T(t), slice(sl), scale(sc), fov(fv), dof(df), ortho_scale(os) {}
+	CameraKeyframe(Eigen::Matrix<float, 3, 4> m, float sl, float sc, float fv, float df, float os = 1.0f) : slice(sl), scale(sc), fov(fv), dof(df), ortho_scale(os) { T=m.col(3); R=Eigen::Quaternionf(m.block<3,3>(0,0)).coeffs();  }
+	CameraKeyframe operator*(float f) const { return {R*f,T*f,slice*f,scale*f,fov*f,dof*f,ortho_scale*f}; }
 	CameraKeyframe operator+(const CameraKeyframe &rhs) const {
 		Eigen::Vector4f Rr=rhs.R;
 		if (Rr.dot(R)<0.f) Rr=-Rr;
-		return {R+Rr,T+rhs.T,slice+rhs.slice,scale+rhs.scale,fov+rhs.fov,dof+rhs.dof};
+		return {R+Rr,T+rhs.T,slice+rhs.slice,scale+rhs.scale,fov+rhs.fov,dof+rhs.dof,ortho_scale+rhs.ortho_scale};
 	}
 	bool SamePosAs(const CameraKeyframe &rhs) const {
 		return (T-rhs.T).norm()<0.0001f && fabsf(R.dot(rhs.R))>=0.999f;
@@ -71,8 +72,15 @@ struct CameraPath {
 	float m_playtime = 0.f;
 	float m_autoplayspeed = 0.f;
 
-	const CameraKeyframe& get_keyframe(int i) { return m_keyframes[tcnn::clamp(i, 0, (int)m_keyframes.size()-1)]; }
-	CameraKeyframe eval_camera_path(float t) {
+	// If enabled, eval() and eval_batch() move along the path at constant speed rather than
+	// spending the same amount of time between any two keyframes. Speed is measured as the
+	// camera's translation plus its rotation, weighted by m_rotation_weight (distance per radian).
+	bool m_constant_speed = false;
+	float m_rotation_weight = 0.5f;
+
+	const CameraKeyframe& get_keyframe(int i) const { return m_keyframes[tcnn::clamp(i, 0, (int)m_keyframes.size()-1)]; }
+	// Evaluates the path at a parameter `t` that is spread uniformly across keyframes.
+	CameraKeyframe eval_camera_path(float t) const {
 		if (m_keyframes.empty())
 			return {};
 		t *= (float)(m_keyframes.size()-1);
@@ -80,15 +88,32 @@ struct CameraPath {
 		return spline(t-floorf(t), get_keyframe(t1-1), get_keyframe(t1), get_keyframe(t1+1), get_keyframe(t1+2));
 	}
 
+	// Maps between time (as passed to eval()) and the keyframe parameter of eval_camera_path().
+	float time_to_param(float time) const;
+	float param_to_time(float param) const;
+
+	CameraKeyframe eval(float time) const { return eval_camera_path(time_to_param(time)); }
+	void eval_batch(const float* times, size_t n_times, CameraKeyframe* result) const;
+	std::vector<CameraKeyframe> eval_batch(const std::vector<float>& times) const;
+
 	void save(const std::string& filepath_string);
 	void load(const std::string& filepath_string, const Eigen::Matrix<float, 3, 4> &first_xform);
 
 #ifdef NGP_GUI
 	ImGuizmo::MODE m_gizmo_mode = ImGuizmo::LOCAL;
 	ImGuizmo::OPERATION m_gizmo_op = ImGuizmo::TRANSLATE;
-	int imgui(char path_filename_buf[128], float frame_milliseconds, Eigen::Matrix<float, 3, 4> &camera, float slice_plane_z, float scale, float fov, float dof, float bounding_radius, const Eigen::Matrix<float, 3, 4> &first_xform);
+	int imgui(char path_filename_buf[128], float frame_milliseconds, Eigen::Matrix<float, 3, 4> &camera, float slice_plane_z, float scale, float fov, float dof, float ortho_scale, float bounding_radius, const Eigen::Matrix<float, 3, 4> &first_xform);
 	bool imgui_viz(Eigen::Matrix<float, 4, 4> &view2proj, Eigen::Matrix<float, 4, 4> &world2proj, Eigen::Matrix<float, 4, 4> &world2view, Eigen::Vector2f focal, float aspect);
 #endif
+
+private:
+	// Cumulative, normalized path length at uniformly spaced keyframe parameters. Rebuilt
+	// lazily whenever the keyframes or the rotation weight change.
+	void update_arc_length_lut() const;
+	float lookup_param(float time) const;
+
+	mutable std::vector<float> m_arc_length_lut;
+	mutable size_t m_arc_length_lut_hash = 0;
 };
 
 #ifdef NGP_GUI
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+/** @file   camera_undistortion.h
+ *  @author Thomas Müller, NVIDIA
+ *  @brief  Precomputes the inverse of a camera's lens distortion as a lookup table, such that
+ *          generating rays does not require an iterative solve per ray.
+ */
+
+#pragma once
+
+#include <neural-graphics-primitives/common.h>
+#include <neural-graphics-primitives/thread_pool.h>
+
+#include <vector>
+
+NGP_NAMESPACE_BEGIN
+
+// Offsets from distorted to undistorted normalized image coordinates, i.e. (uv - principal_point) * resolution / focal_length,
+// sampled on a regular grid over [domain_min, domain_max]. See CameraUndistortion for the lookup.
+struct CameraUndistortionMap {
+	CameraDistortion distortion;
+	Eigen::Vector2i resolution = Eigen::Vector2i::Zero();
+	Eigen::Vector2f domain_min = Eigen::Vector2f::Zero();
+	Eigen::Vector2f domain_max = Eigen::Vector2f::Zero();
+	std::vector<float> offsets;
+
+	// Largest deviation of the interpolated lookup from the iterative solve, measured at the centers of the grid's cells.
+	float max_error = 0.0f;
+
+	bool empty() const { return offsets.empty(); }
+
+	// Lookup that reads the offsets from `data`, e.g. a copy of `offsets` in GPU memory.
+	CameraUndistortion lookup(const float* data) const;
+	CameraUndistortion lookup() const { return lookup(offsets.data()); }
+};
+
+CameraUndistortionMap build_camera_undistortion_map(
+	const CameraDistortion& distortion,
+	const Eigen::Vector2f& domain_min,
+	const Eigen::Vector2f& domain_max,
+	const Eigen::Vector2i& resolution,
+	ThreadPool& pool
+);
+
+// Covers the normalized image coordinates of all pixels of images with the given focal lengths, enlarged by `margin`
+// relative to its size to accommodate later changes of the focal lengths or principal point.
+CameraUndistortionMap build_camera_undistortion_map(
+	const CameraDistortion& distortion,
+	const Eigen::Vector2f& principal_point,
+	const Eigen::Vector2i& image_resolution,
+	const std::vector<Eigen::Vector2f>& focal_lengths,
+	ThreadPool& pool,
+	const Eigen::Vector2i& resolution = {512, 512},
+	float margin = 0.1f
+);
+
+NGP_NAMESPACE_END
@@ -49,7 +49,10 @@
 	#define NGP_PRAGMA_NO_UNROLL
 #endif
 
+#include <algorithm>
+#include <cmath>
 #include <functional>
+#include <limits>
 
 NGP_NAMESPACE_BEGIN
 
@@ -156,20 +159,122 @@ struct Ray {
 	Eigen::Vector3f d;
 };
 
+#ifdef __NVCC__
+#define NGP_HOST_DEVICE __host__ __device__
+#else
+#define NGP_HOST_DEVICE
+#endif
+
 struct CameraDistortion {
 	float params[4] = {};
-#ifdef __NVCC__
-	inline __host__ __device__ bool is_zero() const {
+	inline NGP_HOST_DEVICE bool is_zero() const {
 		return params[0] == 0.0f && params[1] == 0.0f && params[2] == 0.0f && params[3] == 0.0f;
 	}
-#endif
 };
 
-#ifdef __NVCC__
-#define NGP_HOST_DEVICE __host__ __device__
-#else
-#define NGP_HOST_DEVICE
-#endif
+template <typename T>
+NGP_HOST_DEVICE inline void camera_distortion(const T* extra_params, const T u, const T v, T* du, T* dv) {
+	const T k1 = extra_params[0];
+	const T k2 = extra_params[1];
+	const T p1 = extra_params[2];
+	const T p2 = extra_params[3];
+
+	const T u2 = u * u;
+	const T uv = u * v;
+	const T v2 = v * v;
+	const T r2 = u2 + v2;
+	const T radial = k1 * r2 + k2 * r2 * r2;
+	*du = u * radial + T(2) * p1 * uv + p2 * (r2 + T(2) * u2);
+	*dv = v * radial + T(2) * p2 * uv + p1 * (r2 + T(2) * v2);
+}
+
+template <typename T>
+NGP_HOST_DEVICE inline void iterative_camera_undistortion(const T* params, T* u, T* v) {
+	// Parameters for Newton iteration using numerical differentiation with
+	// central differences, 100 iterations should be enough even for complex
+	// camera models with higher order terms.
+	const uint32_t kNumIterations = 100;
+	const float kMaxStepNorm = 1e-10f;
+	const float kRelStepSize = 1e-6f;
+
+	Eigen::Matrix2f J;
+	const Eigen::Vector2f x0(*u, *v);
+	Eigen::Vector2f x(*u, *v);
+	Eigen::Vector2f dx;
+	Eigen::Vector2f dx_0b;
+	Eigen::Vector2f dx_0f;
+	Eigen::Vector2f dx_1b;
+	Eigen::Vector2f dx_1f;
+
+	for (uint32_t i = 0; i < kNumIterations; ++i) {
+		const float step0 = std::max(std::numeric_limits<float>::epsilon(), std::abs(kRelStepSize * x(0)));
+		const float step1 = std::max(std::numeric_limits<float>::epsilon(), std::abs(kRelStepSize * x(1)));
+		camera_distortion(params, x(0), x(1), &dx(0), &dx(1));
+		camera_distortion(params, x(0) - step0, x(1), &dx_0b(0), &dx_0b(1));
+		camera_distortion(params, x(0) + step0, x(1), &dx_0f(0), &dx_0f(1));
+		camera_distortion(params, x(0), x(1) - step1, &dx_1b(0), &dx_1b(1));
+		camera_distortion(params, x(0), x(1) + step1, &dx_1f(0), &dx_1f(1));
+		J(0, 0) = 1 + (dx_0f(0) - dx_0b(0)) / (2 * step0);
+		J(0, 1) = (dx_1f(0) - dx_1b(0)) / (2 * step1);
+		J(1, 0) = (dx_0f(1) - dx_0b(1)) / (2 * step0);
+		J(1, 1) = 1 + (dx_1f(1) - dx_1b(1)) / (2 * step1);
+		const Eigen::Vector2f step_x = J.inverse() * (x + dx - x0);
+		x -= step_x;
+		if (step_x.squaredNorm() < kMaxStepNorm) {
+			break;
+		}
+	}
+
+	*u = x(0);
+	*v = x(1);
+}
+
+// Undistorts normalized image coordinates by bilinearly interpolating a precomputed map of offsets
+// (see camera_undistortion.h). Coordinates outside of the map's domain fall back to the iterative solve.
+struct CameraUndistortion {
+	CameraUndistortion() = default;
+	NGP_HOST_DEVICE CameraUndistortion(const CameraDistortion& distortion) : distortion{distortion} {}
+
+	CameraDistortion distortion;
+	// Two floats per texel: the offset from the distorted to the undistorted coordinates. The corner
+	// texels are located at `domain_min` and `domain_max`.
+	const float* data = nullptr;
+	Eigen::Vector2i resolution = Eigen::Vector2i::Zero();
+	Eigen::Vector2f domain_min = Eigen::Vector2f::Zero();
+	Eigen::Vector2f domain_max = Eigen::Vector2f::Zero();
+
+	inline NGP_HOST_DEVICE bool is_zero() const {
+		return distortion.is_zero();
+	}
+
+	inline NGP_HOST_DEVICE void undistort(float* u, float* v) const {
+		if (data) {
+			Eigen::Vector2f pos = (Eigen::Vector2f{*u, *v} - domain_min).cwiseQuotient(domain_max - domain_min);
+			if (pos.x() >= 0.0f && pos.x() <= 1.0f && pos.y() >= 0.0f && pos.y() <= 1.0f) {
+				pos = pos.cwiseProduct((resolution - Eigen::Vector2i::Ones()).cast<float>());
+				Eigen::Vector2i texel = pos.cast<int>().cwiseMin(resolution - Eigen::Vector2i::Constant(2));
+				Eigen::Vector2f weight = pos - texel.cast<float>();
+
+				const float* p00 = data + (texel.x() + texel.y() * resolution.x()) * 2;
+				const float* p10 = p00 + 2;
+				const float* p01 = p00 + resolution.x() * 2;
+				const float* p11 = p01 + 2;
+
+				for (int i = 0; i < 2; ++i) {
+					float offset =
+						(1 - weight.x()) * (1 - weight.y()) * p00[i] +
+						weight.x() * (1 - weight.y()) * p10[i] +
+						(1 - weight.x()) * weight.y() * p01[i] +
+						weight.x() * weight.y() * p11[i];
+					(i == 0 ? *u : *v) += offset;
+				}
+				return;
+			}
+		}
+
+		iterative_camera_undistortion(distortion.params, u, v);
+	}
+};
 
 inline NGP_HOST_DEVICE float sign(float x) {
 	return copysignf(1.0, x);
@@ -143,64 +143,6 @@ __device__ void deposit_image_gradient(const Eigen::Matrix<float, N_DIMS, 1>& va
 	deposit_val(value, (weight.x()) * (weight.y()), {texel.x()+1, texel.y()+1});
 }
 
-template <typename T>
-__device__ __host__ inline void camera_distortion(const T* extra_params, const T u, const T v, T* du, T* dv) {
-	const T k1 = extra_params[0];
-	const T k2 = extra_params[1];
-	const T p1 = extra_params[2];
-	const T p2 = extra_params[3];
-
-	const T u2 = u * u;
-	const T uv = u * v;
-	const T v2 = v * v;
-	const T r2 = u2 + v2;
-	const T radial = k1 * r2 + k2 * r2 * r2;
-	*du = u * radial + T(2) * p1 * uv + p2 * (r2 + T(2) * u2);
-	*dv = v * radial + T(2) * p2 * uv + p1 * (r2 + T(2) * v2);
-}
-
-template <typename T>
-__device__ __host__ inline void iterative_camera_undistortion(const T* params, T* u, T* v) {
-	// Parameters for Newton iteration using numerical differentiation with
-	// central differences, 100 iterations should be enough even for complex
-	// camera models with higher order terms.
-	const uint32_t kNumIterations = 100;
-	const float kMaxStepNorm = 1e-10f;
-	const float kRelStepSize = 1e-6f;
-
-	Eigen::Matrix2f J;
-	const Eigen::Vector2f x0(*u, *v);
-	Eigen::Vector2f x(*u, *v);
-	Eigen::Vector2f dx;
-	Eigen::Vector2f dx_0b;
-	Eigen::Vector2f dx_0f;
-	Eigen::Vector2f dx_1b;
-	Eigen::Vector2f dx_1f;
-
-	for (uint32_t i = 0; i < kNumIterations; ++i) {
-		const float step0 = std::max(std::numeric_limits<float>::epsilon(), std::abs(kRelStepSize * x(0)));
-		const float step1 = std::max(std::numeric_limits<float>::epsilon(), std::abs(kRelStepSize * x(1)));
-		camera_distortion(params, x(0), x(1), &dx(0), &dx(1));
-		camera_distortion(params, x(0) - step0, x(1), &dx_0b(0), &dx_0b(1));
-		camera_distortion(params, x(0) + step0, x(1), &dx_0f(0), &dx_0f(1));
-		camera_distortion(params, x(0), x(1) - step1, &dx_1b(0), &dx_1b(1));
-		camera_distortion(params, x(0), x(1) + step1, &dx_1f(0), &dx_1f(1));
-		J(0, 0) = 1 + (dx_0f(0) - dx_0b(0)) / (2 * step0);
-		J(0, 1) = (dx_1f(0) - dx_1b(0)) / (2 * step1);
-		J(1, 0) = (dx_0f(1) - dx_0b(1)) / (2 * step0);
-		J(1, 1) = 1 + (dx_1f(1) - dx_1b(1)) / (2 * step1);
-		const Eigen::Vector2f step_x = J.inverse() * (x + dx - x0);
-		x -= step_x;
-		if (step_x.squaredNorm() < kMaxStepNorm) {
-			break;
-		}
-	}
-
-	*u = x(0);
-	*v = x(1);
-}
-
-
 inline __host__ __device__ Ray pixel_to_ray_pinhole(
 	uint32_t spp,
 	const Eigen::Vector2i& pixel,
@@ -273,7 +215,7 @@ inline __host__ __device__ Ray pixel_to_ray(
 	bool snap_to_pixel_centers = false,
 	float focus_z = 1.0f,
 	float dof = 0.0f,
-	const CameraDistortion& camera_distortion = {},
+	const CameraUndistortion& camera_undistortion = {},
 	const float* __restrict__ distortion_data = nullptr,
 	const Eigen::Vector2i distortion_resolution = Eigen::Vector2i::Zero()
 ) {
@@ -285,8 +227,8 @@ inline __host__ __device__ Ray pixel_to_ray(
 		(uv.y() - screen_center.y()) * (float)resolution.y() / focal_length.y(),
 		1.0f
 	};
-	if (!camera_distortion.is_zero()) {
-		iterative_camera_undistortion(camera_distortion.params, &dir.x(), &dir.y());
+	if (!camera_undistortion.is_zero()) {
+		camera_undistortion.undistort(&dir.x(), &dir.y());
 	}
 	if (distortion_data) {
 		dir.head<2>() += read_image<2>(distortion_data, distortion_resolution, uv);
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+/** @file   deferred_readback.h
+ *  @author Thomas Müller, NVIDIA
+ *  @brief  Ring of pinned host buffers that reads back small results from the GPU without
+ *          synchronizing, such that the host can consume them once they are long available.
+ */
+
+#pragma once
+
+#include <neural-graphics-primitives/common.h>
+
+#include <tiny-cuda-nn/common.h>
+
+#include <vector>
+
+NGP_NAMESPACE_BEGIN
+
+// Reads back values of type T along with host-side metadata of type M. Values are consumed in the order
+// in which they were pushed.
+template <typename T, typename M>
+class DeferredReadback {
+public:
+	DeferredReadback() = default;
+
+	~DeferredReadback() {
+		free();
+	}
+
+	DeferredReadback(const DeferredReadback&) = delete;
+	DeferredReadback& operator=(const DeferredReadback&) = delete;
+
+	// Number of readbacks that can be in flight. Discards the ones that are in flight if it changes.
+	void set_capacity(uint32_t capacity) {
+		if (capacity == m_slots.size()) {
+			return;
+		}
+
+		free();
+		if (capacity == 0) {
+			return;
+		}
+
+		CUDA_CHECK_THROW(cudaMallocHost((void**)&m_host, sizeof(T) * capacity));
+		m_slots.resize(capacity);
+		for (auto& slot : m_slots) {
+			CUDA_CHECK_THROW(cudaEventCreateWithFlags(&slot.event, cudaEventDisableTiming));
+		}
+	}
+
+	uint32_t capacity() const { return (uint32_t)m_slots.size(); }
+	uint32_t n_pending() const { return m_n_pending; }
+
+	// Enqueues the copy of `*src` into pinned memory on `stream`. There must be a free slot.
+	void push(const T* src, const M& meta, cudaStream_t stream) {
+		if (m_n_pending >= capacity()) {
+			throw std::runtime_error{"DeferredReadback: no free slot."};
+		}
+
+		uint32_t idx = (m_first + m_n_pending) % capacity();
+		CUDA_CHECK_THROW(cudaMemcpyAsync(m_host + idx, src, sizeof(T), cudaMemcpyDeviceToHost, stream));
+		CUDA_CHECK_THROW(cudaEventRecord(m_slots[idx].event, stream));
+		m_slots[idx].meta = meta;
+		++m_n_pending;
+	}
+
+	// Whether the oldest pending readback completed.
+	bool ready() const {
+		if (m_n_pending == 0) {
+			return false;
+		}
+
+		cudaError_t result = cudaEventQuery(m_slots[m_first].event);
+		if (result == cudaErrorNotReady) {
+			return false;
+		}
+
+		CUDA_CHECK_THROW(result);
+		return true;
+	}
+
+	// Consumes the oldest pending readback and waits for it if it did not complete yet.
+	void pop(T& value, M& meta) {
+		if (m_n_pending == 0) {
+			throw std::runtime_error{"DeferredReadback: nothing to pop."};
+		}
+
+		CUDA_CHECK_THROW(cudaEventSynchronize(m_slots[m_first].event));
+		value = m_host[m_first];
+		meta = m_slots[m_first].meta;
+		m_first = (m_first + 1) % capacity();
+		--m_n_pending;
+	}
+
+	// Discards all pending readbacks.
+	void clear() {
+		for (uint32_t i = 0; i < m_n_pending; ++i) {
+			CUDA_CHECK_THROW(cudaEventSynchronize(m_slots[(m_first + i) % capacity()].event));
+		}
+
+		m_first = 0;
+		m_n_pending = 0;
+	}
+
+private:
+	struct Slot {
+		cudaEvent_t event = nullptr;
+		M meta = {};
+	};
+
+	void free() {
+		// The copies must not write into freed memory. Errors are ignored, since this runs in the destructor.
+		for (uint32_t i = 0; i < m_n_pending; ++i) {
+			cudaEventSynchronize(m_slots[(m_first + i) % capacity()].event);
+		}
+		m_first = 0;
+		m_n_pending = 0;
+
+		for (auto& slot : m_slots) {
+			cudaEventDestroy(slot.event);
+		}
+		m_slots.clear();
+
+		if (m_host) {
+			cudaFreeHost(m_host);
+			m_host = nullptr;
+		}
+	}
+
+	T* m_host = nullptr;
+	std::vector<Slot> m_slots;
+	uint32_t m_first = 0;
+	uint32_t m_n_pending = 0;
+};
+
+NGP_NAMESPACE_END
@@ -25,6 +25,21 @@ inline constexpr __device__ uint32_t NERF_GRIDSIZE() {
 	return 128;
 }
 
+// Statistics of the training steps of one Testbed::train_nerf call, summarized on the GPU.
+struct NerfTrainingStats {
+	uint32_t n_samples_before_compaction;
+	uint32_t n_samples;
+	uint32_t n_empty_steps; // Steps that generated no samples
+	float loss_sum;
+};
+
+// Host-side context of the above statistics that is needed to interpret them.
+struct NerfTrainingStatsContext {
+	uint32_t n_training_steps;
+	uint32_t rays_per_batch;
+	uint32_t target_batch_size;
+};
+
 struct NerfPayload {
 	Eigen::Vector3f origin;
 	Eigen::Vector3f dir;
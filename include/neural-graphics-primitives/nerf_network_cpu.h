@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+/** @file   nerf_network_cpu.h
+ *  @author Thomas Müller, NVIDIA
+ *  @brief  Host-side inference of a trained NerfNetwork, reading the parameters
+ *          of a snapshot written by `Testbed::save_snapshot`.
+ */
+
+#pragma once
+
+#include <neural-graphics-primitives/common.h>
+
+#include <json/json.hpp>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+NGP_NAMESPACE_BEGIN
+
+class ThreadPool;
+
+// Number of floats in a NerfCoordinate: warped position (3), dt (1), warped direction (3).
+// The CPU network reads its inputs with this layout, such that arrays of NerfCoordinate
+// can be passed in directly.
+static constexpr uint32_t NERF_COORDINATE_N_FLOATS = 7;
+static constexpr uint32_t NERF_COORDINATE_DIR_OFFSET = 4;
+
+enum class ECpuActivation : int {
+	None,
+	ReLU,
+	Exponential,
+	Sine,
+	Sigmoid,
+	Squareplus,
+	Softplus,
+};
+
+// Mirrors tcnn's FullyFusedMLP / CutlassMLP: no biases, weights of each layer stored
+// row-major as (n_outputs x n_inputs), output padded to the network's alignment.
+struct CpuMlp {
+	void init(const nlohmann::json& config, uint32_t input_width, uint32_t output_width);
+	size_t n_params() const;
+	void set_params(const float* params);
+
+	uint32_t input_width = 0;
+	uint32_t width = 0;
+	uint32_t output_width = 0;
+	uint32_t padded_output_width = 0;
+	uint32_t n_hidden_layers = 0;
+	ECpuActivation activation = ECpuActivation::ReLU;
+	ECpuActivation output_activation = ECpuActivation::None;
+
+	std::vector<std::vector<float>> weights;
+};
+
+// Mirrors tcnn's multiresolution (hash) grid encoding with linear interpolation.
+struct CpuGridEncoding {
+	void init(const nlohmann::json& config, float desired_resolution, uint32_t alignment);
+	size_t n_params() const { return (size_t)offsets.back() * n_features_per_level; }
+	uint32_t n_encoded_dims() const { return n_levels * n_features_per_level; }
+
+	float level_scale(uint32_t level) const {
+		return std::exp2((float)level * std::log2(per_level_scale)) * (float)base_resolution - 1.0f;
+	}
+
+	uint32_t level_resolution(float scale) const {
+		return (uint32_t)std::ceil(scale) + 1;
+	}
+
+	uint32_t n_levels = 16;
+	uint32_t n_features_per_level = 2;
+	uint32_t log2_hashmap_size = 19;
+	uint32_t base_resolution = 16;
+	float per_level_scale = 2.0f;
+	uint32_t padded_output_width = 0;
+
+	std::vector<uint32_t> offsets;
+	std::vector<float> params;
+};
+
+class CpuNerfNetwork {
+public:
+	// Number of elements that are encoded and pushed through the MLPs at once.
+	// Activations of a block are kept in SoA layout such that the layers vectorize across it.
+	static constexpr uint32_t BLOCK_SIZE = 64;
+
+	CpuNerfNetwork() = default;
+	CpuNerfNetwork(const nlohmann::json& snapshot_config) { load(snapshot_config); }
+
+	// Reads a snapshot (.msgpack) or network config (.json) file.
+	static nlohmann::json read_snapshot(const std::string& path);
+
+	void load(const nlohmann::json& snapshot_config);
+	void load_snapshot(const std::string& path) { load(read_snapshot(path)); }
+
+	// Raw network outputs (rgb followed by density, before activation) for `n`
+	// NerfCoordinate-like inputs separated by `stride` floats. Writes 4 floats per element.
+	void inference(uint32_t n, const float* coords, uint32_t stride, float* rgbd) const;
+	void inference(ThreadPool& pool, uint32_t n, const float* coords, uint32_t stride, float* rgbd) const;
+
+	// Raw density output for `n` warped positions separated by `stride` floats.
+	void density(uint32_t n, const float* positions, uint32_t stride, float* density) const;
+	void density(ThreadPool& pool, uint32_t n, const float* positions, uint32_t stride, float* density) const;
+
+	bool loaded() const { return m_n_params > 0; }
+	size_t n_params() const { return m_n_params; }
+	int aabb_scale() const { return m_aabb_scale; }
+	const CpuGridEncoding& pos_encoding() const { return m_pos_encoding; }
+	const CpuMlp& density_network() const { return m_density_network; }
+	const CpuMlp& rgb_network() const { return m_rgb_network; }
+
+private:
+	struct Scratch;
+
+	void inference_block(uint32_t n, const float* coords, uint32_t stride, float* rgbd, float* density, Scratch& scratch) const;
+
+	CpuGridEncoding m_pos_encoding;
+	uint32_t m_sh_degree = 4;
+	uint32_t m_dir_padded_output_width = 16;
+	CpuMlp m_density_network;
+	CpuMlp m_rgb_network;
+	uint32_t m_rgb_network_input_width = 0;
+	uint32_t m_max_width = 0;
+
+	int m_aabb_scale = 1;
+	size_t m_n_params = 0;
+};
+
+NGP_NAMESPACE_END
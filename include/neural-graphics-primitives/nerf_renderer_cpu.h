@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+/** @file   nerf_renderer_cpu.h
+ *  @author Thomas Müller, NVIDIA
+ *  @brief  Tiled, multithreaded CPU renderer for NeRF snapshots that reproduces
+ *          the NerfTracer pipeline of testbed_nerf.cu.
+ */
+
+#pragma once
+
+#include <neural-graphics-primitives/batch_render.h>
+#include <neural-graphics-primitives/common.h>
+#include <neural-graphics-primitives/nerf_network_cpu.h>
+#include <neural-graphics-primitives/occupancy_distance_field.h>
+
+#include <json/json.hpp>
+
+#include <string>
+#include <vector>
+
+NGP_NAMESPACE_BEGIN
+
+class ThreadPool;
+
+struct CpuNerfRenderSettings {
+	Eigen::Vector2i resolution = {0, 0};
+	Eigen::Vector2f focal_length = {1000.0f, 1000.0f};
+	Eigen::Matrix<float, 3, 4> camera_matrix0 = Eigen::Matrix<float, 3, 4>::Identity();
+	Eigen::Matrix<float, 3, 4> camera_matrix1 = Eigen::Matrix<float, 3, 4>::Identity();
+	Eigen::Vector2f screen_center = Eigen::Vector2f::Constant(0.5f);
+
+	// Number of samples per pixel that are traced and accumulated.
+	uint32_t spp = 1;
+	// Index of the first sample; lets callers refine an image progressively.
+	uint32_t spp_offset = 0;
+
+	// The CUDA renderer always generates orthographic rays.
+	bool orthographic = true;
+	bool snap_to_pixel_centers = false;
+
+	ERenderMode render_mode = ERenderMode::Shade;
+	ENerfActivation rgb_activation = ENerfActivation::Exponential;
+	ENerfActivation density_activation = ENerfActivation::Exponential;
+	float min_alpha = 0.01f;
+	// Negative values select the default of Testbed::load_nerf(), which depends on the aabb scale.
+	float cone_angle_constant = -1.0f;
+	// Skip blocks of empty cells at once, see Testbed::Nerf::skip_empty_space. Does not change the image.
+	bool skip_empty_space = true;
+	float depth_scale = 1.0f;
+	bool linear_colors = false;
+
+	float exposure = 0.0f;
+	Eigen::Array4f background_color = {0.0f, 0.0f, 0.0f, 1.0f};
+	EColorSpace color_space = EColorSpace::Linear;
+	ETonemapCurve tonemap_curve = ETonemapCurve::Identity;
+	bool to_srgb = true;
+
+	uint32_t tile_size = 32;
+};
+
+struct CpuNerfRenderStats {
+	uint64_t n_rays = 0;
+	uint64_t n_samples = 0;
+	uint32_t n_threads = 0;
+	float milliseconds = 0.0f;
+
+	double rays_per_second() const {
+		return milliseconds > 0 ? (double)n_rays / (milliseconds * 1e-3) : 0.0;
+	}
+
+	double rays_per_second_per_core() const {
+		return n_threads > 0 ? rays_per_second() / n_threads : 0.0;
+	}
+};
+
+class CpuNerfRenderer {
+public:
+	CpuNerfRenderer() = default;
+	CpuNerfRenderer(const nlohmann::json& snapshot_config) { load(snapshot_config); }
+
+	void load(const nlohmann::json& snapshot_config);
+	void load_snapshot(const std::string& path) { load(CpuNerfNetwork::read_snapshot(path)); }
+
+	// Renders `settings.spp` samples per pixel and writes the tonemapped RGBA image
+	// (resolution.x() * resolution.y() pixels, row-major) into `out`. Screen tiles are
+	// enqueued as individual tasks such that idle workers pick up the remaining tiles.
+	CpuNerfRenderStats render(const CpuNerfRenderSettings& settings, ThreadPool& pool, Eigen::Array4f* out) const;
+	std::vector<Eigen::Array4f> render(const CpuNerfRenderSettings& settings, ThreadPool& pool) const;
+
+	// Renders every view of `plan` into `out` (`plan.n_floats` floats). Views override the camera,
+	// resolution and spp of `settings`. Unless a view sets its own focal length, the focal length is
+	// scaled with the view's width relative to `settings.resolution` (if set), such that all views
+	// share the same field of view.
+	void render_batch(const CpuNerfRenderSettings& settings, const BatchRenderPlan& plan, ThreadPool& pool, float* out) const;
+
+	// Rebuilds the occupancy bitfield (including its mips) and its distance field from the density grid,
+	// mirroring Testbed::update_density_grid_mean_and_bitfield().
+	void update_density_grid_bitfield();
+
+	// Host memory occupied by the network parameters and the occupancy grid.
+	size_t memory_bytes() const {
+		return m_network.n_params() * sizeof(float) + m_density_grid.size() * sizeof(float) + m_density_grid_bitfield.size() + m_distance_field.memory_bytes();
+	}
+
+	const CpuNerfNetwork& network() const { return m_network; }
+	const std::vector<float>& density_grid() const { return m_density_grid; }
+	std::vector<float>& density_grid() { return m_density_grid; }
+	const std::vector<uint8_t>& density_grid_bitfield() const { return m_density_grid_bitfield; }
+
+	const Eigen::AlignedBox3f& aabb() const { return m_aabb; }
+	const Eigen::AlignedBox3f& render_aabb() const { return m_render_aabb; }
+	void set_render_aabb(const Eigen::AlignedBox3f& render_aabb) { m_render_aabb = render_aabb.intersection(m_aabb); }
+
+	float default_cone_angle_constant() const { return m_network.aabb_scale() <= 1 ? 0.0f : (1.0f / 256.0f); }
+
+private:
+	struct Tile;
+	struct TileScratch;
+
+	void render_tile(const CpuNerfRenderSettings& settings, const Tile& tile, Eigen::Array4f* out, TileScratch& scratch, uint64_t& n_samples) const;
+	void trace_tile(const CpuNerfRenderSettings& settings, uint32_t spp, const Tile& tile, TileScratch& scratch, uint64_t& n_samples) const;
+
+	CpuNerfNetwork m_network;
+
+	std::vector<float> m_density_grid;
+	std::vector<uint8_t> m_density_grid_bitfield;
+	OccupancyDistanceField m_distance_field;
+
+	Eigen::AlignedBox3f m_aabb;
+	Eigen::AlignedBox3f m_render_aabb;
+};
+
+NGP_NAMESPACE_END
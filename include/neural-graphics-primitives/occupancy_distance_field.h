@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+/** @file   occupancy_distance_field.h
+ *  @author Thomas Müller, NVIDIA
+ *  @brief  Chebyshev distance from every cell of the NeRF occupancy cascades to the nearest occupied
+ *          cell, such that rays can skip whole blocks of empty cells rather than one cell at a time.
+ */
+
+#pragma once
+
+#include <neural-graphics-primitives/common.h>
+#include <neural-graphics-primitives/occupancy_grid.h>
+#include <neural-graphics-primitives/thread_pool.h>
+
+#include <algorithm>
+#include <vector>
+
+NGP_NAMESPACE_BEGIN
+
+// Cells along each side of a cascade, as NERF_GRIDSIZE()
+static constexpr uint32_t OCCUPANCY_DISTANCE_GRIDSIZE = 128;
+static constexpr uint32_t OCCUPANCY_DISTANCE_N_CELLS_PER_CASCADE = OCCUPANCY_DISTANCE_GRIDSIZE * OCCUPANCY_DISTANCE_GRIDSIZE * OCCUPANCY_DISTANCE_GRIDSIZE;
+// Distances are clamped to this many cells, which bounds the cost of each pass.
+static constexpr uint32_t OCCUPANCY_DISTANCE_MAX = 16;
+
+// A cell at distance d is the center of a block of (2d-1)³ free cells. Occupied cells are at distance 0 and
+// cells outside of a cascade count as occupied, such that every free block lies within its cascade.
+// Distances are stored per cascade with x varying fastest.
+NGP_HOST_DEVICE inline uint32_t occupancy_distance_idx(uint32_t cascade, uint32_t x, uint32_t y, uint32_t z) {
+	return cascade * OCCUPANCY_DISTANCE_N_CELLS_PER_CASCADE + x + OCCUPANCY_DISTANCE_GRIDSIZE * (y + OCCUPANCY_DISTANCE_GRIDSIZE * z);
+}
+
+// Distance of the cell of cascade `mip` that contains `pos`. Positions outside of the cascade are clamped to
+// its border cells, like density_grid_occupied_at() does.
+NGP_HOST_DEVICE inline uint32_t occupancy_distance_at(const Eigen::Vector3f& pos, const uint8_t* distance_field, uint32_t mip) {
+	float mip_scale = scalbnf(1.0f, -(int)mip);
+	Eigen::Vector3f p = (pos - Eigen::Vector3f::Constant(0.5f)) * mip_scale + Eigen::Vector3f::Constant(0.5f);
+	Eigen::Vector3i i = (p * OCCUPANCY_DISTANCE_GRIDSIZE).cast<int>();
+	i = i.cwiseMax(0).cwiseMin((int)OCCUPANCY_DISTANCE_GRIDSIZE-1);
+	return distance_field[occupancy_distance_idx(mip, i.x(), i.y(), i.z())];
+}
+
+// First pass: distance of every cell of a row along x to the nearest occupied cell of the same row.
+// `bits` holds the row's occupancy, one bit per cell.
+NGP_HOST_DEVICE inline void occupancy_distance_row(const uint64_t* bits, uint8_t* row) {
+	uint32_t d = 0;
+	for (uint32_t x = 0; x < OCCUPANCY_DISTANCE_GRIDSIZE; ++x) {
+		d = ((bits[x/64] >> (x%64)) & 1) ? 0 : std::min(d + 1, OCCUPANCY_DISTANCE_MAX);
+		row[x] = (uint8_t)d;
+	}
+
+	d = 0;
+	for (uint32_t x = OCCUPANCY_DISTANCE_GRIDSIZE; x-- > 0;) {
+		d = ((bits[x/64] >> (x%64)) & 1) ? 0 : std::min(d + 1, OCCUPANCY_DISTANCE_MAX);
+		row[x] = (uint8_t)std::min((uint32_t)row[x], d);
+	}
+}
+
+// Second and third pass: combines the distances `line[k*stride]` of the cells along y (or z) into the distance
+// of cell `i` of the line within the planes (or volume) that the previous passes covered.
+NGP_HOST_DEVICE inline uint8_t occupancy_distance_combine(const uint8_t* line, uint32_t stride, int i) {
+	const int n = (int)OCCUPANCY_DISTANCE_GRIDSIZE;
+
+	// The cells beyond the ends of the line are occupied
+	int result = std::min(std::min((int)line[i*stride], std::min(i + 1, n - i)), (int)OCCUPANCY_DISTANCE_MAX);
+
+	// Cells k apart cannot be closer than k
+	for (int k = 1; k < result; ++k) {
+		if (i - k >= 0) {
+			result = std::min(result, std::max(k, (int)line[(i - k)*stride]));
+		}
+		if (i + k < n) {
+			result = std::min(result, std::max(k, (int)line[(i + k)*stride]));
+		}
+	}
+
+	return (uint8_t)result;
+}
+
+// Distance along the ray to where it leaves the block of free cells that is guaranteed by the `distance` of
+// the cell containing `pos`. `res` is the number of cells per unit length. With a distance of 1, this is
+// exactly the distance to the next cell that distance_to_next_voxel() computes.
+NGP_HOST_DEVICE inline float distance_to_free_block_exit(const Eigen::Vector3f& pos, const Eigen::Vector3f& dir, const Eigen::Vector3f& idir, uint32_t res, uint32_t distance) {
+	Eigen::Vector3f p = res * pos;
+	float r = (float)distance - 1.0f;
+	float tx = (floorf(p.x() + 0.5f + 0.5f * sign(dir.x())) + r * sign(dir.x()) - p.x()) * idir.x();
+	float ty = (floorf(p.y() + 0.5f + 0.5f * sign(dir.y())) + r * sign(dir.y()) - p.y()) * idir.y();
+	float tz = (floorf(p.z() + 0.5f + 0.5f * sign(dir.z())) + r * sign(dir.z()) - p.z()) * idir.z();
+	float t = fminf(fminf(tx, ty), tz);
+
+	return fmaxf(t / res, 0.0f);
+}
+
+// Host-side builder of the distance field. The device-side one in testbed_nerf.cu runs the same passes.
+class OccupancyDistanceField {
+public:
+	// Brings the distances up to date with `bitfield` (Morton-ordered, max-pooled bits of `n_cascades` cascades,
+	// as Testbed::m_nerf.density_grid_bitfield). Only the z-slices whose bits changed since the previous update,
+	// and the slices within OCCUPANCY_DISTANCE_MAX of them, are recomputed. Returns the number of recomputed slices.
+	uint32_t update(const uint8_t* bitfield, uint32_t n_cascades = OccupancyGrid::CASCADES, ThreadPool* pool = nullptr);
+	void clear();
+
+	// OCCUPANCY_DISTANCE_N_CELLS_PER_CASCADE distances per cascade, see occupancy_distance_idx()
+	const uint8_t* data() const { return m_distances.empty() ? nullptr : m_distances.data(); }
+	const std::vector<uint8_t>& distances() const { return m_distances; }
+	uint32_t distance(uint32_t cascade, uint32_t x, uint32_t y, uint32_t z) const {
+		return m_distances[occupancy_distance_idx(cascade, x, y, z)];
+	}
+
+	uint32_t n_cascades() const { return m_n_cascades; }
+
+	size_t memory_bytes() const {
+		return m_distances.size() + m_distances_xy.size() + m_bitfield.size();
+	}
+
+private:
+	uint32_t m_n_cascades = 0;
+	// Bits as of the previous update
+	std::vector<uint8_t> m_bitfield;
+	std::vector<uint8_t> m_distances;
+	// Distances within each z-slice, i.e. after the first two passes. Kept for the z-slices that do not change.
+	std::vector<uint8_t> m_distances_xy;
+};
+
+// Marches the same rays through the occupancy cascades of `grid` as the NeRF renderer and trainer do,
+// once stepping through empty space cell by cell and once skipping free blocks of the distance field.
+// Rays start outside of the unit cube and aim at uniformly distributed points within it.
+struct EmptySpaceSkippingBenchmark {
+	uint32_t n_rays = 0;
+
+	// Occupancy lookups per ray
+	double steps_per_ray = 0.0;
+	double steps_per_ray_skipping = 0.0;
+	// Samples in occupied cells per ray. Skipping must not change them.
+	double samples_per_ray = 0.0;
+	uint32_t n_rays_with_different_samples = 0;
+
+	// Single-threaded marching time
+	double ns_per_ray = 0.0;
+	double ns_per_ray_skipping = 0.0;
+
+	// Full build of the distance field
+	double build_milliseconds = 0.0;
+	size_t memory_bytes = 0;
+};
+
+EmptySpaceSkippingBenchmark benchmark_empty_space_skipping(const OccupancyGrid& grid, float cone_angle = 0.0f, uint32_t n_rays = 1 << 16, uint32_t seed = 1337, ThreadPool* pool = nullptr);
+
+NGP_NAMESPACE_END
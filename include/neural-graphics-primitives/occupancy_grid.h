@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+/** @file   occupancy_grid.h
+ *  @author Thomas Müller, NVIDIA
+ *  @brief  Host-side copy of the NeRF density grid and its occupancy bitfield that can be
+ *          inspected, pruned, and repaired offline and written back into a snapshot.
+ */
+
+#pragma once
+
+#include <neural-graphics-primitives/common.h>
+#include <neural-graphics-primitives/thread_pool.h>
+
+#include <json/json.hpp>
+
+#include <string>
+#include <vector>
+
+NGP_NAMESPACE_BEGIN
+
+// Thresholds `density_grid` (OccupancyGrid::N_ELEMENTS floats) into the occupancy bitfield
+// (OccupancyGrid::N_ELEMENTS/8 bytes) and max-pools every cascade into the next one, exactly like
+// Testbed::update_density_grid_mean_and_bitfield() does on the GPU.
+void nerf_density_grid_to_bitfield(const float* density_grid, uint8_t* bitfield, ThreadPool* pool = nullptr);
+
+struct OccupancyGridCascadeStats {
+	// Cells whose own density exceeds the threshold
+	uint32_t n_occupied = 0;
+	// Cells that are occupied once the finer cascades are max-pooled into this one, i.e. what the renderer sees
+	uint32_t n_occupied_pooled = 0;
+	float occupied_fraction = 0.0f;
+	float occupied_fraction_pooled = 0.0f;
+	// Mean of the non-negative densities of the cascade
+	float mean_density = 0.0f;
+	// Bounds of the pooled occupied cells in the unit cube that the NeRF is trained in. Empty if no cell is occupied.
+	Eigen::AlignedBox3f occupied_aabb;
+};
+
+class OccupancyGrid {
+public:
+	static constexpr uint32_t GRIDSIZE = 128;
+	static constexpr uint32_t CASCADES = 5;
+	static constexpr uint32_t N_CELLS_PER_CASCADE = GRIDSIZE * GRIDSIZE * GRIDSIZE;
+	static constexpr uint32_t N_ELEMENTS = N_CELLS_PER_CASCADE * CASCADES;
+
+	// Upper bound of the occupancy threshold, as NERF_MIN_OPTICAL_THICKNESS() in testbed_nerf.cu
+	static constexpr float MIN_OPTICAL_THICKNESS = 0.01f;
+
+	OccupancyGrid() = default;
+	OccupancyGrid(const nlohmann::json& snapshot_config, ThreadPool* pool = nullptr) { load(snapshot_config, pool); }
+
+	// Reads the density grid of a NeRF snapshot and derives the bitfield from it.
+	void load(const nlohmann::json& snapshot_config, ThreadPool* pool = nullptr);
+	void load_snapshot(const std::string& path, ThreadPool* pool = nullptr);
+
+	// Writes the density grid back into the snapshot. Densities are clamped such that the bitfield which
+	// the Testbed and CpuNerfRenderer derive from them on load is the one of this grid, even after
+	// cells were dilated, eroded, or cropped.
+	void save(nlohmann::json& snapshot_config) const;
+	// Updates the density grid within the snapshot file at `path`, leaving everything else as is.
+	void save_snapshot(const std::string& path) const;
+
+	void set_density_grid(std::vector<float> density_grid, ThreadPool* pool = nullptr);
+	const std::vector<float>& density_grid() const { return m_density_grid; }
+
+	// Morton-ordered bits of all cascades, including the max-pooled mips. Same layout as
+	// Testbed::m_nerf.density_grid_bitfield.
+	const std::vector<uint8_t>& bitfield() const { return m_bitfield; }
+
+	// Occupancy of a single cell in the cascade's own bits, i.e. before max-pooling.
+	bool occupied(uint32_t cascade, uint32_t x, uint32_t y, uint32_t z) const;
+	void set_occupied(uint32_t cascade, uint32_t x, uint32_t y, uint32_t z, bool value);
+
+	// Finest cascade that contains `pos`, as mip_from_pos() in testbed_nerf.cu
+	static uint32_t cascade_at(const Eigen::Vector3f& pos);
+	// Occupancy that the renderer sees at `pos`: the max-pooled bit of the finest cascade containing it.
+	bool occupied_at(const Eigen::Vector3f& pos) const;
+
+	// Recomputes the bitfield from the density grid.
+	void update_bitfield(ThreadPool* pool = nullptr);
+	// Recomputes the max-pooled bits of the coarser cascades after the own bits were edited.
+	void update_mips(ThreadPool* pool = nullptr);
+
+	std::vector<OccupancyGridCascadeStats> stats(ThreadPool* pool = nullptr) const;
+
+	// Marks all cells within `radius` cells (in the maximum norm) of an occupied cell as occupied,
+	// e.g. to repair holes that the density EMA punched into thin structures.
+	void dilate(uint32_t radius, ThreadPool* pool = nullptr);
+	// Frees all cells that are within `radius` cells of a free cell, e.g. to remove isolated floaters.
+	// Cells outside of the grid count as occupied, such that geometry which extends beyond a cascade is kept.
+	void erode(uint32_t radius, ThreadPool* pool = nullptr);
+	// Frees all cells whose center lies outside of `aabb`, given in the unit cube that the NeRF is trained in.
+	void crop(const Eigen::AlignedBox3f& aabb, ThreadPool* pool = nullptr);
+
+	// Position of a cell's center in the unit cube that the NeRF is trained in
+	static Eigen::Vector3f cell_center(uint32_t cascade, uint32_t x, uint32_t y, uint32_t z);
+
+private:
+	// Cascade's own bits in row-major order, GRIDSIZE bits per row of fixed y and z.
+	using Volume = std::vector<uint64_t>;
+	static constexpr uint32_t WORDS_PER_ROW = GRIDSIZE / 64;
+
+	Volume extract_volume(uint32_t cascade, ThreadPool* pool) const;
+	void insert_volume(uint32_t cascade, const Volume& volume, ThreadPool* pool);
+	static void dilate_volume(Volume& volume, uint32_t radius, ThreadPool* pool);
+
+	std::vector<float> m_density_grid;
+	// Own bits of each cascade, without max-pooling
+	std::vector<uint8_t> m_own_bits;
+	std::vector<uint8_t> m_bitfield;
+};
+
+NGP_NAMESPACE_END
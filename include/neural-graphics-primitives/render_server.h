@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+/** @file   render_server.h
+ *  @author Thomas Müller, NVIDIA
+ *  @brief  Local render service: a single process hosts several scenes and serves
+ *          progressively refined views to many clients over a Unix socket or localhost TCP.
+ */
+
+#pragma once
+
+#include <neural-graphics-primitives/common.h>
+#include <neural-graphics-primitives/nerf_renderer_cpu.h>
+#include <neural-graphics-primitives/thread_pool.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+NGP_NAMESPACE_BEGIN
+
+// Wire format (all values little endian). Every request is answered by exactly one response.
+//   request:  u32 magic, u32 name_length, char scene[name_length], u32 width, u32 height,
+//             f32 camera[12] (row-major 3x4), f32 fov, f32 zoom, u32 max_spp, u32 format
+//   response: u32 magic, u32 status, u32 spp, u32 width, u32 height, u32 format, u32 size, u8 payload[size]
+// Repeating a request with an unchanged view refines the client's image by further samples until
+// `max_spp` samples were accumulated. If the status is not Ok, the payload holds an error message.
+static constexpr uint32_t RENDER_SERVER_MAGIC = 0x5350474e; // "NGPS"
+
+enum class ERenderServerFormat : uint32_t {
+	Png = 0, // 8 bit sRGB RGBA, PNG compressed
+	Rgba8 = 1, // 8 bit sRGB RGBA, uncompressed
+	Float = 2, // linear, alpha-premultiplied float RGBA
+};
+
+enum class ERenderServerStatus : uint32_t {
+	Ok = 0,
+	Busy = 1, // Rejected by admission control; the client may retry later.
+	UnknownScene = 2,
+	InvalidRequest = 3,
+	Error = 4,
+};
+
+struct RenderServerRequest {
+	std::string scene;
+	Eigen::Vector2i resolution = {1280, 720};
+	Eigen::Matrix<float, 3, 4> camera_matrix = Eigen::Matrix<float, 3, 4>::Identity();
+	// Field of view along the vertical axis in degrees. The default corresponds to
+	// the Testbed's default relative focal length of 1.
+	float fov = 53.130102f;
+	// Magnification of the orthographic projection (Testbed::m_zoom)
+	float zoom = 1.0f;
+	uint32_t max_spp = 16;
+	ERenderServerFormat format = ERenderServerFormat::Png;
+
+	bool same_view(const RenderServerRequest& other) const {
+		return scene == other.scene && resolution == other.resolution && camera_matrix == other.camera_matrix && fov == other.fov && zoom == other.zoom;
+	}
+
+	Eigen::Vector2f focal_length() const;
+};
+
+struct RenderServerResponse {
+	ERenderServerStatus status = ERenderServerStatus::Ok;
+	// Number of samples per pixel that the image accumulates.
+	uint32_t spp = 0;
+	Eigen::Vector2i resolution = Eigen::Vector2i::Zero();
+	ERenderServerFormat format = ERenderServerFormat::Png;
+	std::vector<uint8_t> payload;
+
+	std::string error() const {
+		return status == ERenderServerStatus::Ok ? std::string{} : std::string{payload.begin(), payload.end()};
+	}
+};
+
+// One client's view within a coalesced batch.
+struct RenderServerView {
+	const RenderServerRequest* request;
+	uint32_t client;
+	uint32_t spp_offset;
+	uint32_t spp;
+	// Holds the average of the view's first `spp_offset` samples and must be updated to
+	// the average of the first `spp_offset + spp` samples (linear, alpha-premultiplied RGBA).
+	float* rgba;
+};
+
+// A scene hosted by the server. All calls are made from one thread at a time.
+class RenderServerScene {
+public:
+	virtual ~RenderServerScene() = default;
+
+	// Renders all views of a batch. Every view shows this scene.
+	virtual void render(const std::vector<RenderServerView>& views, ThreadPool& pool) = 0;
+
+	// Frees per-client state after the client disconnected.
+	virtual void release_client(uint32_t client) {}
+};
+
+class CpuRenderServerScene : public RenderServerScene {
+public:
+	// `settings` supplies everything but the camera, resolution, focal length and spp.
+	CpuRenderServerScene(const std::string& snapshot_path, const CpuNerfRenderSettings& settings = {});
+
+	void render(const std::vector<RenderServerView>& views, ThreadPool& pool) override;
+
+private:
+	CpuNerfRenderer m_renderer;
+	CpuNerfRenderSettings m_settings;
+	std::vector<float> m_samples;
+};
+
+struct RenderServerSettings {
+	// "unix:<path>" for a Unix domain socket, otherwise a TCP port on 127.0.0.1.
+	std::string address = "unix:/tmp/ngp_render.sock";
+	// Samples per pixel by which a view is refined per request.
+	uint32_t spp_per_pass = 1;
+	uint32_t max_spp = 1024;
+	uint32_t max_pixels = 4096 * 4096;
+
+	// Admission control: further connections are refused and further requests are answered with
+	// ERenderServerStatus::Busy once these limits are reached.
+	uint32_t max_clients = 64;
+	uint32_t max_pending = 32;
+
+	// Maximum number of views of the same scene that are coalesced into one batch.
+	uint32_t max_batch_views = 16;
+};
+
+struct RenderServerStats {
+	std::atomic<uint64_t> n_requests{0};
+	std::atomic<uint64_t> n_rejected{0};
+	std::atomic<uint64_t> n_batches{0};
+	std::atomic<uint64_t> n_views{0};
+};
+
+class RenderServer {
+public:
+	RenderServer(const RenderServerSettings& settings);
+	~RenderServer();
+
+	RenderServer(const RenderServer&) = delete;
+	RenderServer& operator=(const RenderServer&) = delete;
+
+	void add_scene(const std::string& name, std::shared_ptr<RenderServerScene> scene);
+
+	// Starts listening and serving requests on background threads.
+	void start();
+	// Disconnects all clients and waits for the background threads.
+	void stop();
+
+	const RenderServerSettings& settings() const { return m_settings; }
+	const RenderServerStats& stats() const { return m_stats; }
+
+private:
+	struct Client;
+	struct Job;
+
+	void accept_loop();
+	void client_loop(Client& client);
+	void dispatch_loop();
+	RenderServerResponse handle_request(Client& client, const RenderServerRequest& request);
+	void reap_clients(bool all);
+
+	RenderServerSettings m_settings;
+	RenderServerStats m_stats;
+
+	std::mutex m_scenes_mutex;
+	std::map<std::string, std::shared_ptr<RenderServerScene>> m_scenes;
+
+	int m_listen_socket = -1;
+	std::thread m_accept_thread;
+	std::thread m_dispatch_thread;
+	std::atomic<bool> m_stopping{false};
+
+	std::mutex m_clients_mutex;
+	std::map<uint32_t, std::unique_ptr<Client>> m_clients;
+	uint32_t m_next_client_id = 0;
+
+	// Pending jobs are coalesced into batches by the dispatch thread.
+	std::mutex m_jobs_mutex;
+	std::condition_variable m_jobs_condition;
+	std::deque<Job*> m_jobs;
+
+	// Held while a scene is called into.
+	std::mutex m_render_mutex;
+
+	ThreadPool m_pool;
+};
+
+// Blocking client of a RenderServer, e.g. for previews and tests.
+class RenderClient {
+public:
+	RenderClient(const std::string& address);
+	~RenderClient();
+
+	RenderClient(const RenderClient&) = delete;
+	RenderClient& operator=(const RenderClient&) = delete;
+
+	RenderServerResponse render(const RenderServerRequest& request);
+
+private:
+	int m_socket = -1;
+};
+
+NGP_NAMESPACE_END
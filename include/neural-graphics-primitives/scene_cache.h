@@ -0,0 +1,310 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+/** @file   scene_cache.h
+ *  @author Thomas Müller, NVIDIA
+ *  @brief  Keeps several snapshots resident under a memory budget, evicts the least
+ *          recently used ones to a host tier, and prefetches scenes that are likely to be used next.
+ */
+
+#pragma once
+
+#include <neural-graphics-primitives/common.h>
+#include <neural-graphics-primitives/nerf_network_cpu.h>
+#include <neural-graphics-primitives/thread_pool.h>
+
+#include <json/json.hpp>
+
+#include <fstream>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+NGP_NAMESPACE_BEGIN
+
+enum class ESceneTier : int {
+	Disk, // Only the snapshot file exists.
+	Host, // The parsed snapshot is held in host memory.
+	Resident, // The scene is loaded for rendering. Its parsed snapshot is kept in host memory, too.
+};
+
+// Accounting and eviction policy of SceneCache. Holds no scene data, such that it can be used
+// and tested without loading any snapshots.
+class SceneCachePolicy {
+public:
+	struct Entry {
+		ESceneTier tier = ESceneTier::Disk;
+		size_t host_bytes = 0;
+		size_t resident_bytes = 0;
+		uint64_t last_use = 0;
+	};
+
+	struct Demotion {
+		std::string name;
+		ESceneTier tier;
+	};
+
+	SceneCachePolicy(size_t resident_budget, size_t host_budget) : m_resident_budget{resident_budget}, m_host_budget{host_budget} {}
+
+	// `host_bytes` is the memory that the parsed snapshot occupies in the host tier.
+	void add(const std::string& name, size_t host_bytes);
+	bool contains(const std::string& name) const { return m_entries.count(name) > 0; }
+	const Entry& entry(const std::string& name) const;
+
+	// Records an access of `name`. Accesses of different scenes in succession train the prediction of successors.
+	void touch(const std::string& name);
+
+	// Moves `name` to `tier` (scenes are never demoted by this call) and returns the least recently used scenes
+	// that have to be demoted to respect the budgets, in the order in which they have to be demoted. `name` itself
+	// is never demoted, even if it exceeds a budget on its own.
+	std::vector<Demotion> promote(const std::string& name, ESceneTier tier, size_t resident_bytes = 0);
+
+	// Moves `name` to a lower tier.
+	void demote(const std::string& name, ESceneTier tier);
+
+	// Whether `bytes` fit into the host tier without demoting other scenes.
+	bool host_fits(size_t bytes) const { return m_host_bytes + bytes <= m_host_budget; }
+
+	// The up to `n` scenes that most frequently followed `name`.
+	std::vector<std::string> predict_successors(const std::string& name, size_t n) const;
+
+	size_t resident_bytes() const { return m_resident_bytes; }
+	size_t host_bytes() const { return m_host_bytes; }
+	size_t resident_budget() const { return m_resident_budget; }
+	size_t host_budget() const { return m_host_budget; }
+
+private:
+	void set_tier(Entry& entry, ESceneTier tier);
+	// Least recently used scene of at least `tier` other than `except`, or end().
+	std::map<std::string, Entry>::iterator least_recently_used(ESceneTier tier, const std::string& except);
+
+	size_t m_resident_budget;
+	size_t m_host_budget;
+	size_t m_resident_bytes = 0;
+	size_t m_host_bytes = 0;
+
+	std::map<std::string, Entry> m_entries;
+	std::map<std::string, std::map<std::string, uint32_t>> m_successors;
+	std::string m_last_touched;
+	uint64_t m_clock = 0;
+};
+
+struct SceneCacheSettings {
+	size_t resident_budget = (size_t)4 << 30;
+	size_t host_budget = (size_t)16 << 30;
+	// Number of predicted successors of a used scene that are prefetched into the host tier.
+	uint32_t n_prefetch = 1;
+	uint32_t n_threads = 2;
+};
+
+// Caches scenes of type T, e.g. CpuNerfRenderer. `load` creates a resident scene from a parsed snapshot and
+// `resident_bytes` reports how much memory it occupies. Scenes that are still referenced by a caller stay
+// alive after their eviction but no longer count against the budget. Thread-safe.
+template <typename T>
+class SceneCache {
+public:
+	using load_t = std::function<std::shared_ptr<T>(const nlohmann::json&)>;
+	using resident_bytes_t = std::function<size_t(const T&)>;
+
+	SceneCache(const SceneCacheSettings& settings, const load_t& load, const resident_bytes_t& resident_bytes)
+	: m_settings{settings}, m_policy{settings.resident_budget, settings.host_budget}, m_load{load}, m_resident_bytes{resident_bytes}, m_pool{settings.n_threads} {}
+
+	~SceneCache() {
+		// Loads reference this cache
+		m_pool.waitUntilFinished();
+	}
+
+	SceneCache(const SceneCache&) = delete;
+	SceneCache& operator=(const SceneCache&) = delete;
+
+	// Registers a snapshot file under `name`. Its size serves as the estimate of the host memory it occupies once parsed.
+	void add(const std::string& name, const std::string& path) {
+		std::ifstream f{path, std::ios::in | std::ios::binary | std::ios::ate};
+		if (!f) {
+			throw std::runtime_error{"Snapshot \"" + path + "\" does not exist."};
+		}
+
+		std::lock_guard<std::mutex> lock{m_mutex};
+		Scene& scene = m_scenes[name];
+		scene.path = path;
+		scene.snapshot.reset();
+		scene.resident.reset();
+		m_policy.add(name, (size_t)f.tellg());
+	}
+
+	// Returns the resident scene, loading it if necessary, and prefetches its predicted successors.
+	std::shared_ptr<T> get(const std::string& name) {
+		std::unique_lock<std::mutex> lock{m_mutex};
+		Scene& scene = find(name);
+		m_policy.touch(name);
+
+		if (!scene.resident) {
+			auto snapshot = host_snapshot(name, lock);
+
+			lock.unlock();
+			std::shared_ptr<T> resident = m_load(*snapshot);
+			size_t bytes = m_resident_bytes(*resident);
+			lock.lock();
+
+			// Another thread may have loaded the scene in the meantime
+			if (!scene.resident) {
+				scene.resident = resident;
+				if (!scene.snapshot) {
+					scene.snapshot = snapshot;
+				}
+				apply(m_policy.promote(name, ESceneTier::Resident, bytes));
+			}
+		}
+
+		std::shared_ptr<T> result = scene.resident;
+		prefetch_successors(name);
+		return result;
+	}
+
+	// Returns the parsed snapshot, e.g. for Testbed::load_snapshot, without making the scene resident.
+	std::shared_ptr<const nlohmann::json> snapshot(const std::string& name) {
+		std::unique_lock<std::mutex> lock{m_mutex};
+		find(name);
+		m_policy.touch(name);
+
+		auto result = host_snapshot(name, lock);
+		prefetch_successors(name);
+		return result;
+	}
+
+	// Starts loading the snapshot of `name` into the host tier in the background if it fits without evictions.
+	void prefetch(const std::string& name) {
+		std::lock_guard<std::mutex> lock{m_mutex};
+		find(name);
+		prefetch_locked(name);
+	}
+
+	// Waits until all prefetches finished.
+	void wait() {
+		m_pool.waitUntilFinished();
+	}
+
+	ESceneTier tier(const std::string& name) const {
+		std::lock_guard<std::mutex> lock{m_mutex};
+		return m_policy.entry(name).tier;
+	}
+
+	size_t resident_bytes() const {
+		std::lock_guard<std::mutex> lock{m_mutex};
+		return m_policy.resident_bytes();
+	}
+
+	size_t host_bytes() const {
+		std::lock_guard<std::mutex> lock{m_mutex};
+		return m_policy.host_bytes();
+	}
+
+	const SceneCacheSettings& settings() const { return m_settings; }
+
+private:
+	using snapshot_ptr = std::shared_ptr<const nlohmann::json>;
+
+	struct Scene {
+		std::string path;
+		snapshot_ptr snapshot;
+		std::shared_future<snapshot_ptr> pending;
+		std::shared_ptr<T> resident;
+	};
+
+	Scene& find(const std::string& name) {
+		auto it = m_scenes.find(name);
+		if (it == m_scenes.end()) {
+			throw std::runtime_error{"Unknown scene \"" + name + "\"."};
+		}
+		return it->second;
+	}
+
+	// Starts loading the snapshot into the host tier unless that already happens.
+	std::shared_future<snapshot_ptr> load_snapshot(const std::string& name, bool high_priority) {
+		Scene& scene = m_scenes.at(name);
+		if (!scene.pending.valid()) {
+			std::string path = scene.path;
+			scene.pending = m_pool.enqueueTask([this, name, path]() {
+				snapshot_ptr snapshot;
+				try {
+					snapshot = std::make_shared<const nlohmann::json>(CpuNerfNetwork::read_snapshot(path));
+				} catch (...) {
+					std::lock_guard<std::mutex> lock{m_mutex};
+					m_scenes.at(name).pending = {};
+					throw;
+				}
+
+				std::lock_guard<std::mutex> lock{m_mutex};
+				Scene& scene = m_scenes.at(name);
+				scene.pending = {};
+				if (!scene.snapshot) {
+					scene.snapshot = snapshot;
+					apply(m_policy.promote(name, ESceneTier::Host));
+				}
+				return snapshot;
+			}, high_priority).share();
+		}
+
+		return scene.pending;
+	}
+
+	snapshot_ptr host_snapshot(const std::string& name, std::unique_lock<std::mutex>& lock) {
+		Scene& scene = m_scenes.at(name);
+		if (scene.snapshot) {
+			return scene.snapshot;
+		}
+
+		// Demanded loads overtake prefetches
+		auto pending = load_snapshot(name, true);
+		lock.unlock();
+		snapshot_ptr result = pending.get();
+		lock.lock();
+		return result;
+	}
+
+	void prefetch_locked(const std::string& name) {
+		const auto& entry = m_policy.entry(name);
+		if (entry.tier == ESceneTier::Disk && !m_scenes.at(name).pending.valid() && m_policy.host_fits(entry.host_bytes)) {
+			load_snapshot(name, false);
+		}
+	}
+
+	void prefetch_successors(const std::string& name) {
+		for (const auto& successor : m_policy.predict_successors(name, m_settings.n_prefetch)) {
+			prefetch_locked(successor);
+		}
+	}
+
+	void apply(const std::vector<SceneCachePolicy::Demotion>& demotions) {
+		for (const auto& demotion : demotions) {
+			Scene& scene = m_scenes.at(demotion.name);
+			scene.resident.reset();
+			if (demotion.tier == ESceneTier::Disk) {
+				scene.snapshot.reset();
+			}
+		}
+	}
+
+	SceneCacheSettings m_settings;
+
+	mutable std::mutex m_mutex;
+	SceneCachePolicy m_policy;
+	std::map<std::string, Scene> m_scenes;
+
+	load_t m_load;
+	resident_bytes_t m_resident_bytes;
+
+	ThreadPool m_pool;
+};
+
+NGP_NAMESPACE_END
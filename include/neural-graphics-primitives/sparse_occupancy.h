@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+/** @file   sparse_occupancy.h
+ *  @author Thomas Müller, NVIDIA
+ *  @brief  Two-level brick map of occupancy bits: a top-level grid of brick indices over the scene and
+ *          8³-cell bricks that are only stored where the scene is partially occupied. Memory scales with
+ *          the occupied surface rather than with the volume, so the resolution can exceed the 128³ cascades.
+ */
+
+#pragma once
+
+#include <neural-graphics-primitives/common.h>
+#include <neural-graphics-primitives/nerf_network_cpu.h>
+#include <neural-graphics-primitives/occupancy_grid.h>
+#include <neural-graphics-primitives/thread_pool.h>
+
+#include <functional>
+#include <vector>
+
+NGP_NAMESPACE_BEGIN
+
+static constexpr uint32_t SPARSE_OCCUPANCY_BRICK_SIZE = 8;
+// One bit per cell of a brick: word z, bit x + 8*y
+static constexpr uint32_t SPARSE_OCCUPANCY_BRICK_WORDS = 8;
+// Top-level entries of bricks without a free or without an occupied cell. Such bricks are not stored.
+static constexpr uint32_t SPARSE_OCCUPANCY_EMPTY_BRICK = 0xFFFFFFFFu;
+static constexpr uint32_t SPARSE_OCCUPANCY_FULL_BRICK = 0xFFFFFFFEu;
+
+// Non-owning view of a SparseOccupancyGrid that can be passed to kernels once `top` and `bricks` point to device copies.
+struct SparseOccupancyGridView {
+	const uint32_t* top = nullptr; // Brick index per top-level cell, x varying fastest
+	const uint64_t* bricks = nullptr; // SPARSE_OCCUPANCY_BRICK_WORDS per brick
+	Eigen::Vector3i top_resolution = Eigen::Vector3i::Zero();
+	Eigen::Vector3f domain_min = Eigen::Vector3f::Zero();
+	float cell_size = 1.0f;
+
+	NGP_HOST_DEVICE Eigen::Vector3i resolution() const {
+		return top_resolution * (int)SPARSE_OCCUPANCY_BRICK_SIZE;
+	}
+
+	NGP_HOST_DEVICE Eigen::Vector3f domain_max() const {
+		return domain_min + resolution().cast<float>() * cell_size;
+	}
+
+	NGP_HOST_DEVICE uint32_t brick_at(const Eigen::Vector3i& cell) const {
+		return top[(cell.x() >> 3) + top_resolution.x() * ((cell.y() >> 3) + top_resolution.y() * (cell.z() >> 3))];
+	}
+
+	// `cell` must lie within resolution().
+	NGP_HOST_DEVICE bool occupied(const Eigen::Vector3i& cell) const {
+		uint32_t brick = brick_at(cell);
+		if (brick == SPARSE_OCCUPANCY_EMPTY_BRICK) {
+			return false;
+		} else if (brick == SPARSE_OCCUPANCY_FULL_BRICK) {
+			return true;
+		}
+
+		uint32_t bit = (cell.x() & 7) | ((cell.y() & 7) << 3);
+		return (bricks[brick * SPARSE_OCCUPANCY_BRICK_WORDS + (cell.z() & 7)] >> bit) & 1;
+	}
+
+	// False outside of the domain
+	NGP_HOST_DEVICE bool occupied_at(const Eigen::Vector3f& pos) const {
+		Eigen::Vector3f p = (pos - domain_min) / cell_size;
+		Eigen::Vector3i res = resolution();
+		Eigen::Vector3i cell = {(int)floorf(p.x()), (int)floorf(p.y()), (int)floorf(p.z())};
+		if (p.x() < 0.0f || p.y() < 0.0f || p.z() < 0.0f || cell.x() >= res.x() || cell.y() >= res.y() || cell.z() >= res.z()) {
+			return false;
+		}
+		return occupied(cell);
+	}
+
+	// Distance along a ray from `p` (in cells) to where it leaves the aligned block of `size`³ cells that contains `p`
+	NGP_HOST_DEVICE float distance_to_block_exit(const Eigen::Vector3f& p, const Eigen::Vector3f& dir, float size) const {
+		float t = std::numeric_limits<float>::infinity();
+		for (uint32_t i = 0; i < 3; ++i) {
+			if (dir[i] > 0.0f) {
+				t = fminf(t, ((floorf(p[i] / size) + 1.0f) * size - p[i]) / dir[i]);
+			} else if (dir[i] < 0.0f) {
+				t = fminf(t, (floorf(p[i] / size) * size - p[i]) / dir[i]);
+			}
+		}
+		return fmaxf(t, 0.0f) * cell_size;
+	}
+
+	// First `t` in [t, t_max) at which the ray with normalized `dir` is in an occupied cell, or `t_max` if there is none.
+	// Bricks without any occupied cell are crossed in a single step. Every occupancy lookup increments `n_steps`.
+	NGP_HOST_DEVICE float next_occupied(const Eigen::Vector3f& origin, const Eigen::Vector3f& dir, float t, float t_max, uint32_t* n_steps = nullptr) const {
+		// Clip to the domain
+		Eigen::Vector3f domain_max = this->domain_max();
+		float t_end = t_max;
+		for (uint32_t i = 0; i < 3; ++i) {
+			if (dir[i] == 0.0f) {
+				if (origin[i] < domain_min[i] || origin[i] > domain_max[i]) {
+					return t_max;
+				}
+				continue;
+			}
+
+			float t0 = (domain_min[i] - origin[i]) / dir[i];
+			float t1 = (domain_max[i] - origin[i]) / dir[i];
+			t = fmaxf(t, fminf(t0, t1));
+			t_end = fminf(t_end, fmaxf(t0, t1));
+		}
+
+		// Advances slightly beyond the exit of a block to not land on its boundary
+		const float epsilon = 1e-3f * cell_size;
+		const Eigen::Vector3i max_cell = resolution() - Eigen::Vector3i::Ones();
+
+		while (t < t_end) {
+			Eigen::Vector3f p = (origin + dir * t - domain_min) / cell_size;
+			Eigen::Vector3i cell = {(int)floorf(p.x()), (int)floorf(p.y()), (int)floorf(p.z())};
+			cell = cell.cwiseMax(0).cwiseMin(max_cell);
+
+			if (n_steps) {
+				++*n_steps;
+			}
+
+			uint32_t brick = brick_at(cell);
+			float size = 1.0f;
+			if (brick == SPARSE_OCCUPANCY_EMPTY_BRICK) {
+				size = (float)SPARSE_OCCUPANCY_BRICK_SIZE;
+			} else if (occupied(cell)) {
+				return t;
+			}
+
+			t += distance_to_block_exit(p, dir, size) + epsilon;
+		}
+
+		return t_max;
+	}
+
+	// Distance from `t` to where the ray leaves the cell that it is in at `t`, e.g. to continue traversal past an occupied cell.
+	NGP_HOST_DEVICE float distance_to_next_cell(const Eigen::Vector3f& origin, const Eigen::Vector3f& dir, float t) const {
+		return distance_to_block_exit((origin + dir * t - domain_min) / cell_size, dir, 1.0f) + 1e-3f * cell_size;
+	}
+};
+
+class SparseOccupancyGrid {
+public:
+	// Writes whether each of `n` positions is occupied into `occupied`. Called concurrently from several threads.
+	using occupancy_fun_t = std::function<void(uint32_t n, const Eigen::Vector3f* positions, uint8_t* occupied)>;
+
+	SparseOccupancyGrid() = default;
+	// Cubic cells covering `domain` with `resolution` cells along its longest side. Every side is rounded up to whole bricks.
+	SparseOccupancyGrid(const Eigen::AlignedBox3f& domain, uint32_t resolution);
+
+	// Cells whose center is occupied in `coarse` (see OccupancyGrid::occupied_at) and, if given, according to `fun`.
+	// `fun` is only evaluated for the cells that are occupied in `coarse`.
+	void build(const OccupancyGrid& coarse, const occupancy_fun_t& fun = {}, ThreadPool* pool = nullptr);
+
+	// Refines `coarse` by the density of the network at the cell centers: cells are occupied if their optical
+	// thickness at the finest step size exceeds `min_optical_thickness`, as in update_density_grid_nerf().
+	// `aabb` is the bounding box that the network's positions are warped by (CpuNerfRenderer::aabb()).
+	void build(
+		const OccupancyGrid& coarse,
+		const CpuNerfNetwork& network,
+		const Eigen::AlignedBox3f& aabb,
+		float min_optical_thickness = OccupancyGrid::MIN_OPTICAL_THICKNESS,
+		ENerfActivation density_activation = ENerfActivation::Exponential,
+		ThreadPool* pool = nullptr
+	);
+
+	SparseOccupancyGridView view() const {
+		return {m_top.data(), m_bricks.data(), m_top_resolution, m_domain_min, m_cell_size};
+	}
+
+	// Host copies of the two levels, e.g. to upload them for a device-side view.
+	const std::vector<uint32_t>& top() const { return m_top; }
+	const std::vector<uint64_t>& bricks() const { return m_bricks; }
+
+	Eigen::Vector3i resolution() const { return m_top_resolution * (int)SPARSE_OCCUPANCY_BRICK_SIZE; }
+	Eigen::AlignedBox3f domain() const { return {m_domain_min, view().domain_max()}; }
+	float cell_size() const { return m_cell_size; }
+
+	size_t n_bricks() const { return m_bricks.size() / SPARSE_OCCUPANCY_BRICK_WORDS; }
+	size_t n_full_bricks() const { return m_n_full_bricks; }
+	size_t n_occupied_cells() const { return m_n_occupied_cells; }
+
+	size_t memory_bytes() const {
+		return m_top.size() * sizeof(uint32_t) + m_bricks.size() * sizeof(uint64_t);
+	}
+
+private:
+	std::vector<uint32_t> m_top;
+	std::vector<uint64_t> m_bricks;
+	Eigen::Vector3i m_top_resolution = Eigen::Vector3i::Zero();
+	Eigen::Vector3f m_domain_min = Eigen::Vector3f::Zero();
+	float m_cell_size = 1.0f;
+
+	size_t m_n_full_bricks = 0;
+	size_t m_n_occupied_cells = 0;
+};
+
+// Traverses the same rays through the dense cascades and the sparse grid with DDA. Occupied cells
+// are stepped through one at a time, empty space is skipped cell by cell in the dense cascades and
+// brick by brick in the sparse grid. The rays start outside of the sparse grid's domain and aim at
+// uniformly distributed points within it.
+struct OccupancyTraversalBenchmark {
+	uint32_t n_rays = 0;
+
+	// Occupancy lookups and occupied cells per ray
+	double steps_per_ray_dense = 0.0;
+	double steps_per_ray_sparse = 0.0;
+	double occupied_per_ray_dense = 0.0;
+	double occupied_per_ray_sparse = 0.0;
+
+	// Single-threaded traversal time
+	double ns_per_ray_dense = 0.0;
+	double ns_per_ray_sparse = 0.0;
+
+	size_t memory_bytes_dense_bitfield = 0;
+	size_t memory_bytes_dense_density_grid = 0;
+	size_t memory_bytes_sparse = 0;
+};
+
+OccupancyTraversalBenchmark benchmark_occupancy_traversal(const OccupancyGrid& dense, const SparseOccupancyGrid& sparse, uint32_t n_rays = 1 << 16, uint32_t seed = 1337);
+
+NGP_NAMESPACE_END
@@ -15,8 +15,12 @@
 #pragma once
 
 #include <neural-graphics-primitives/adam_optimizer.h>
+#include <neural-graphics-primitives/alias_table.h>
+#include <neural-graphics-primitives/batch_size_controller.h>
 #include <neural-graphics-primitives/camera_path.h>
+#include <neural-graphics-primitives/camera_undistortion.h>
 #include <neural-graphics-primitives/common.h>
+#include <neural-graphics-primitives/deferred_readback.h>
 #include <neural-graphics-primitives/discrete_distribution.h>
 #include <neural-graphics-primitives/nerf.h>
 #include <neural-graphics-primitives/nerf_loader.h>
@@ -131,6 +135,7 @@ public:
 			const Eigen::Vector2i& distortion_resolution,
 			Eigen::Array4f* frame_buffer,
 			uint8_t *grid,
+			const uint8_t* grid_distance,
 			int show_accel,
 			float cone_angle_constant,
 			ERenderMode render_mode,
@@ -146,6 +151,7 @@ public:
 			const Eigen::Vector2f& focal_length,
 			float cone_angle_constant,
 			const uint8_t* grid,
+			const uint8_t* grid_distance,
 			ERenderMode render_mode,
 			const Eigen::Matrix<float, 3, 4> &camera_matrix,
 			float depth_scale,
@@ -246,6 +252,8 @@ public:
 	static ELossType string_to_loss_type(const std::string& str);
 	void reset_network();
 	void update_nerf_focal_lengths();
+	// (Re-)builds the camera undistortion map if the dataset's lens distortion changed and returns its lookup.
+	CameraUndistortion update_nerf_camera_undistortion();
 	void update_nerf_transforms();
 	void load_nerf();
 	void load_mesh();
@@ -274,8 +282,12 @@ public:
 	void generate_training_samples_sdf(Eigen::Vector3f* positions, float* distances, uint32_t n_to_generate, cudaStream_t stream, bool uniform_only);
 	void update_density_grid_nerf(float decay, uint32_t n_uniform_density_grid_samples, uint32_t n_nonuniform_density_grid_samples, cudaStream_t stream);
 	void update_density_grid_mean_and_bitfield(cudaStream_t stream);
+	void update_density_grid_distance(cudaStream_t stream);
 	void train_nerf(uint32_t target_batch_size, uint32_t n_training_steps, cudaStream_t stream);
 	void train_nerf_step(uint32_t target_batch_size, uint32_t n_rays_per_batch, uint32_t* counter, uint32_t* compacted_counter, float* loss, cudaStream_t stream);
+	// Adapts the batch size and loss to the statistics of a past train_nerf call. Returns false if training must stop.
+	bool consume_nerf_training_stats(const NerfTrainingStats& stats, const NerfTrainingStatsContext& context);
+	bool defers_training_stats() const;
 	void train_sdf(size_t target_batch_size, size_t n_steps, cudaStream_t stream);
 	void train_image(size_t target_batch_size, size_t n_steps, cudaStream_t stream);
 	void set_train(bool mtrain);
@@ -302,8 +314,9 @@ public:
 
 #ifdef NGP_PYTHON
 	pybind11::dict compute_marching_cubes_mesh(Eigen::Vector3i res3d = Eigen::Vector3i::Constant(128), BoundingBox aabb = BoundingBox{Eigen::Vector3f::Zero(), Eigen::Vector3f::Ones()}, float thresh=2.5f);
-	pybind11::array_t<float> render_to_cpu(int width, int height, int spp, bool linear, float start_t, float end_t, float fps, float shutter_fraction);
-	pybind11::array_t<float> screenshot(bool linear) const;
+	pybind11::array_t<float> render_to_cpu(int width, int height, int spp, bool linear, float start_t, float end_t, float fps, float shutter_fraction, pybind11::object out);
+	pybind11::object render_batch_to_cpu(pybind11::array_t<float, pybind11::array::c_style | pybind11::array::forcecast> camera_matrices, std::vector<Eigen::Vector2i> resolutions, std::vector<uint32_t> spps, bool linear, pybind11::object out);
+	pybind11::array_t<float> screenshot(bool linear, pybind11::object out) const;
 	void override_sdf_training_data(pybind11::array_t<float> points, pybind11::array_t<float> distances);
 #endif
 
@@ -331,9 +344,15 @@ public:
 	void set_fov_xy(const Eigen::Vector2f& val);
 	void save_snapshot(const std::string& filepath_string, bool include_optimizer_state);
 	void load_snapshot(const std::string& filepath_string);
+	// Loads an already parsed snapshot, e.g. from the host tier of a SceneCache.
+	void load_snapshot(const nlohmann::json& config);
 	CameraKeyframe copy_camera_to_keyframe() const;
 	void set_camera_from_keyframe(const CameraKeyframe& k);
 	void set_camera_from_time(float t);
+	// Accumulates `spp` samples of the camera path frame from `start_time` to `end_time` into `render_buffer`,
+	// distributing them across `shutter_fraction` of the frame for motion blur. A negative `start_time`
+	// renders the current camera instead.
+	void render_camera_path_frame(CudaRenderBuffer& render_buffer, int spp, bool to_srgb, float start_time, float end_time, float fps, float shutter_fraction);
 	void update_loss_graph();
 	void load_camera_path(const std::string& filepath_string);
 
@@ -437,18 +456,26 @@ public:
 
 			struct ErrorMap {
 				tcnn::GPUMemory<float> data;
-				tcnn::GPUMemory<float> cdf_x_cond_y;
-				tcnn::GPUMemory<float> cdf_y;
-				tcnn::GPUMemory<float> cdf_img;
+				// Alias tables for sampling proportionally to the error: one per row of cells, per image, and across images
+				tcnn::GPUMemory<AliasEntry> alias_x_cond_y;
+				tcnn::GPUMemory<AliasEntry> alias_y;
+				tcnn::GPUMemory<AliasEntry> alias_img;
+				tcnn::GPUMemory<float> row_sums;
+				tcnn::GPUMemory<float> image_sums;
 				std::vector<float> pmf_img_cpu;
 				Eigen::Vector2i resolution = {16, 16};
-				Eigen::Vector2i cdf_resolution = {16, 16};
-				bool is_cdf_valid = false;
+				Eigen::Vector2i alias_resolution = {16, 16};
+				bool is_alias_valid = false;
 			} error_map;
 
 			std::vector<Eigen::Vector2f> focal_lengths;
 			tcnn::GPUMemory<Eigen::Vector2f> focal_lengths_gpu;
 
+			// Replaces the iterative inversion of the dataset's lens distortion per training ray by a lookup.
+			CameraUndistortionMap camera_undistortion;
+			tcnn::GPUMemory<float> camera_undistortion_gpu;
+			bool use_camera_undistortion_map = true;
+
 			std::vector<Eigen::Matrix<float, 3, 4>> transforms;
 			tcnn::GPUMemory<Eigen::Matrix<float, 3, 4>> transforms_gpu;
 
@@ -465,9 +492,11 @@ public:
 			Eigen::Vector2f cam_focal_length_gradient = Eigen::Vector2f::Zero();
 			tcnn::GPUMemory<Eigen::Vector2f> cam_focal_length_gradient_gpu;
 
-			std::vector<AdamOptimizer<Eigen::Array3f>> cam_exposure;
-			std::vector<AdamOptimizer<Eigen::Vector3f>> cam_pos_offset;
-			std::vector<RotationAdamOptimizer> cam_rot_offset;
+			BatchAdamOptimizer cam_exposure = BatchAdamOptimizer(3, 1e-3f);
+			BatchAdamOptimizer cam_pos_offset = BatchAdamOptimizer(3, 1e-4f);
+			BatchRotationAdamOptimizer cam_rot_offset = BatchRotationAdamOptimizer(1e-4f);
+			// Splits the steps of the above optimizers if there are very many cameras
+			std::unique_ptr<ThreadPool> cam_update_pool;
 			AdamOptimizer<Eigen::Vector2f> cam_focal_length_offset = AdamOptimizer<Eigen::Vector2f>(0.f);
 
 			tcnn::GPUMemory<uint32_t> numsteps_counter; // number of steps each ray took
@@ -479,6 +508,14 @@ public:
 			uint32_t n_rays_total = 0;
 			uint32_t measured_batch_size = 0;
 			uint32_t measured_batch_size_before_compaction = 0;
+			BatchSizeController batch_size_controller;
+
+			// Number of train_nerf calls after which the sample counters and loss of a call are read back. While
+			// nonzero, training does not wait for the GPU, such that the host can enqueue several calls ahead.
+			uint32_t deferred_stats_lag = 0;
+			tcnn::GPUMemory<float> loss_sum;
+			tcnn::GPUMemory<NerfTrainingStats> stats;
+			DeferredReadback<NerfTrainingStats, NerfTrainingStatsContext> deferred_stats;
 			bool random_bg_color = true;
 			bool linear_colors = false;
 			ELossType loss_type = ELossType::L2;
@@ -512,6 +549,15 @@ public:
 		tcnn::GPUMemory<float> density_grid; // NERF_GRIDSIZE()^3 grid of EMA smoothed densities from the network
 		tcnn::GPUMemory<uint8_t> density_grid_bitfield;
 		uint8_t* get_density_grid_bitfield_mip(uint32_t mip);
+
+		// Chebyshev distance of every cell of the bitfield to the nearest occupied cell (see occupancy_distance_field.h),
+		// by which the marching loops skip blocks of empty cells. Kept up to date with the bitfield even while unused.
+		tcnn::GPUMemory<uint8_t> density_grid_distance;
+		tcnn::GPUMemory<uint8_t> density_grid_distance_xy;
+		tcnn::GPUMemory<uint8_t> density_grid_distance_bitfield; // Bits that the distances correspond to
+		tcnn::GPUMemory<uint8_t> density_grid_distance_dirty_slices;
+		bool skip_empty_space = true;
+		const uint8_t* get_density_grid_distance();
 		tcnn::GPUMemory<float> density_grid_mean;
 		uint32_t density_grid_ema_step = 0;
 
@@ -701,6 +747,18 @@ public:
 	default_rng_t m_rng;
 
 	CudaRenderBuffer m_windowless_render_surface{std::make_shared<CudaSurface2D>()};
+	// Second render target of Testbed::render_batch_to_cpu, which alternates between the two
+	CudaRenderBuffer m_batch_render_surface{std::make_shared<CudaSurface2D>()};
+
+	// Host memory backing the numpy arrays returned by the python bindings. Each array holds a
+	// reference to its buffer, so a buffer is only reused once python no longer references it.
+	struct PythonStagingBuffers {
+		std::shared_ptr<std::vector<float>> render;
+		std::shared_ptr<std::vector<float>> mesh_verts;
+		std::shared_ptr<std::vector<float>> mesh_normals;
+		std::shared_ptr<std::vector<float>> mesh_colors;
+		std::shared_ptr<std::vector<int>> mesh_indices;
+	} m_python_staging;
 
 	uint32_t network_width(uint32_t layer) const;
 	uint32_t network_num_forward_activations() const;
@@ -64,6 +64,10 @@ public:
     void startThreads(size_t num);
     void shutdownThreads(size_t num);
 
+    size_t numThreads() const {
+        return mNumThreads;
+    }
+
     size_t numTasksInSystem() const {
         return mNumTasksInSystem;
     }
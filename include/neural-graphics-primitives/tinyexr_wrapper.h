@@ -22,6 +22,8 @@ NGP_NAMESPACE_BEGIN
 
 void save_exr(const float* data, int width, int height, int nChannels, int channelStride, const char* outfilename);
 void load_exr(float** data, int* width, int* height, const char* filename);
+#ifdef __CUDACC__
 __half* load_exr_to_gpu(int* width, int* height, const char* filename, bool fix_premult);
+#endif
 
 NGP_NAMESPACE_END
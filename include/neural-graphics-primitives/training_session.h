@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+/** @file   training_session.h
+ *  @author Thomas Müller, NVIDIA
+ *  @brief  Runs Testbed::train on a background thread, such that the host can
+ *          render, export meshes, or perform I/O while training progresses.
+ */
+
+#pragma once
+
+#include <neural-graphics-primitives/common.h>
+#include <neural-graphics-primitives/thread_pool.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+NGP_NAMESPACE_BEGIN
+
+class Testbed;
+
+class TrainingSession {
+public:
+	// Called with the current training step and loss.
+	using hook_t = std::function<void(uint32_t, float)>;
+
+	TrainingSession(Testbed& testbed, uint32_t batch_size = 1<<18, uint32_t steps_per_call = 16);
+	~TrainingSession();
+
+	TrainingSession(const TrainingSession&) = delete;
+	TrainingSession& operator=(const TrainingSession&) = delete;
+
+	// Trains until `n_steps` additional steps were taken (0: until stopped).
+	void start(uint32_t n_steps = 0);
+	// Asks the training thread to stop after its current call to Testbed::train and waits for it.
+	void stop();
+	// Waits until training finished. Rethrows exceptions that occurred on the training thread.
+	void wait();
+	// Returns whether training is still in progress. Rethrows exceptions of the training thread.
+	bool poll();
+
+	// While a pause is active, the training thread does not touch the testbed, which may then
+	// safely be used from other threads. Pauses nest.
+	void pause();
+	void resume();
+
+	// Saves a snapshot every `interval` steps from the training thread. `path` may contain
+	// "{step}", which is replaced by the current training step. An interval of 0 disables snapshots.
+	void set_snapshot(const std::string& path, uint32_t interval);
+
+	// Invokes `hook` every `interval` steps on a dedicated hook thread. Training never waits for
+	// hooks: if the previous invocation has not finished yet, the next one is skipped.
+	void set_hook(const hook_t& hook, uint32_t interval);
+
+	bool running() const { return m_running; }
+	uint32_t training_step() const { return m_training_step; }
+	float loss() const { return m_loss; }
+	uint32_t n_skipped_hooks() const { return m_n_skipped_hooks; }
+	float steps_per_second() const { return m_steps_per_second; }
+
+private:
+	void training_loop(uint32_t n_steps, int device);
+
+	Testbed& m_testbed;
+	uint32_t m_batch_size;
+	uint32_t m_steps_per_call;
+
+	std::thread m_thread;
+	std::exception_ptr m_exception;
+
+	std::atomic<bool> m_running{false};
+	std::atomic<bool> m_stop{false};
+	std::atomic<uint32_t> m_training_step{0};
+	std::atomic<float> m_loss{0.0f};
+	std::atomic<float> m_steps_per_second{0.0f};
+
+	// Held by the training thread while it calls into the testbed.
+	std::mutex m_testbed_mutex;
+	std::condition_variable m_pause_condition;
+	uint32_t m_n_pauses = 0;
+
+	std::mutex m_settings_mutex;
+	std::string m_snapshot_path;
+	uint32_t m_snapshot_interval = 0;
+	std::shared_ptr<hook_t> m_hook;
+	uint32_t m_hook_interval = 0;
+
+	ThreadPool m_hook_thread{1};
+	std::atomic<bool> m_hook_pending{false};
+	std::atomic<uint32_t> m_n_skipped_hooks{0};
+};
+
+NGP_NAMESPACE_END
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+/** @file   video_render.h
+ *  @author Thomas Müller, NVIDIA
+ *  @brief  Backend-agnostic offline video rendering: frames are rendered on the calling
+ *          thread while earlier frames are read back and encoded on a thread pool.
+ */
+
+#pragma once
+
+#include <neural-graphics-primitives/common.h>
+#include <neural-graphics-primitives/thread_pool.h>
+
+#include <string>
+#include <vector>
+
+NGP_NAMESPACE_BEGIN
+
+// Number of render targets a backend needs to provide. While frame i is rendered
+// into slot i % VIDEO_RENDER_N_SLOTS, frame i-1 is read back from the other slot.
+static constexpr uint32_t VIDEO_RENDER_N_SLOTS = 2;
+
+struct VideoRenderSettings {
+	// printf-style pattern of the frame files, e.g. "frames/%04d.png". The extension
+	// selects the image format: ".exr" stores linear colors, all others are written as 8 bit PNG.
+	std::string output_pattern = "%04d.png";
+	Eigen::Vector2i resolution = {1920, 1080};
+	// The camera path (time 0 to 1) is spread across `n_frames` frames.
+	uint32_t n_frames = 0;
+	float fps = 30.0f;
+	// Motion blur: samples per pixel are distributed across `shutter_fraction` of each frame.
+	uint32_t spp = 8;
+	float shutter_fraction = 0.5f;
+	// Frames that may be in flight between rendering and the end of encoding. Bounds the
+	// memory of the pipeline to `queue_depth` full-resolution float images.
+	uint32_t queue_depth = 8;
+};
+
+struct VideoFrame {
+	uint32_t index;
+	// Camera path times of the beginning and the end of the frame.
+	float start_time;
+	float end_time;
+
+	// Camera path time at the beginning of motion blur sample `i`; sample `i` ends at
+	// `sample_time(i+1, ...)`. Matches the sample distribution of Testbed::render_to_cpu.
+	float sample_time(uint32_t i, uint32_t spp, float shutter_fraction) const {
+		return start_time + (end_time - start_time) * (float)i / (float)spp * shutter_fraction;
+	}
+};
+
+struct VideoRenderStats {
+	uint32_t n_frames = 0;
+	// Time spent rendering on the calling thread.
+	float render_milliseconds = 0.0f;
+	// Time the calling thread waited for a free render slot or queue entry.
+	float stall_milliseconds = 0.0f;
+	// Read-back, tonemapping and encoding time, summed across workers.
+	float encode_milliseconds = 0.0f;
+	float total_milliseconds = 0.0f;
+
+	double frames_per_second() const {
+		return total_milliseconds > 0 ? n_frames / (total_milliseconds * 1e-3) : 0.0;
+	}
+};
+
+std::string video_frame_path(const std::string& pattern, uint32_t frame);
+
+// Unmultiplies alpha and converts linear, alpha-premultiplied RGBA pixels to 8 bit sRGB.
+std::vector<uint8_t> linear_to_srgb8(const float* rgba, size_t n_pixels);
+
+// Writes linear, alpha-premultiplied RGBA pixels. PNG files are unmultiplied and converted to sRGB
+// (like write_image of scripts/common.py), EXR files are stored as is.
+void write_video_frame(const std::string& path, const float* rgba, const Eigen::Vector2i& resolution);
+
+// Renders and writes the frames of `settings`.
+//  - `render_frame(const VideoFrame& frame, uint32_t slot)` renders a frame into a backend slot.
+//  - `read_back(const VideoFrame& frame, uint32_t slot, float* dst)` copies the slot's linear, alpha-premultiplied RGBA pixels to `dst`.
+// Read-backs and encoding run on `pool` and overlap with rendering the next frames.
+VideoRenderStats render_video(
+	const VideoRenderSettings& settings,
+	ThreadPool& pool,
+	const std::function<void(const VideoFrame&, uint32_t)>& render_frame,
+	const std::function<void(const VideoFrame&, uint32_t, float*)>& read_back
+);
+
+NGP_NAMESPACE_END
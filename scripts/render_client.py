@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+
+# Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+#
+# NVIDIA CORPORATION and its licensors retain all intellectual property
+# and proprietary rights in and to this software, related documentation
+# and any modifications thereto.  Any use, reproduction, disclosure or
+# distribution of this software and related documentation without an express
+# license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+# Minimal client of ngp_serve. Requests a view until it is refined to the desired
+# number of samples per pixel and writes the resulting PNG. See render_server.h for the protocol.
+
+import argparse
+import socket
+import struct
+import time
+
+MAGIC = 0x5350474e
+STATUS = ["ok", "busy", "unknown scene", "invalid request", "error"]
+
+def parse_args():
+	parser = argparse.ArgumentParser(description="Request progressively refined views from ngp_serve.")
+
+	parser.add_argument("--address", default="unix:/tmp/ngp_render.sock", help="'unix:<path>' or a TCP port on localhost.")
+	parser.add_argument("--scene", required=True, help="Name of the scene as passed to ngp_serve.")
+	parser.add_argument("--width", type=int, default=1280, help="Width of the view.")
+	parser.add_argument("--height", type=int, default=720, help="Height of the view.")
+	parser.add_argument("--camera", type=float, nargs=12, default=[1,0,0,0, 0,1,0,0, 0,0,1,0], help="Row-major 3x4 camera matrix.")
+	parser.add_argument("--fov", type=float, default=53.130102, help="Vertical field of view in degrees.")
+	parser.add_argument("--zoom", type=float, default=1.0, help="Magnification of the orthographic projection.")
+	parser.add_argument("--spp", type=int, default=16, help="Samples per pixel to refine the view to.")
+	parser.add_argument("--output", default="view.png", help="Where to write the final PNG.")
+
+	return parser.parse_args()
+
+def connect(address):
+	if address.startswith("unix:"):
+		s = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+		s.connect(address[5:])
+	else:
+		s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+		s.connect(("127.0.0.1", int(address)))
+	return s
+
+def receive(s, n_bytes):
+	data = bytearray()
+	while len(data) < n_bytes:
+		chunk = s.recv(n_bytes - len(data))
+		if not chunk:
+			raise ConnectionError("Render server closed the connection.")
+		data += chunk
+	return bytes(data)
+
+def request_view(s, args):
+	name = args.scene.encode()
+	s.sendall(
+		struct.pack("<II", MAGIC, len(name)) + name +
+		struct.pack("<II", args.width, args.height) +
+		struct.pack("<12f", *args.camera) +
+		struct.pack("<ffII", args.fov, args.zoom, args.spp, 0)
+	)
+
+	magic, status, spp, width, height, fmt, size = struct.unpack("<7I", receive(s, 28))
+	if magic != MAGIC:
+		raise RuntimeError("Invalid response magic.")
+	return status, spp, receive(s, size)
+
+if __name__ == "__main__":
+	args = parse_args()
+
+	with connect(args.address) as s:
+		start = time.monotonic()
+		previous_spp = -1
+		while True:
+			status, spp, payload = request_view(s, args)
+			if STATUS[status] == "busy":
+				time.sleep(0.01)
+				continue
+			if status != 0:
+				raise RuntimeError(f"Render server: {STATUS[status]}: {payload.decode()}")
+
+			print(f"{spp:4d} spp after {time.monotonic() - start:.3f}s")
+			# The server may cap the number of samples below the requested one
+			if spp >= args.spp or spp == previous_spp:
+				break
+			previous_spp = spp
+
+	with open(args.output, "wb") as f:
+		f.write(payload)
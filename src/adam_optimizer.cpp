@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2020-2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+/** @file   adam_optimizer.cpp
+ *  @author Thomas Müller, NVIDIA
+ */
+
+#include <neural-graphics-primitives/adam_optimizer.h>
+
+// SSE2 is part of every x86-64 target. This file is deliberately not among the HOST_SIMD_SOURCES:
+// contracting multiplications and additions into FMAs would break bit-equality with AdamOptimizer.
+#if defined(__SSE2__) || defined(_M_X64)
+#  define NGP_BATCH_ADAM_SSE2
+#  include <emmintrin.h>
+#endif
+
+using namespace Eigen;
+
+NGP_NAMESPACE_BEGIN
+
+namespace {
+
+// Batches below twice this size are stepped on the calling thread.
+constexpr size_t PARALLEL_CHUNK_SIZE = 4096;
+
+struct AdamLane {
+	const float* gradients; // strided by `dims`
+	uint32_t dims;
+	float* first_moment;
+	float* second_moment;
+	float* variable;
+	float* updates; // optional
+};
+
+// Identical sequence of roundings as AdamOptimizer::step
+inline float adam_update(float gradient, float& first_moment, float& second_moment, float variable, float gradient_scale, float l2_reg, float beta1, float beta2, float epsilon, float actual_learning_rate) {
+	gradient = gradient * gradient_scale + variable * l2_reg;
+	first_moment = beta1 * first_moment + (1 - beta1) * gradient;
+	second_moment = beta2 * second_moment + (1 - beta2) * (gradient * gradient);
+	return actual_learning_rate * (first_moment / (std::sqrt(second_moment) + epsilon));
+}
+
+void step_lane(const AdamLane& lane, size_t start, size_t end, float gradient_scale, float l2_reg, float beta1, float beta2, float epsilon, float actual_learning_rate) {
+	size_t i = start;
+
+#ifdef NGP_BATCH_ADAM_SSE2
+	const __m128 scale4 = _mm_set1_ps(gradient_scale);
+	const __m128 l2_reg4 = _mm_set1_ps(l2_reg);
+	const __m128 beta1_4 = _mm_set1_ps(beta1);
+	const __m128 beta2_4 = _mm_set1_ps(beta2);
+	const __m128 one_minus_beta1_4 = _mm_set1_ps(1 - beta1);
+	const __m128 one_minus_beta2_4 = _mm_set1_ps(1 - beta2);
+	const __m128 epsilon4 = _mm_set1_ps(epsilon);
+	const __m128 lr4 = _mm_set1_ps(actual_learning_rate);
+
+	for (; i + 4 <= end; i += 4) {
+		const float* g = lane.gradients + i * lane.dims;
+		__m128 variable = _mm_loadu_ps(lane.variable + i);
+		__m128 gradient = _mm_set_ps(g[3 * lane.dims], g[2 * lane.dims], g[lane.dims], g[0]);
+		gradient = _mm_add_ps(_mm_mul_ps(gradient, scale4), _mm_mul_ps(variable, l2_reg4));
+
+		__m128 first_moment = _mm_add_ps(_mm_mul_ps(beta1_4, _mm_loadu_ps(lane.first_moment + i)), _mm_mul_ps(one_minus_beta1_4, gradient));
+		__m128 second_moment = _mm_add_ps(_mm_mul_ps(beta2_4, _mm_loadu_ps(lane.second_moment + i)), _mm_mul_ps(one_minus_beta2_4, _mm_mul_ps(gradient, gradient)));
+		_mm_storeu_ps(lane.first_moment + i, first_moment);
+		_mm_storeu_ps(lane.second_moment + i, second_moment);
+
+		__m128 update = _mm_mul_ps(lr4, _mm_div_ps(first_moment, _mm_add_ps(_mm_sqrt_ps(second_moment), epsilon4)));
+		if (lane.updates) {
+			_mm_storeu_ps(lane.updates + i, update);
+		} else {
+			_mm_storeu_ps(lane.variable + i, _mm_sub_ps(variable, update));
+		}
+	}
+#endif
+
+	for (; i < end; ++i) {
+		float update = adam_update(lane.gradients[i * lane.dims], lane.first_moment[i], lane.second_moment[i], lane.variable[i], gradient_scale, l2_reg, beta1, beta2, epsilon, actual_learning_rate);
+		if (lane.updates) {
+			lane.updates[i] = update;
+		} else {
+			lane.variable[i] -= update;
+		}
+	}
+}
+
+template <typename F>
+void for_each_chunk(size_t size, ThreadPool* pool, F&& body) {
+	if (!pool || size < 2 * PARALLEL_CHUNK_SIZE) {
+		body(0, size);
+		return;
+	}
+
+	size_t n_chunks = (size + PARALLEL_CHUNK_SIZE - 1) / PARALLEL_CHUNK_SIZE;
+	pool->parallelFor<size_t>(0, n_chunks, [&](size_t chunk) {
+		body(chunk * PARALLEL_CHUNK_SIZE, std::min(size, (chunk + 1) * PARALLEL_CHUNK_SIZE));
+	});
+}
+
+}
+
+void BatchAdamOptimizer::resize(size_t size) {
+	if (size == m_size) {
+		return;
+	}
+
+	auto resize_lanes = [&](std::vector<float>& data) {
+		std::vector<float> result(size * m_dims, 0.0f);
+		size_t n_kept = std::min(size, m_size);
+		for (uint32_t dim = 0; dim < m_dims; ++dim) {
+			std::copy_n(data.begin() + dim * m_size, n_kept, result.begin() + dim * size);
+		}
+		data = std::move(result);
+	};
+
+	resize_lanes(m_first_moment);
+	resize_lanes(m_second_moment);
+	resize_lanes(m_variable);
+	m_size = size;
+}
+
+void BatchAdamOptimizer::step_moments(const float* gradients, float gradient_scale, float l2_reg, float actual_learning_rate, float* updates, ThreadPool* pool) {
+	for_each_chunk(m_size, pool, [&](size_t start, size_t end) {
+		for (uint32_t dim = 0; dim < m_dims; ++dim) {
+			AdamLane lane = {
+				gradients + dim,
+				m_dims,
+				m_first_moment.data() + dim * m_size,
+				m_second_moment.data() + dim * m_size,
+				m_variable.data() + dim * m_size,
+				updates ? updates + dim * m_size : nullptr,
+			};
+
+			step_lane(lane, start, end, gradient_scale, l2_reg, m_hparams.beta1, m_hparams.beta2, m_hparams.epsilon, actual_learning_rate);
+		}
+	});
+}
+
+void BatchAdamOptimizer::step(const float* gradients, float gradient_scale, float l2_reg, ThreadPool* pool) {
+	++m_iter;
+
+	float actual_learning_rate = m_hparams.learning_rate * std::sqrt(1 - std::pow(m_hparams.beta2, (float)m_iter)) / (1 - std::pow(m_hparams.beta1, (float)m_iter));
+	step_moments(gradients, gradient_scale, l2_reg, actual_learning_rate, nullptr, pool);
+}
+
+void BatchRotationAdamOptimizer::step(const float* gradients, float gradient_scale, float l2_reg, ThreadPool* pool) {
+	++m_iter;
+
+	// Evaluated in double precision like RotationAdamOptimizer::step
+	float actual_learning_rate = m_hparams.learning_rate * std::sqrt(1 - std::pow(m_hparams.beta2, m_iter)) / (1 - std::pow(m_hparams.beta1, m_iter));
+	m_updates.resize(m_size * 3);
+	step_moments(gradients, gradient_scale, l2_reg, actual_learning_rate, m_updates.data(), pool);
+
+	for_each_chunk(m_size, pool, [&](size_t start, size_t end) {
+		for (size_t i = start; i < end; ++i) {
+			Vector3f rot = {m_updates[i], m_updates[m_size + i], m_updates[2 * m_size + i]};
+			Vector3f var = variable<Vector3f>(i);
+			float rot_len = rot.norm();
+			float var_len = var.norm();
+
+			AngleAxisf result;
+			Matrix3f mat = AngleAxisf(rot_len, rot).toRotationMatrix() * AngleAxisf(var_len, var/var_len).toRotationMatrix();
+			result.fromRotationMatrix(mat);
+			set_variable(i, Vector3f{result.axis() * result.angle()});
+		}
+	});
+}
+
+NGP_NAMESPACE_END
@@ -21,6 +21,8 @@
 #endif
 
 #include <json/json.hpp>
+
+#include <algorithm>
 #include <fstream>
 
 using namespace Eigen;
@@ -44,6 +46,7 @@ CameraKeyframe lerp(const CameraKeyframe& p0, const CameraKeyframe& p1, float t,
 		p0.scale + (p1.scale - p0.scale) * t,
 		p0.fov + (p1.fov - p0.fov) * t,
 		p0.dof + (p1.dof - p0.dof) * t,
+		p0.ortho_scale + (p1.ortho_scale - p0.ortho_scale) * t,
 	};
 }
 
@@ -69,7 +72,7 @@ CameraKeyframe spline(float t, const CameraKeyframe& p0, const CameraKeyframe& p
 }
 
 void to_json(json& j, const CameraKeyframe& p) {
-	j = json{{"R", p.R}, {"T", p.T}, {"slice", p.slice}, {"scale", p.scale}, {"fov", p.fov}, {"dof", p.dof}};
+	j = json{{"R", p.R}, {"T", p.T}, {"slice", p.slice}, {"scale", p.scale}, {"fov", p.fov}, {"dof", p.dof}, {"ortho_scale", p.ortho_scale}};
 }
 
 bool load_relative_to_first=false; // set to true when using a camera path that is aligned with the first training image, such that it is invariant to changes in the space of the training data
@@ -99,6 +102,117 @@ void from_json(bool is_first, const json& j, CameraKeyframe& p, const CameraKeyf
 	j.at("scale").get_to(p.scale);
 	j.at("fov").get_to(p.fov);
 	j.at("dof").get_to(p.dof);
+	p.ortho_scale = j.value("ortho_scale", 1.0f);
+}
+
+// Number of spline evaluations per pair of keyframes when measuring the path's length
+static constexpr uint32_t ARC_LENGTH_SAMPLES_PER_SEGMENT = 64;
+
+void CameraPath::update_arc_length_lut() const {
+	size_t hash = 0;
+	auto hash_combine = [&hash](float v) {
+		hash ^= std::hash<float>{}(v) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	};
+
+	hash_combine(m_rotation_weight);
+	for (const auto& kf : m_keyframes) {
+		for (uint32_t i = 0; i < 4; ++i) {
+			hash_combine(kf.R[i]);
+		}
+		for (uint32_t i = 0; i < 3; ++i) {
+			hash_combine(kf.T[i]);
+		}
+	}
+
+	if (hash == m_arc_length_lut_hash && !m_arc_length_lut.empty()) {
+		return;
+	}
+
+	m_arc_length_lut_hash = hash;
+
+	uint32_t n_segments = (uint32_t)std::max(m_keyframes.size(), (size_t)2) - 1;
+	uint32_t n_samples = n_segments * ARC_LENGTH_SAMPLES_PER_SEGMENT + 1;
+	m_arc_length_lut.resize(n_samples);
+
+	float length = 0.0f;
+	CameraKeyframe prev = eval_camera_path(0.0f);
+	m_arc_length_lut[0] = 0.0f;
+	for (uint32_t i = 1; i < n_samples; ++i) {
+		CameraKeyframe cur = eval_camera_path((float)i / (n_samples - 1));
+		float angle = Eigen::Quaternionf(prev.R).normalized().angularDistance(Eigen::Quaternionf(cur.R).normalized());
+		length += (cur.T - prev.T).norm() + m_rotation_weight * angle;
+		m_arc_length_lut[i] = length;
+		prev = cur;
+	}
+
+	if (length > 0.0f) {
+		for (auto& l : m_arc_length_lut) {
+			l /= length;
+		}
+	} else {
+		// Stationary camera: fall back to the uniform parameterization
+		for (uint32_t i = 0; i < n_samples; ++i) {
+			m_arc_length_lut[i] = (float)i / (n_samples - 1);
+		}
+	}
+}
+
+float CameraPath::time_to_param(float time) const {
+	if (!m_constant_speed || m_keyframes.size() < 2) {
+		return time;
+	}
+
+	update_arc_length_lut();
+	return lookup_param(time);
+}
+
+float CameraPath::lookup_param(float time) const {
+	time = tcnn::clamp(time, 0.0f, 1.0f);
+	auto it = std::upper_bound(m_arc_length_lut.begin(), m_arc_length_lut.end(), time);
+	if (it == m_arc_length_lut.end()) {
+		return 1.0f;
+	}
+
+	size_t i = std::max((size_t)(it - m_arc_length_lut.begin()), (size_t)1) - 1;
+	float l0 = m_arc_length_lut[i], l1 = m_arc_length_lut[i+1];
+	float frac = l1 > l0 ? (time - l0) / (l1 - l0) : 0.0f;
+	return ((float)i + frac) / (m_arc_length_lut.size() - 1);
+}
+
+float CameraPath::param_to_time(float param) const {
+	if (!m_constant_speed || m_keyframes.size() < 2) {
+		return param;
+	}
+
+	update_arc_length_lut();
+
+	param = tcnn::clamp(param, 0.0f, 1.0f) * (m_arc_length_lut.size() - 1);
+	size_t i = std::min((size_t)param, m_arc_length_lut.size() - 2);
+	float frac = param - (float)i;
+	return m_arc_length_lut[i] + (m_arc_length_lut[i+1] - m_arc_length_lut[i]) * frac;
+}
+
+void CameraPath::eval_batch(const float* times, size_t n_times, CameraKeyframe* result) const {
+	if (m_keyframes.empty()) {
+		std::fill(result, result + n_times, CameraKeyframe{});
+		return;
+	}
+
+	// Validate the lookup table once for the whole batch rather than once per time
+	bool constant_speed = m_constant_speed && m_keyframes.size() >= 2;
+	if (constant_speed) {
+		update_arc_length_lut();
+	}
+
+	for (size_t i = 0; i < n_times; ++i) {
+		result[i] = eval_camera_path(constant_speed ? lookup_param(times[i]) : times[i]);
+	}
+}
+
+std::vector<CameraKeyframe> CameraPath::eval_batch(const std::vector<float>& times) const {
+	std::vector<CameraKeyframe> result(times.size());
+	eval_batch(times.data(), times.size(), result.data());
+	return result;
 }
 
 
@@ -136,12 +250,17 @@ void CameraPath::load(const std::string& filepath_string, const Eigen::Matrix<fl
 }
 
 #ifdef NGP_GUI
-int CameraPath::imgui(char path_filename_buf[128], float frame_milliseconds, Matrix<float, 3, 4> &camera, float slice_plane_z, float scale, float fov, float dof, float bounding_radius, const Eigen::Matrix<float, 3, 4> &first_xform) {
+int CameraPath::imgui(char path_filename_buf[128], float frame_milliseconds, Matrix<float, 3, 4> &camera, float slice_plane_z, float scale, float fov, float dof, float ortho_scale, float bounding_radius, const Eigen::Matrix<float, 3, 4> &first_xform) {
 	int n=std::max(0,int(m_keyframes.size())-1);
 	int read= 0;					// 1=smooth, 2=hard
 	if (!m_keyframes.empty()) {
 		if (ImGui::SliderFloat("camera path time", &m_playtime, 0.f, 1.f)) read=1;
 		ImGui::SliderFloat("auto play speed",&m_autoplayspeed, 0.f, 1.f);
+		if (ImGui::Checkbox("constant speed", &m_constant_speed)) read=1;
+		if (m_constant_speed) {
+			ImGui::SameLine();
+			if (ImGui::SliderFloat("rotation weight", &m_rotation_weight, 0.f, 2.f)) read=1;
+		}
 		if (m_autoplayspeed>0.f && m_playtime<1.f) {
 			m_playtime+=m_autoplayspeed*(frame_milliseconds/1000.f);
 			if (m_playtime>1.f) m_playtime=1.f;
@@ -149,36 +268,37 @@ int CameraPath::imgui(char path_filename_buf[128], float frame_milliseconds, Mat
 		}
 	}
 	if (ImGui::Button("Add from cam")) {
-		int i=(int)ceil(m_playtime*(float)n+0.001f);
+		int i=(int)ceil(time_to_param(m_playtime)*(float)n+0.001f);
 		if (i>m_keyframes.size()) i=m_keyframes.size();
 		if (i<0) i=0;
-		m_keyframes.insert(m_keyframes.begin()+i, CameraKeyframe(camera, slice_plane_z, scale, fov, dof));
+		m_keyframes.insert(m_keyframes.begin()+i, CameraKeyframe(camera, slice_plane_z, scale, fov, dof, ortho_scale));
 		m_update_cam_from_path = false;
 		int n=std::max(0,int(m_keyframes.size())-1);
-		m_playtime = n ? float(i)/float(n) : 1.f;
+		m_playtime = n ? param_to_time(float(i)/float(n)) : 1.f;
 		read = 2;
 	}
 	if (!m_keyframes.empty()) {
 		ImGui::SameLine();
 		if (ImGui::Button("split")) {
 			m_update_cam_from_path=false;
-			int i=(int)ceil(m_playtime*(float)n+0.001f);
+			int i=(int)ceil(time_to_param(m_playtime)*(float)n+0.001f);
 			if (i>m_keyframes.size()) i=(int)m_keyframes.size();
 			if (i<0) i=0;
-			m_keyframes.insert(m_keyframes.begin()+i, eval_camera_path(m_playtime));
-			m_playtime=float(i)/float(n+1);
+			m_keyframes.insert(m_keyframes.begin()+i, eval(m_playtime));
+			m_playtime=param_to_time(float(i)/float(n+1));
 			read=2;
 		}
 		ImGui::SameLine();
-		int i=(int)round(m_playtime*(float)n);
+		float param=time_to_param(m_playtime);
+		int i=(int)round(param*(float)n);
 		if (ImGui::Button("|<")) { m_playtime=0.f; read=2; }						ImGui::SameLine();
-		if (ImGui::Button("<")) { m_playtime=n?std::max(0.f,floorf((m_playtime-0.0001f)*(float)n)/(float)n):0.f; read=2;}		ImGui::SameLine();
+		if (ImGui::Button("<")) { m_playtime=n?param_to_time(std::max(0.f,floorf((param-0.0001f)*(float)n)/(float)n)):0.f; read=2;}		ImGui::SameLine();
 		if (ImGui::Button(m_update_cam_from_path ? "STOP" : "READ")) { m_update_cam_from_path=!m_update_cam_from_path; read=2; }				ImGui::SameLine();
-		if (ImGui::Button(">")) { m_playtime=n?std::min(1.f,ceilf((m_playtime+0.0001f)*(float)n)/(float)n):1.f; read=2;}			ImGui::SameLine();
+		if (ImGui::Button(">")) { m_playtime=n?param_to_time(std::min(1.f,ceilf((param+0.0001f)*(float)n)/(float)n)):1.f; read=2;}			ImGui::SameLine();
 		if (ImGui::Button(">|")) { m_playtime=1.f; read=2;}						ImGui::SameLine();
-		if (ImGui::Button("Dup")) { m_update_cam_from_path=false; m_keyframes.insert(m_keyframes.begin()+i, m_keyframes[i]); m_playtime=i/float(n+1); read=2;} ImGui::SameLine();
+		if (ImGui::Button("Dup")) { m_update_cam_from_path=false; m_keyframes.insert(m_keyframes.begin()+i, m_keyframes[i]); m_playtime=param_to_time(i/float(n+1)); read=2;} ImGui::SameLine();
 		if (ImGui::Button("Del")) { m_update_cam_from_path=false; m_keyframes.erase(m_keyframes.begin()+i); read=2;} ImGui::SameLine();
-		if (ImGui::Button("Set")) { m_keyframes[i]=CameraKeyframe(camera, slice_plane_z, scale, fov, dof); read=2; if (n) m_playtime=i/float(n); }
+		if (ImGui::Button("Set")) { m_keyframes[i]=CameraKeyframe(camera, slice_plane_z, scale, fov, dof, ortho_scale); read=2; if (n) m_playtime=param_to_time(i/float(n)); }
 
 		if (ImGui::RadioButton("Translate", m_gizmo_op == ImGuizmo::TRANSLATE))
 			m_gizmo_op = ImGuizmo::TRANSLATE;
@@ -217,12 +337,13 @@ int CameraPath::imgui(char path_filename_buf[128], float frame_milliseconds, Mat
 			save(path_filename_buf);
 	}
 	if (!m_keyframes.empty()) {
-		int i=(int)round(m_playtime*(float)n);
+		int i=(int)round(time_to_param(m_playtime)*(float)n);
 		ImGui::Text("Current keyframe %d/%d:", i, n+1);
 		if (ImGui::SliderFloat("fov", &m_keyframes[i].fov, 0.0f, 120.0f)) read=2;
 		if (ImGui::SliderFloat("dof", &m_keyframes[i].dof, 0.0f, 0.1f)) read=2;
 		if (ImGui::SliderFloat("slice Z", &m_keyframes[i].slice, -bounding_radius, bounding_radius)) read=2;
 		if (ImGui::SliderFloat("scale", &m_keyframes[i].scale, 0.f,10.f)) read=2;
+		if (ImGui::SliderFloat("ortho scale", &m_keyframes[i].ortho_scale, 0.01f, 10.f, "%.3f", ImGuiSliderFlags_Logarithmic)) read=2;
 	}
 	return m_keyframes.empty() ? 0 : read;
 }
@@ -301,7 +422,7 @@ bool CameraPath::imgui_viz(Matrix<float, 4, 4> &view2proj, Matrix<float, 4, 4> &
 
 	if (!m_update_cam_from_path) {
 		ImDrawList* list = ImGui::GetForegroundDrawList();
-		int cur_cam_i=(int)round(m_playtime * (float)(m_keyframes.size()-1));
+		int cur_cam_i=(int)round(time_to_param(m_playtime) * (float)(m_keyframes.size()-1));
 		Eigen::Vector3f prevp;
 		for (int i=0;i<m_keyframes.size();++i) {
 			visualize_nerf_camera(world2proj, m_keyframes[i].m(),  aspect, (i==cur_cam_i) ? 0xff80c0ff : 0x8080c0ff);
@@ -325,7 +446,7 @@ bool CameraPath::imgui_viz(Matrix<float, 4, 4> &view2proj, Matrix<float, 4, 4> &
 				changed=true;
 			}
 
-			visualize_nerf_camera(world2proj, eval_camera_path(m_playtime).m(), aspect, 0xff80ff80);
+			visualize_nerf_camera(world2proj, eval(m_playtime).m(), aspect, 0xff80ff80);
 			float dt = 0.05f / (float)m_keyframes.size();
 			Eigen::Vector3f prevp;
 			for (float t=0.f;;t+=dt) {
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+/** @file   camera_undistortion.cpp
+ *  @author Thomas Müller, NVIDIA
+ */
+
+#include <neural-graphics-primitives/camera_undistortion.h>
+
+#include <algorithm>
+
+using namespace Eigen;
+
+NGP_NAMESPACE_BEGIN
+
+CameraUndistortion CameraUndistortionMap::lookup(const float* data) const {
+	CameraUndistortion result{distortion};
+	if (!empty()) {
+		result.data = data;
+		result.resolution = resolution;
+		result.domain_min = domain_min;
+		result.domain_max = domain_max;
+	}
+	return result;
+}
+
+CameraUndistortionMap build_camera_undistortion_map(
+	const CameraDistortion& distortion,
+	const Vector2f& domain_min,
+	const Vector2f& domain_max,
+	const Vector2i& resolution,
+	ThreadPool& pool
+) {
+	if (resolution.x() < 2 || resolution.y() < 2) {
+		throw std::runtime_error{"Camera undistortion map must have a resolution of at least 2x2."};
+	}
+
+	if (!(domain_min.array() < domain_max.array()).all()) {
+		throw std::runtime_error{"Camera undistortion map must have a non-empty domain."};
+	}
+
+	CameraUndistortionMap result;
+	result.distortion = distortion;
+	result.resolution = resolution;
+	result.domain_min = domain_min;
+	result.domain_max = domain_max;
+	result.offsets.resize((size_t)resolution.x() * resolution.y() * 2);
+
+	Vector2f texel_size = (domain_max - domain_min).cwiseQuotient((resolution - Vector2i::Ones()).cast<float>());
+
+	auto undistort = [&](Vector2f pos) {
+		Vector2f undistorted = pos;
+		iterative_camera_undistortion(distortion.params, &undistorted.x(), &undistorted.y());
+		return undistorted;
+	};
+
+	pool.parallelFor<int>(0, resolution.y(), [&](int y) {
+		for (int x = 0; x < resolution.x(); ++x) {
+			Vector2f pos = domain_min + Vector2f{(float)x, (float)y}.cwiseProduct(texel_size);
+			Vector2f offset = undistort(pos) - pos;
+			float* dst = result.offsets.data() + ((size_t)x + (size_t)y * resolution.x()) * 2;
+			dst[0] = offset.x();
+			dst[1] = offset.y();
+		}
+	});
+
+	// Interpolation is least accurate in the middle of the cells
+	std::vector<float> row_errors(resolution.y() - 1, 0.0f);
+	CameraUndistortion lookup = result.lookup();
+	pool.parallelFor<int>(0, resolution.y() - 1, [&](int y) {
+		for (int x = 0; x < resolution.x() - 1; ++x) {
+			Vector2f pos = domain_min + Vector2f{x + 0.5f, y + 0.5f}.cwiseProduct(texel_size);
+			Vector2f interpolated = pos;
+			lookup.undistort(&interpolated.x(), &interpolated.y());
+			row_errors[y] = std::max(row_errors[y], (interpolated - undistort(pos)).norm());
+		}
+	});
+
+	result.max_error = *std::max_element(row_errors.begin(), row_errors.end());
+	return result;
+}
+
+CameraUndistortionMap build_camera_undistortion_map(
+	const CameraDistortion& distortion,
+	const Vector2f& principal_point,
+	const Vector2i& image_resolution,
+	const std::vector<Vector2f>& focal_lengths,
+	ThreadPool& pool,
+	const Vector2i& resolution,
+	float margin
+) {
+	if (focal_lengths.empty()) {
+		throw std::runtime_error{"Camera undistortion map requires at least one focal length."};
+	}
+
+	Vector2f domain_min = Vector2f::Constant(std::numeric_limits<float>::infinity());
+	Vector2f domain_max = Vector2f::Constant(-std::numeric_limits<float>::infinity());
+	for (const auto& focal_length : focal_lengths) {
+		Vector2f scale = image_resolution.cast<float>().cwiseQuotient(focal_length);
+		Vector2f a = (Vector2f::Zero() - principal_point).cwiseProduct(scale);
+		Vector2f b = (Vector2f::Ones() - principal_point).cwiseProduct(scale);
+		domain_min = domain_min.cwiseMin(a.cwiseMin(b));
+		domain_max = domain_max.cwiseMax(a.cwiseMax(b));
+	}
+
+	Vector2f extent = domain_max - domain_min;
+	return build_camera_undistortion_map(distortion, domain_min - extent * margin, domain_max + extent * margin, resolution, pool);
+}
+
+NGP_NAMESPACE_END
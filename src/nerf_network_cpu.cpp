@@ -0,0 +1,685 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+/** @file   nerf_network_cpu.cpp
+ *  @author Thomas Müller, NVIDIA
+ *  @brief  Host-side inference of a trained NerfNetwork. The AVX2 code paths are
+ *          enabled when compiling with -mavx2 -mfma -mf16c (see NGP_BUILD_HOST_SIMD);
+ *          otherwise, the scalar loops are written such that they auto-vectorize.
+ */
+
+#include <neural-graphics-primitives/common.h>
+#include <neural-graphics-primitives/nerf_network_cpu.h>
+#include <neural-graphics-primitives/thread_pool.h>
+
+#include <filesystem/path.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#  define NGP_CPU_AVX2
+#endif
+
+#if defined(NGP_CPU_AVX2) || defined(__F16C__)
+#  include <immintrin.h>
+#endif
+
+using namespace nlohmann;
+namespace fs = filesystem;
+
+NGP_NAMESPACE_BEGIN
+
+namespace {
+
+constexpr uint32_t MAX_FEATURES_PER_LEVEL = 8;
+constexpr uint32_t BLOCK_SIZE = CpuNerfNetwork::BLOCK_SIZE;
+
+// Number of blocks that a single thread pool task processes with one set of scratch buffers.
+constexpr uint32_t BLOCKS_PER_TASK = 16;
+
+std::string to_lower(std::string str) {
+	std::transform(std::begin(str), std::end(str), std::begin(str), [](unsigned char c) { return (char)std::tolower(c); });
+	return str;
+}
+
+bool equals_case_insensitive(const std::string& str1, const std::string& str2) {
+	return to_lower(str1) == to_lower(str2);
+}
+
+uint32_t next_multiple(uint32_t val, uint32_t divisor) {
+	return ((val + divisor - 1) / divisor) * divisor;
+}
+
+uint32_t network_alignment(const json& network_config) {
+	std::string otype = network_config.value("otype", "FullyFusedMLP");
+	return equals_case_insensitive(otype, "FullyFusedMLP") || equals_case_insensitive(otype, "MegakernelMLP") ? 16u : 8u;
+}
+
+ECpuActivation string_to_activation(const std::string& activation_name) {
+	if (equals_case_insensitive(activation_name, "None")) {
+		return ECpuActivation::None;
+	} else if (equals_case_insensitive(activation_name, "ReLU")) {
+		return ECpuActivation::ReLU;
+	} else if (equals_case_insensitive(activation_name, "Exponential")) {
+		return ECpuActivation::Exponential;
+	} else if (equals_case_insensitive(activation_name, "Sine")) {
+		return ECpuActivation::Sine;
+	} else if (equals_case_insensitive(activation_name, "Sigmoid")) {
+		return ECpuActivation::Sigmoid;
+	} else if (equals_case_insensitive(activation_name, "Squareplus")) {
+		return ECpuActivation::Squareplus;
+	} else if (equals_case_insensitive(activation_name, "Softplus")) {
+		return ECpuActivation::Softplus;
+	}
+
+	throw std::runtime_error{std::string{"CpuNerfNetwork: unsupported activation "} + activation_name};
+}
+
+float half_to_float(uint16_t h) {
+#ifdef __F16C__
+	return _cvtsh_ss(h);
+#else
+	uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+	uint32_t exponent = (h >> 10) & 0x1f;
+	uint32_t mantissa = h & 0x3ff;
+
+	uint32_t bits;
+	if (exponent == 0) {
+		if (mantissa == 0) {
+			bits = sign;
+		} else {
+			// Subnormal half: renormalize into a regular float
+			exponent = 127 - 15 + 1;
+			while (!(mantissa & 0x400)) {
+				mantissa <<= 1;
+				--exponent;
+			}
+			bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+		}
+	} else if (exponent == 0x1f) {
+		bits = sign | 0x7f800000 | (mantissa << 13);
+	} else {
+		bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+	}
+
+	float result;
+	std::memcpy(&result, &bits, sizeof(float));
+	return result;
+#endif
+}
+
+std::vector<float> params_to_float(const std::vector<uint8_t>& data, const std::string& params_type, size_t n_params) {
+	std::vector<float> result(n_params);
+
+	if (params_type == "float") {
+		if (data.size() < n_params * sizeof(float)) {
+			throw std::runtime_error{"CpuNerfNetwork: snapshot parameter buffer is too small."};
+		}
+		std::memcpy(result.data(), data.data(), n_params * sizeof(float));
+		return result;
+	}
+
+	if (params_type != "__half") {
+		throw std::runtime_error{std::string{"CpuNerfNetwork: unsupported parameter type "} + params_type};
+	}
+
+	if (data.size() < n_params * sizeof(uint16_t)) {
+		throw std::runtime_error{"CpuNerfNetwork: snapshot parameter buffer is too small."};
+	}
+
+	const uint16_t* halfs = (const uint16_t*)data.data();
+	size_t i = 0;
+#if defined(NGP_CPU_AVX2) && defined(__F16C__)
+	for (; i + 8 <= n_params; i += 8) {
+		_mm256_storeu_ps(&result[i], _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)&halfs[i])));
+	}
+#endif
+	for (; i < n_params; ++i) {
+		result[i] = half_to_float(halfs[i]);
+	}
+
+	return result;
+}
+
+// Same activation definitions as tiny-cuda-nn.
+void apply_activation(ECpuActivation activation, float* data, uint32_t n_elements) {
+	static constexpr float K_ACT = 10.0f;
+
+	switch (activation) {
+		case ECpuActivation::None: return;
+		case ECpuActivation::ReLU: for (uint32_t i = 0; i < n_elements; ++i) { data[i] = data[i] > 0.0f ? data[i] : 0.0f; } return;
+		case ECpuActivation::Exponential: for (uint32_t i = 0; i < n_elements; ++i) { data[i] = std::exp(data[i]); } return;
+		case ECpuActivation::Sine: for (uint32_t i = 0; i < n_elements; ++i) { data[i] = std::sin(data[i]); } return;
+		case ECpuActivation::Sigmoid: for (uint32_t i = 0; i < n_elements; ++i) { data[i] = 1.0f / (1.0f + std::exp(-data[i])); } return;
+		case ECpuActivation::Squareplus:
+			for (uint32_t i = 0; i < n_elements; ++i) {
+				float x = data[i] * K_ACT;
+				data[i] = 0.5f * (x + std::sqrt(x * x + 4)) / K_ACT;
+			}
+			return;
+		case ECpuActivation::Softplus:
+			for (uint32_t i = 0; i < n_elements; ++i) {
+				data[i] = std::log(std::exp(data[i] * K_ACT) + 1.0f) / K_ACT;
+			}
+			return;
+	}
+}
+
+// out[o][b] = sum_i weights[o][i] * in[i][b], where `in` and `out` are SoA blocks of BLOCK_SIZE elements.
+void matmul_block(const float* __restrict__ weights, uint32_t n_out, uint32_t n_in, const float* __restrict__ in, float* __restrict__ out) {
+#ifdef NGP_CPU_AVX2
+	static constexpr uint32_t N_REGISTERS = BLOCK_SIZE / 8;
+
+	for (uint32_t o = 0; o < n_out; ++o) {
+		__m256 acc[N_REGISTERS];
+		for (uint32_t k = 0; k < N_REGISTERS; ++k) {
+			acc[k] = _mm256_setzero_ps();
+		}
+
+		const float* w = weights + (size_t)o * n_in;
+		for (uint32_t i = 0; i < n_in; ++i) {
+			const __m256 wi = _mm256_set1_ps(w[i]);
+			const float* row = in + (size_t)i * BLOCK_SIZE;
+			for (uint32_t k = 0; k < N_REGISTERS; ++k) {
+				acc[k] = _mm256_fmadd_ps(wi, _mm256_loadu_ps(row + k * 8), acc[k]);
+			}
+		}
+
+		for (uint32_t k = 0; k < N_REGISTERS; ++k) {
+			_mm256_storeu_ps(out + (size_t)o * BLOCK_SIZE + k * 8, acc[k]);
+		}
+	}
+#else
+	for (uint32_t o = 0; o < n_out; ++o) {
+		float acc[BLOCK_SIZE] = {};
+
+		const float* w = weights + (size_t)o * n_in;
+		for (uint32_t i = 0; i < n_in; ++i) {
+			const float wi = w[i];
+			const float* row = in + (size_t)i * BLOCK_SIZE;
+			for (uint32_t b = 0; b < BLOCK_SIZE; ++b) {
+				acc[b] += wi * row[b];
+			}
+		}
+
+		std::memcpy(out + (size_t)o * BLOCK_SIZE, acc, sizeof(acc));
+	}
+#endif
+}
+
+void mlp_inference_block(const CpuMlp& mlp, const float* in, float* out, float* tmp0, float* tmp1) {
+	const float* layer_in = in;
+	for (size_t l = 0; l < mlp.weights.size(); ++l) {
+		const bool last = l == mlp.weights.size() - 1;
+		const uint32_t n_in = l == 0 ? mlp.input_width : mlp.width;
+		const uint32_t n_out = last ? mlp.padded_output_width : mlp.width;
+
+		float* layer_out = last ? out : (l % 2 == 0 ? tmp0 : tmp1);
+		matmul_block(mlp.weights[l].data(), n_out, n_in, layer_in, layer_out);
+		apply_activation(last ? mlp.output_activation : mlp.activation, layer_out, n_out * BLOCK_SIZE);
+
+		layer_in = layer_out;
+	}
+}
+
+// Matches tcnn's grid_index(): dense indexing while the grid fits into the level's
+// parameters, spatial hashing otherwise.
+inline uint32_t grid_index(bool use_hash, uint32_t hashmap_size, uint32_t resolution, uint32_t x, uint32_t y, uint32_t z) {
+	uint32_t index;
+	if (use_hash) {
+		index = x ^ (y * 2654435761u) ^ (z * 805459861u);
+	} else {
+		index = x + y * resolution + z * resolution * resolution;
+	}
+	return index % hashmap_size;
+}
+
+// Encodes a block of warped positions (SoA, 3 rows of BLOCK_SIZE) into `out` (SoA, padded_output_width rows).
+void grid_encode_block(const CpuGridEncoding& encoding, const float* __restrict__ positions, float* __restrict__ out) {
+	const uint32_t F = encoding.n_features_per_level;
+
+	for (uint32_t level = 0; level < encoding.n_levels; ++level) {
+		const float scale = encoding.level_scale(level);
+		const uint32_t resolution = encoding.level_resolution(scale);
+		const uint32_t hashmap_size = encoding.offsets[level+1] - encoding.offsets[level];
+		const bool use_hash = (uint64_t)hashmap_size < (uint64_t)resolution * resolution * resolution;
+		const float* grid = encoding.params.data() + (size_t)encoding.offsets[level] * F;
+
+		uint32_t b = 0;
+#ifdef NGP_CPU_AVX2
+		const __m256 vscale = _mm256_set1_ps(scale);
+		const __m256 vhalf = _mm256_set1_ps(0.5f);
+		const __m256 vone = _mm256_set1_ps(1.0f);
+		const __m256i ione = _mm256_set1_epi32(1);
+		const __m256i vprime1 = _mm256_set1_epi32((int)2654435761u);
+		const __m256i vprime2 = _mm256_set1_epi32((int)805459861u);
+		const __m256i vres = _mm256_set1_epi32((int)resolution);
+		const __m256i vres2 = _mm256_set1_epi32((int)(resolution * resolution));
+		const __m256i vsize = _mm256_set1_epi32((int)hashmap_size);
+		const __m256i vsize_minus_one = _mm256_set1_epi32((int)hashmap_size - 1);
+		const __m256i vfeatures = _mm256_set1_epi32((int)F);
+
+		for (; b + 8 <= BLOCK_SIZE; b += 8) {
+			__m256 pos[3];
+			__m256i pos_grid[3];
+			for (uint32_t dim = 0; dim < 3; ++dim) {
+				__m256 p = _mm256_fmadd_ps(_mm256_loadu_ps(positions + dim * BLOCK_SIZE + b), vscale, vhalf);
+				__m256 p_floor = _mm256_floor_ps(p);
+				pos_grid[dim] = _mm256_cvttps_epi32(p_floor);
+				pos[dim] = _mm256_sub_ps(p, p_floor);
+			}
+
+			__m256 result[MAX_FEATURES_PER_LEVEL];
+			for (uint32_t f = 0; f < F; ++f) {
+				result[f] = _mm256_setzero_ps();
+			}
+
+			for (uint32_t corner = 0; corner < 8; ++corner) {
+				__m256 weight = vone;
+				__m256i idx[3];
+				for (uint32_t dim = 0; dim < 3; ++dim) {
+					if (corner & (1 << dim)) {
+						weight = _mm256_mul_ps(weight, pos[dim]);
+						idx[dim] = _mm256_add_epi32(pos_grid[dim], ione);
+					} else {
+						weight = _mm256_mul_ps(weight, _mm256_sub_ps(vone, pos[dim]));
+						idx[dim] = pos_grid[dim];
+					}
+				}
+
+				__m256i index;
+				if (use_hash) {
+					// Hashed levels always have a power-of-two table size
+					index = _mm256_xor_si256(idx[0], _mm256_xor_si256(_mm256_mullo_epi32(idx[1], vprime1), _mm256_mullo_epi32(idx[2], vprime2)));
+					index = _mm256_and_si256(index, vsize_minus_one);
+				} else {
+					// Dense indices of corner vertices never exceed twice the table size
+					index = _mm256_add_epi32(idx[0], _mm256_add_epi32(_mm256_mullo_epi32(idx[1], vres), _mm256_mullo_epi32(idx[2], vres2)));
+					index = _mm256_sub_epi32(index, _mm256_and_si256(_mm256_cmpgt_epi32(index, vsize_minus_one), vsize));
+				}
+
+				index = _mm256_mullo_epi32(index, vfeatures);
+				for (uint32_t f = 0; f < F; ++f) {
+					result[f] = _mm256_fmadd_ps(weight, _mm256_i32gather_ps(grid + f, index, 4), result[f]);
+				}
+			}
+
+			for (uint32_t f = 0; f < F; ++f) {
+				_mm256_storeu_ps(out + (level * F + f) * BLOCK_SIZE + b, result[f]);
+			}
+		}
+#endif
+
+		for (; b < BLOCK_SIZE; ++b) {
+			float pos[3];
+			uint32_t pos_grid[3];
+			for (uint32_t dim = 0; dim < 3; ++dim) {
+				float p = positions[dim * BLOCK_SIZE + b] * scale + 0.5f;
+				float p_floor = std::floor(p);
+				pos_grid[dim] = (uint32_t)(int)p_floor;
+				pos[dim] = p - p_floor;
+			}
+
+			float result[MAX_FEATURES_PER_LEVEL] = {};
+			for (uint32_t corner = 0; corner < 8; ++corner) {
+				float weight = 1.0f;
+				uint32_t idx[3];
+				for (uint32_t dim = 0; dim < 3; ++dim) {
+					if (corner & (1 << dim)) {
+						weight *= pos[dim];
+						idx[dim] = pos_grid[dim] + 1;
+					} else {
+						weight *= 1.0f - pos[dim];
+						idx[dim] = pos_grid[dim];
+					}
+				}
+
+				const float* val = grid + (size_t)grid_index(use_hash, hashmap_size, resolution, idx[0], idx[1], idx[2]) * F;
+				for (uint32_t f = 0; f < F; ++f) {
+					result[f] += weight * val[f];
+				}
+			}
+
+			for (uint32_t f = 0; f < F; ++f) {
+				out[(level * F + f) * BLOCK_SIZE + b] = result[f];
+			}
+		}
+	}
+
+	// Like tcnn, pad the encoding with ones
+	std::fill(out + encoding.n_encoded_dims() * BLOCK_SIZE, out + encoding.padded_output_width * BLOCK_SIZE, 1.0f);
+}
+
+// Real spherical harmonics up to degree 4 with the same sign convention as tcnn.
+// Takes a block of warped directions (SoA, 3 rows of BLOCK_SIZE, in [0,1]).
+void sh_encode_block(uint32_t degree, const float* __restrict__ dirs, float* __restrict__ out) {
+	for (uint32_t b = 0; b < BLOCK_SIZE; ++b) {
+		const float x = dirs[0 * BLOCK_SIZE + b] * 2.0f - 1.0f;
+		const float y = dirs[1 * BLOCK_SIZE + b] * 2.0f - 1.0f;
+		const float z = dirs[2 * BLOCK_SIZE + b] * 2.0f - 1.0f;
+
+		const float xy = x * y, xz = x * z, yz = y * z, x2 = x * x, y2 = y * y, z2 = z * z;
+
+		auto o = [&](uint32_t i) -> float& { return out[i * BLOCK_SIZE + b]; };
+
+		o(0) = 0.28209479177387814f;
+		if (degree <= 1) { continue; }
+		o(1) = -0.48860251190291987f * y;
+		o(2) = 0.48860251190291987f * z;
+		o(3) = -0.48860251190291987f * x;
+		if (degree <= 2) { continue; }
+		o(4) = 1.0925484305920792f * xy;
+		o(5) = -1.0925484305920792f * yz;
+		o(6) = 0.94617469575755997f * z2 - 0.31539156525251999f;
+		o(7) = -1.0925484305920792f * xz;
+		o(8) = 0.54627421529603959f * x2 - 0.54627421529603959f * y2;
+		if (degree <= 3) { continue; }
+		o(9) = 0.59004358992664352f * y * (-3.0f * x2 + y2);
+		o(10) = 2.8906114426405538f * xy * z;
+		o(11) = 0.45704579946446572f * y * (1.0f - 5.0f * z2);
+		o(12) = 0.3731763325901154f * z * (5.0f * z2 - 3.0f);
+		o(13) = 0.45704579946446572f * x * (1.0f - 5.0f * z2);
+		o(14) = 1.4453057213202769f * z * (x2 - y2);
+		o(15) = 0.59004358992664352f * x * (-x2 + 3.0f * y2);
+	}
+}
+
+}
+
+void CpuMlp::init(const json& config, uint32_t input_width_, uint32_t output_width_) {
+	std::string otype = config.value("otype", "FullyFusedMLP");
+	if (!equals_case_insensitive(otype, "FullyFusedMLP") && !equals_case_insensitive(otype, "MegakernelMLP") && !equals_case_insensitive(otype, "CutlassMLP")) {
+		throw std::runtime_error{std::string{"CpuNerfNetwork: unsupported network type "} + otype};
+	}
+
+	input_width = input_width_;
+	output_width = output_width_;
+	padded_output_width = next_multiple(output_width, network_alignment(config));
+	width = config.at("n_neurons");
+	n_hidden_layers = config.at("n_hidden_layers");
+	activation = string_to_activation(config.value("activation", "ReLU"));
+	output_activation = string_to_activation(config.value("output_activation", "None"));
+
+	weights.clear();
+	if (n_hidden_layers == 0) {
+		weights.emplace_back((size_t)padded_output_width * input_width);
+	} else {
+		weights.emplace_back((size_t)width * input_width);
+		for (uint32_t i = 0; i < n_hidden_layers - 1; ++i) {
+			weights.emplace_back((size_t)width * width);
+		}
+		weights.emplace_back((size_t)padded_output_width * width);
+	}
+
+	if (n_hidden_layers == 0) {
+		width = input_width;
+	}
+}
+
+size_t CpuMlp::n_params() const {
+	size_t result = 0;
+	for (const auto& w : weights) {
+		result += w.size();
+	}
+	return result;
+}
+
+void CpuMlp::set_params(const float* params) {
+	for (auto& w : weights) {
+		std::copy(params, params + w.size(), w.begin());
+		params += w.size();
+	}
+}
+
+void CpuGridEncoding::init(const json& config, float desired_resolution, uint32_t alignment) {
+	// Resolve hyperparameters exactly like Testbed::reset_network() and tcnn's create_grid_encoding()
+	std::string otype = config.value("otype", "HashGrid");
+	std::string grid_type = config.value("type", "Hash");
+	if (equals_case_insensitive(otype, "DenseGrid")) {
+		grid_type = "Dense";
+	} else if (equals_case_insensitive(otype, "TiledGrid")) {
+		grid_type = "Tiled";
+	} else if (to_lower(otype).find("grid") == std::string::npos) {
+		throw std::runtime_error{std::string{"CpuNerfNetwork: unsupported position encoding "} + otype};
+	}
+
+	if (equals_case_insensitive(config.value("interpolation", "Linear"), "Smoothstep")) {
+		throw std::runtime_error{"CpuNerfNetwork: smoothstep grid interpolation is not supported."};
+	}
+
+	n_features_per_level = config.value("n_features_per_level", 2u);
+	if (n_features_per_level == 0 || n_features_per_level > MAX_FEATURES_PER_LEVEL) {
+		throw std::runtime_error{"CpuNerfNetwork: unsupported number of features per level."};
+	}
+
+	if (config.contains("n_features") && config["n_features"] > 0) {
+		n_levels = (uint32_t)config["n_features"] / n_features_per_level;
+	} else {
+		n_levels = config.value("n_levels", 16u);
+	}
+
+	base_resolution = config.value("base_resolution", 0u);
+	if (!base_resolution) {
+		base_resolution = 1u << (config.value("log2_hashmap_size", 15u) / 3);
+	}
+
+	log2_hashmap_size = config.value("log2_hashmap_size", 19u);
+
+	per_level_scale = config.value("per_level_scale", 0.0f);
+	if (per_level_scale <= 0.0f) {
+		per_level_scale = n_levels > 1 ? std::exp(std::log(desired_resolution / (float)base_resolution) / (n_levels-1)) : 2.0f;
+	}
+
+	offsets.resize(n_levels + 1);
+	uint32_t offset = 0;
+	for (uint32_t i = 0; i < n_levels; ++i) {
+		const uint32_t resolution = level_resolution(level_scale(i));
+
+		const uint32_t max_params = std::numeric_limits<uint32_t>::max() / 2;
+		uint64_t dense_params = (uint64_t)resolution * resolution * resolution;
+		uint32_t params_in_level = dense_params > max_params ? max_params : (uint32_t)dense_params;
+
+		params_in_level = next_multiple(params_in_level, 8u);
+
+		if (equals_case_insensitive(grid_type, "Hash")) {
+			params_in_level = std::min(params_in_level, (1u << log2_hashmap_size));
+		} else if (!equals_case_insensitive(grid_type, "Dense")) {
+			throw std::runtime_error{std::string{"CpuNerfNetwork: unsupported grid type "} + grid_type};
+		}
+
+		offsets[i] = offset;
+		offset += params_in_level;
+	}
+	offsets[n_levels] = offset;
+
+	padded_output_width = next_multiple(n_encoded_dims(), alignment);
+	params.clear();
+}
+
+struct CpuNerfNetwork::Scratch {
+	Scratch(const CpuNerfNetwork& network) :
+	input(NERF_COORDINATE_N_FLOATS * BLOCK_SIZE),
+	pos_encoded(network.m_pos_encoding.padded_output_width * BLOCK_SIZE),
+	rgb_network_input(network.m_rgb_network_input_width * BLOCK_SIZE),
+	rgb_network_output(network.m_rgb_network.padded_output_width * BLOCK_SIZE),
+	tmp0(network.m_max_width * BLOCK_SIZE),
+	tmp1(network.m_max_width * BLOCK_SIZE) {}
+
+	std::vector<float> input;
+	std::vector<float> pos_encoded;
+	std::vector<float> rgb_network_input;
+	std::vector<float> rgb_network_output;
+	std::vector<float> tmp0;
+	std::vector<float> tmp1;
+};
+
+json CpuNerfNetwork::read_snapshot(const std::string& path_string) {
+	fs::path path = path_string;
+	if (path.empty() || !path.exists()) {
+		throw std::runtime_error{std::string{"Snapshot \""} + path_string + "\" does not exist."};
+	}
+
+	json result;
+	if (equals_case_insensitive(path.extension(), "msgpack")) {
+		std::ifstream f{path.str(), std::ios::in | std::ios::binary};
+		result = json::from_msgpack(f);
+	} else {
+		std::ifstream f{path.str()};
+		result = json::parse(f, nullptr, true, true);
+	}
+
+	return result;
+}
+
+void CpuNerfNetwork::load(const json& config) {
+	if (!config.contains("snapshot")) {
+		throw std::runtime_error{"CpuNerfNetwork: network config does not contain a snapshot."};
+	}
+
+	const json& snapshot = config["snapshot"];
+
+	m_aabb_scale = 1;
+	if (snapshot.contains("nerf") && snapshot["nerf"].contains("dataset")) {
+		m_aabb_scale = snapshot["nerf"]["dataset"].value("aabb_scale", 1);
+	}
+
+	json encoding_config = config.value("encoding", json::object());
+	json dir_encoding_config = config.value("dir_encoding", json::object());
+	json network_config = config.value("network", json::object());
+	json rgb_network_config = config.value("rgb_network", json::object());
+
+	const uint32_t density_alignment = network_alignment(network_config);
+	const uint32_t rgb_alignment = network_alignment(rgb_network_config);
+
+	m_pos_encoding.init(encoding_config, 2048.0f * (float)m_aabb_scale, density_alignment);
+
+	std::string dir_otype = dir_encoding_config.value("otype", "SphericalHarmonics");
+	if (!equals_case_insensitive(dir_otype, "SphericalHarmonics")) {
+		throw std::runtime_error{std::string{"CpuNerfNetwork: unsupported direction encoding "} + dir_otype};
+	}
+
+	m_sh_degree = dir_encoding_config.value("degree", 4u);
+	if (m_sh_degree < 1 || m_sh_degree > 4) {
+		throw std::runtime_error{"CpuNerfNetwork: spherical harmonics degree must be between 1 and 4."};
+	}
+	m_dir_padded_output_width = next_multiple(m_sh_degree * m_sh_degree, rgb_alignment);
+
+	m_density_network.init(network_config, m_pos_encoding.padded_output_width, network_config.value("n_output_dims", 16u));
+	m_rgb_network_input_width = next_multiple(m_dir_padded_output_width + m_density_network.padded_output_width, rgb_alignment);
+	m_rgb_network.init(rgb_network_config, m_rgb_network_input_width, 3);
+
+	m_max_width = std::max({m_density_network.width, m_rgb_network.width, 1u});
+
+	// Parameter order matches NerfNetwork::set_params(): density MLP, rgb MLP, position encoding, direction encoding.
+	const size_t n_params = m_density_network.n_params() + m_rgb_network.n_params() + m_pos_encoding.n_params();
+	const size_t n_snapshot_params = snapshot.at("n_params");
+	if (n_params != n_snapshot_params) {
+		throw std::runtime_error{std::string{"CpuNerfNetwork: snapshot has "} + std::to_string(n_snapshot_params) + " parameters, but the architecture requires " + std::to_string(n_params) + "."};
+	}
+
+	std::vector<float> params = params_to_float(snapshot.at("params_binary").get_binary(), snapshot.value("params_type", "__half"), n_params);
+
+	size_t offset = 0;
+	m_density_network.set_params(params.data() + offset);
+	offset += m_density_network.n_params();
+
+	m_rgb_network.set_params(params.data() + offset);
+	offset += m_rgb_network.n_params();
+
+	m_pos_encoding.params.assign(params.begin() + offset, params.begin() + offset + m_pos_encoding.n_params());
+
+	m_n_params = n_params;
+
+	tlog::info()
+		<< "CpuNerfNetwork: loaded " << m_n_params << " parameters"
+		<< " (grid L=" << m_pos_encoding.n_levels
+		<< " F=" << m_pos_encoding.n_features_per_level
+		<< " T=2^" << m_pos_encoding.log2_hashmap_size
+		<< " Nmin=" << m_pos_encoding.base_resolution
+		<< " b=" << m_pos_encoding.per_level_scale
+		<< ")";
+}
+
+void CpuNerfNetwork::inference_block(uint32_t n, const float* coords, uint32_t stride, float* rgbd, float* density, Scratch& scratch) const {
+	// Gather the block into SoA layout, padding the tail with valid dummy coordinates
+	const uint32_t n_input_dims = rgbd ? NERF_COORDINATE_N_FLOATS : 3;
+	for (uint32_t d = 0; d < n_input_dims; ++d) {
+		float* row = scratch.input.data() + d * BLOCK_SIZE;
+		for (uint32_t b = 0; b < n; ++b) {
+			row[b] = coords[(size_t)b * stride + d];
+		}
+		std::fill(row + n, row + BLOCK_SIZE, 0.5f);
+	}
+
+	grid_encode_block(m_pos_encoding, scratch.input.data(), scratch.pos_encoded.data());
+
+	// The density network output forms the first rows of the rgb network input
+	float* density_network_output = scratch.rgb_network_input.data();
+	mlp_inference_block(m_density_network, scratch.pos_encoded.data(), density_network_output, scratch.tmp0.data(), scratch.tmp1.data());
+
+	if (density) {
+		for (uint32_t b = 0; b < n; ++b) {
+			density[b] = density_network_output[b];
+		}
+	}
+
+	if (!rgbd) {
+		return;
+	}
+
+	float* dir_encoded = scratch.rgb_network_input.data() + m_density_network.padded_output_width * BLOCK_SIZE;
+	sh_encode_block(m_sh_degree, scratch.input.data() + NERF_COORDINATE_DIR_OFFSET * BLOCK_SIZE, dir_encoded);
+	std::fill(dir_encoded + m_sh_degree * m_sh_degree * BLOCK_SIZE, scratch.rgb_network_input.data() + m_rgb_network_input_width * BLOCK_SIZE, 1.0f);
+
+	mlp_inference_block(m_rgb_network, scratch.rgb_network_input.data(), scratch.rgb_network_output.data(), scratch.tmp0.data(), scratch.tmp1.data());
+
+	const float* rgb = scratch.rgb_network_output.data();
+	for (uint32_t b = 0; b < n; ++b) {
+		rgbd[b*4+0] = rgb[0 * BLOCK_SIZE + b];
+		rgbd[b*4+1] = rgb[1 * BLOCK_SIZE + b];
+		rgbd[b*4+2] = rgb[2 * BLOCK_SIZE + b];
+		rgbd[b*4+3] = density_network_output[b];
+	}
+}
+
+void CpuNerfNetwork::inference(uint32_t n, const float* coords, uint32_t stride, float* rgbd) const {
+	Scratch scratch{*this};
+	for (uint32_t i = 0; i < n; i += BLOCK_SIZE) {
+		inference_block(std::min(BLOCK_SIZE, n - i), coords + (size_t)i * stride, stride, rgbd + (size_t)i * 4, nullptr, scratch);
+	}
+}
+
+void CpuNerfNetwork::inference(ThreadPool& pool, uint32_t n, const float* coords, uint32_t stride, float* rgbd) const {
+	const uint32_t task_size = BLOCK_SIZE * BLOCKS_PER_TASK;
+	pool.parallelFor<uint32_t>(0, (n + task_size - 1) / task_size, [&](uint32_t task) {
+		const uint32_t begin = task * task_size;
+		inference(std::min(task_size, n - begin), coords + (size_t)begin * stride, stride, rgbd + (size_t)begin * 4);
+	});
+}
+
+void CpuNerfNetwork::density(uint32_t n, const float* positions, uint32_t stride, float* density) const {
+	Scratch scratch{*this};
+	for (uint32_t i = 0; i < n; i += BLOCK_SIZE) {
+		inference_block(std::min(BLOCK_SIZE, n - i), positions + (size_t)i * stride, stride, nullptr, density + i, scratch);
+	}
+}
+
+void CpuNerfNetwork::density(ThreadPool& pool, uint32_t n, const float* positions, uint32_t stride, float* density) const {
+	const uint32_t task_size = BLOCK_SIZE * BLOCKS_PER_TASK;
+	pool.parallelFor<uint32_t>(0, (n + task_size - 1) / task_size, [&](uint32_t task) {
+		const uint32_t begin = task * task_size;
+		this->density(std::min(task_size, n - begin), positions + (size_t)begin * stride, stride, density + begin);
+	});
+}
+
+NGP_NAMESPACE_END
@@ -0,0 +1,809 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+/** @file   nerf_renderer_cpu.cpp
+ *  @author Thomas Müller, NVIDIA
+ *  @brief  CPU port of NerfTracer. Each screen tile is traced as a wavefront: alive rays
+ *          are compacted after every marching round and all of their samples are packed
+ *          densely into a single CpuNerfNetwork query.
+ */
+
+#include <neural-graphics-primitives/common.h>
+#include <neural-graphics-primitives/nerf_renderer_cpu.h>
+#include <neural-graphics-primitives/occupancy_grid.h>
+#include <neural-graphics-primitives/thread_pool.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+using namespace Eigen;
+using namespace nlohmann;
+
+NGP_NAMESPACE_BEGIN
+
+namespace {
+
+// The constants and helpers below mirror their __device__ counterparts in testbed_nerf.cu.
+constexpr uint32_t GRIDSIZE = 128;
+constexpr uint32_t CASCADES = 5;
+constexpr uint32_t STEPS = 1024;
+constexpr float RENDERING_NEAR_DISTANCE = 0.05f;
+constexpr float SQRT3 = 1.73205080757f;
+constexpr float MIN_CONE_STEPSIZE = SQRT3 / STEPS;
+constexpr float MAX_CONE_STEPSIZE = MIN_CONE_STEPSIZE * (1<<(CASCADES-1)) * STEPS / GRIDSIZE;
+constexpr uint32_t MARCH_ITER = 10000;
+constexpr uint32_t MIN_STEPS_INBETWEEN_COMPACTION = 1;
+constexpr uint32_t MAX_STEPS_INBETWEEN_COMPACTION = 8;
+
+constexpr uint32_t grid_mip_offset(uint32_t mip) {
+	return GRIDSIZE * GRIDSIZE * GRIDSIZE * mip;
+}
+
+inline uint32_t expand_bits(uint32_t v) {
+	v = (v * 0x00010001u) & 0xFF0000FFu;
+	v = (v * 0x00000101u) & 0x0F00F00Fu;
+	v = (v * 0x00000011u) & 0xC30C30C3u;
+	v = (v * 0x00000005u) & 0x49249249u;
+	return v;
+}
+
+inline uint32_t morton3D(uint32_t x, uint32_t y, uint32_t z) {
+	return expand_bits(x) | (expand_bits(y) << 1) | (expand_bits(z) << 2);
+}
+
+// Low-discrepancy samples, identical to random_val.cuh
+inline uint32_t sobol(uint32_t index, uint32_t dim) {
+	static constexpr uint32_t directions[2][32] = {
+		0x80000000, 0x40000000, 0x20000000, 0x10000000,
+		0x08000000, 0x04000000, 0x02000000, 0x01000000,
+		0x00800000, 0x00400000, 0x00200000, 0x00100000,
+		0x00080000, 0x00040000, 0x00020000, 0x00010000,
+		0x00008000, 0x00004000, 0x00002000, 0x00001000,
+		0x00000800, 0x00000400, 0x00000200, 0x00000100,
+		0x00000080, 0x00000040, 0x00000020, 0x00000010,
+		0x00000008, 0x00000004, 0x00000002, 0x00000001,
+
+		0x80000000, 0xc0000000, 0xa0000000, 0xf0000000,
+		0x88000000, 0xcc000000, 0xaa000000, 0xff000000,
+		0x80800000, 0xc0c00000, 0xa0a00000, 0xf0f00000,
+		0x88880000, 0xcccc0000, 0xaaaa0000, 0xffff0000,
+		0x80008000, 0xc000c000, 0xa000a000, 0xf000f000,
+		0x88008800, 0xcc00cc00, 0xaa00aa00, 0xff00ff00,
+		0x80808080, 0xc0c0c0c0, 0xa0a0a0a0, 0xf0f0f0f0,
+		0x88888888, 0xcccccccc, 0xaaaaaaaa, 0xffffffff,
+	};
+
+	uint32_t X = 0;
+	for (uint32_t bit = 0; bit < 32; bit++) {
+		uint32_t mask = (index >> bit) & 1;
+		X ^= mask * directions[dim][bit];
+	}
+
+	return X;
+}
+
+inline uint32_t hash_combine(uint32_t seed, uint32_t v) {
+	return seed ^ (v + (seed << 6) + (seed >> 2));
+}
+
+inline uint32_t reverse_bits(uint32_t x) {
+	x = (((x & 0xaaaaaaaa) >> 1) | ((x & 0x55555555) << 1));
+	x = (((x & 0xcccccccc) >> 2) | ((x & 0x33333333) << 2));
+	x = (((x & 0xf0f0f0f0) >> 4) | ((x & 0x0f0f0f0f) << 4));
+	x = (((x & 0xff00ff00) >> 8) | ((x & 0x00ff00ff) << 8));
+	return ((x >> 16) | (x << 16));
+}
+
+inline uint32_t nested_uniform_scramble_base2(uint32_t x, uint32_t seed) {
+	x = reverse_bits(x);
+	x += seed;
+	x ^= x * 0x6c50b47cu;
+	x ^= x * 0xb82f1e52u;
+	x ^= x * 0xc7afe638u;
+	x ^= x * 0x8d22f6e6u;
+	return reverse_bits(x);
+}
+
+inline float ld_random_val(uint32_t index, uint32_t seed, uint32_t dim = 0) {
+	constexpr float S = float(1.0/(1ull<<32));
+	index = nested_uniform_scramble_base2(index, seed);
+	return (float)nested_uniform_scramble_base2(sobol(index, dim), hash_combine(seed, dim)) * S;
+}
+
+inline Vector2f ld_random_val_2d(uint32_t index, uint32_t seed) {
+	return {ld_random_val(index, seed, 0), ld_random_val(index, seed, 1)};
+}
+
+inline Vector2f ld_random_pixel_offset(uint32_t spp) {
+	Vector2f offset = Vector2f::Constant(0.5f) - ld_random_val_2d(0, 0xdeadbeef) + ld_random_val_2d(spp, 0xdeadbeef);
+	offset.x() -= std::floor(offset.x());
+	offset.y() -= std::floor(offset.y());
+	return offset;
+}
+
+inline float logistic(float x) {
+	return 1.0f / (1.0f + std::exp(-x));
+}
+
+inline float network_to_rgb(float val, ENerfActivation activation) {
+	switch (activation) {
+		case ENerfActivation::None: return val;
+		case ENerfActivation::ReLU: return val > 0.0f ? val : 0.0f;
+		case ENerfActivation::Logistic: return logistic(val);
+		case ENerfActivation::Exponential: return std::exp(std::min(std::max(val, -10.0f), 10.0f));
+	}
+	return 0.0f;
+}
+
+inline float network_to_density(float val, ENerfActivation activation) {
+	switch (activation) {
+		case ENerfActivation::None: return val;
+		case ENerfActivation::ReLU: return val > 0.0f ? val : 0.0f;
+		case ENerfActivation::Logistic: return logistic(val);
+		case ENerfActivation::Exponential: return std::exp(val);
+	}
+	return 0.0f;
+}
+
+inline float srgb_to_linear(float srgb) {
+	return srgb <= 0.04045f ? srgb / 12.92f : std::pow((srgb + 0.055f) / 1.055f, 2.4f);
+}
+
+inline float linear_to_srgb(float linear) {
+	return linear < 0.0031308f ? 12.92f * linear : 1.055f * std::pow(linear, 0.41666f) - 0.055f;
+}
+
+inline Array3f srgb_to_linear(const Array3f& x) {
+	return {srgb_to_linear(x.x()), srgb_to_linear(x.y()), srgb_to_linear(x.z())};
+}
+
+inline Array3f linear_to_srgb(const Array3f& x) {
+	return {linear_to_srgb(x.x()), linear_to_srgb(x.y()), linear_to_srgb(x.z())};
+}
+
+// Same curves as tonemap() in render_buffer.cu
+Array3f tonemap(Array3f x, ETonemapCurve curve) {
+	if (curve == ETonemapCurve::Identity) {
+		return x;
+	}
+
+	x = x.cwiseMax(0.f);
+
+	float k0, k1, k2, k3, k4, k5;
+	if (curve == ETonemapCurve::ACES) {
+		k0 = 0.6f * 0.6f * 2.51f;
+		k1 = 0.6f * 0.03f;
+		k2 = 0.0f;
+		k3 = 0.6f * 0.6f * 2.43f;
+		k4 = 0.6f * 0.59f;
+		k5 = 0.14f;
+	} else if (curve == ETonemapCurve::Hable) {
+		const float A = 0.15f;
+		const float B = 0.50f;
+		const float C = 0.10f;
+		const float D = 0.20f;
+		const float E = 0.02f;
+		const float F = 0.30f;
+		k0 = A * F - A * E;
+		k1 = C * B * F - B * E;
+		k2 = 0.0f;
+		k3 = A * F;
+		k4 = B * F;
+		k5 = D * F * F;
+
+		const float W = 11.2f;
+		const float nom = k0 * (W*W) + k1 * W + k2;
+		const float denom = k3 * (W*W) + k4 * W + k5;
+		const float white_scale = denom / nom;
+
+		k0 = 4.0f * k0 * white_scale;
+		k1 = 2.0f * k1 * white_scale;
+		k2 = k2 * white_scale;
+		k3 = 4.0f * k3;
+		k4 = 2.0f * k4;
+	} else {
+		const Vector3f luminance_coefficients = Vector3f(0.2126f, 0.7152f, 0.0722f);
+		float Y = luminance_coefficients.dot(x.matrix());
+		return x * (1.f / (Y + 1.0f));
+	}
+
+	Array3f color_sq = x * x;
+	Array3f nom = color_sq * k0 + k1 * x + k2;
+	Array3f denom = k3 * color_sq + k4 * x + k5;
+	return nom / denom;
+}
+
+inline float calc_dt(float t, float cone_angle) {
+	return std::min(std::max(t * cone_angle, MIN_CONE_STEPSIZE), MAX_CONE_STEPSIZE);
+}
+
+inline float warp_dt(float dt) {
+	float max_stepsize = MIN_CONE_STEPSIZE * (1<<(CASCADES-1));
+	return (dt - MIN_CONE_STEPSIZE) / (max_stepsize - MIN_CONE_STEPSIZE);
+}
+
+inline float unwarp_dt(float dt) {
+	float max_stepsize = MIN_CONE_STEPSIZE * (1<<(CASCADES-1));
+	return dt * (max_stepsize - MIN_CONE_STEPSIZE) + MIN_CONE_STEPSIZE;
+}
+
+inline Vector3f warp_position(const Vector3f& pos, const AlignedBox3f& aabb) {
+	return (pos - aabb.min()).cwiseQuotient(aabb.diagonal());
+}
+
+inline Vector3f unwarp_position(const Vector3f& pos, const AlignedBox3f& aabb) {
+	return aabb.min() + pos.cwiseProduct(aabb.diagonal());
+}
+
+inline Vector3f warp_direction(const Vector3f& dir) {
+	return (dir + Vector3f::Ones()) * 0.5f;
+}
+
+inline uint32_t cascaded_grid_idx_at(Vector3f pos, uint32_t mip) {
+	float mip_scale = std::scalbn(1.0f, -(int)mip);
+	pos -= Vector3f::Constant(0.5f);
+	pos *= mip_scale;
+	pos += Vector3f::Constant(0.5f);
+
+	Vector3i i = (pos * GRIDSIZE).cast<int>();
+	return morton3D(
+		std::min(std::max(i.x(), 0), (int)GRIDSIZE-1),
+		std::min(std::max(i.y(), 0), (int)GRIDSIZE-1),
+		std::min(std::max(i.z(), 0), (int)GRIDSIZE-1)
+	);
+}
+
+inline bool density_grid_occupied_at(const Vector3f& pos, const uint8_t* density_grid_bitfield, uint32_t mip) {
+	uint32_t idx = cascaded_grid_idx_at(pos, mip);
+	return density_grid_bitfield[idx/8+grid_mip_offset(mip)/8] & (1<<(idx%8));
+}
+
+inline int mip_from_pos(const Vector3f& pos) {
+	int exponent;
+	float maxval = (pos - Vector3f::Constant(0.5f)).cwiseAbs().maxCoeff();
+	std::frexp(maxval, &exponent);
+	return std::min((int)CASCADES-1, std::max(0, exponent+1));
+}
+
+inline int mip_from_dt(float dt, const Vector3f& pos) {
+	int mip = mip_from_pos(pos);
+	dt *= 2*GRIDSIZE;
+	if (dt < 1.f) {
+		return mip;
+	}
+	int exponent;
+	std::frexp(dt, &exponent);
+	return std::min((int)CASCADES-1, std::max(exponent, mip));
+}
+
+inline float distance_to_next_voxel(const Vector3f& pos, const Vector3f& dir, const Vector3f& idir, uint32_t res) {
+	Vector3f p = res * pos;
+	float tx = (std::floor(p.x() + 0.5f + 0.5f * sign(dir.x())) - p.x()) * idir.x();
+	float ty = (std::floor(p.y() + 0.5f + 0.5f * sign(dir.y())) - p.y()) * idir.y();
+	float tz = (std::floor(p.z() + 0.5f + 0.5f * sign(dir.z())) - p.z()) * idir.z();
+	float t = std::min(std::min(tx, ty), tz);
+
+	return std::max(t / res, 0.0f);
+}
+
+inline float advance_to_next_voxel(float t, float cone_angle, const Vector3f& pos, const Vector3f& dir, const Vector3f& idir, uint32_t mip, const uint8_t* distance_field) {
+	uint32_t res = GRIDSIZE>>mip;
+	float t_target = t + distance_to_next_voxel(pos, dir, idir, res);
+	if (distance_field) {
+		uint32_t distance = occupancy_distance_at(pos, distance_field, mip);
+		if (distance > 1) {
+			float t_block = t + distance_to_free_block_exit(pos, dir, idir, res, distance);
+			if ((uint32_t)mip_from_dt(calc_dt(t_block, cone_angle), pos) == mip) {
+				t_target = std::max(t_target, t_block);
+			}
+		}
+	}
+
+	do {
+		t += calc_dt(t, cone_angle);
+	} while (t < t_target);
+	return t;
+}
+
+// Slab test with the same semantics as BoundingBox::ray_intersect
+inline Vector2f ray_intersect(const AlignedBox3f& aabb, const Vector3f& pos, const Vector3f& dir) {
+	float tmin = -std::numeric_limits<float>::infinity();
+	float tmax = std::numeric_limits<float>::infinity();
+
+	for (int i = 0; i < 3; ++i) {
+		float t0 = (aabb.min()[i] - pos[i]) / dir[i];
+		float t1 = (aabb.max()[i] - pos[i]) / dir[i];
+		if (t0 > t1) {
+			std::swap(t0, t1);
+		}
+
+		if (tmin > t1 || t0 > tmax) {
+			return Vector2f::Constant(std::numeric_limits<float>::max());
+		}
+
+		tmin = std::max(tmin, t0);
+		tmax = std::min(tmax, t1);
+	}
+
+	return {tmin, tmax};
+}
+
+struct CpuNerfPayload {
+	Vector3f origin;
+	Vector3f dir;
+	float t;
+	uint32_t idx;
+	uint16_t n_steps;
+	bool alive;
+};
+
+}
+
+struct CpuNerfRenderer::Tile {
+	Vector2i min;
+	Vector2i max;
+
+	uint32_t n_pixels() const {
+		return (uint32_t)((max.x() - min.x()) * (max.y() - min.y()));
+	}
+};
+
+struct CpuNerfRenderer::TileScratch {
+	std::vector<CpuNerfPayload> payloads;
+	std::vector<Array4f> rgba;
+
+	std::vector<CpuNerfPayload> hit_payloads;
+	std::vector<Array4f> hit_rgba;
+
+	std::vector<uint32_t> sample_offsets;
+	std::vector<float> network_input;
+	std::vector<float> network_output;
+
+	std::vector<Array4f> frame_buffer;
+	std::vector<Array4f> accumulate_buffer;
+};
+
+void CpuNerfRenderer::load(const json& config) {
+	m_network.load(config);
+
+	const json& snapshot = config["snapshot"];
+	if (!snapshot.contains("density_grid_binary")) {
+		throw std::runtime_error{"CpuNerfRenderer: snapshot does not contain a density grid."};
+	}
+
+	if (snapshot.value("density_grid_size", 0u) != GRIDSIZE) {
+		throw std::runtime_error{"Incompatible grid size in snapshot."};
+	}
+
+	const auto& grid_binary = snapshot["density_grid_binary"].get_binary();
+	const size_t n_grid_elements = (size_t)grid_mip_offset(CASCADES);
+	if (grid_binary.size() < n_grid_elements * sizeof(float)) {
+		throw std::runtime_error{"CpuNerfRenderer: density grid in snapshot is too small."};
+	}
+
+	m_density_grid.resize(n_grid_elements);
+	std::copy_n((const float*)grid_binary.data(), n_grid_elements, m_density_grid.begin());
+	update_density_grid_bitfield();
+
+	// Same bounding boxes as Testbed::load_nerf()
+	const float half_extent = 0.5f * std::min(1 << (CASCADES-1), m_network.aabb_scale());
+	m_aabb = AlignedBox3f{Vector3f::Constant(0.5f - half_extent), Vector3f::Constant(0.5f + half_extent)};
+	m_render_aabb = m_aabb;
+
+	if (snapshot.contains("nerf") && snapshot["nerf"].contains("dataset") && snapshot["nerf"]["dataset"].contains("render_aabb")) {
+		const json& render_aabb = snapshot["nerf"]["dataset"]["render_aabb"];
+		if (render_aabb.contains("min") && render_aabb.contains("max") && render_aabb["min"].is_array() && render_aabb["min"][0].is_number()) {
+			Vector3f min, max;
+			for (int i = 0; i < 3; ++i) {
+				min[i] = render_aabb["min"][i];
+				max[i] = render_aabb["max"][i];
+			}
+
+			AlignedBox3f box{min, max};
+			if (!box.isEmpty()) {
+				m_render_aabb = box.intersection(m_aabb);
+			}
+		}
+	}
+}
+
+void CpuNerfRenderer::update_density_grid_bitfield() {
+	m_density_grid_bitfield.resize(grid_mip_offset(CASCADES)/8);
+	nerf_density_grid_to_bitfield(m_density_grid.data(), m_density_grid_bitfield.data());
+	m_distance_field.update(m_density_grid_bitfield.data(), CASCADES);
+}
+
+void CpuNerfRenderer::trace_tile(const CpuNerfRenderSettings& settings, uint32_t spp, const Tile& tile, TileScratch& scratch, uint64_t& n_samples) const {
+	const Vector2i& resolution = settings.resolution;
+	const uint32_t n_pixels = tile.n_pixels();
+	const float cone_angle = settings.cone_angle_constant >= 0.0f ? settings.cone_angle_constant : default_cone_angle_constant();
+	const Vector3f camera_fwd = settings.camera_matrix1.col(2);
+	const uint8_t* grid = m_density_grid_bitfield.data();
+	const uint8_t* distance_field = settings.skip_empty_space ? m_distance_field.data() : nullptr;
+
+	scratch.payloads.resize(n_pixels);
+	scratch.rgba.assign(n_pixels, Array4f::Zero());
+	scratch.hit_payloads.clear();
+	scratch.hit_rgba.clear();
+
+	// Ray generation, see init_rays_with_payload_kernel_nerf and advance_pos_nerf
+	uint32_t n_alive = 0;
+	for (int y = tile.min.y(); y < tile.max.y(); ++y) {
+		for (int x = tile.min.x(); x < tile.max.x(); ++x) {
+			const uint32_t idx = x + resolution.x() * y;
+
+			float ray_time = ld_random_val(spp, idx*72239731);
+			Matrix<float, 3, 4> camera_matrix = settings.camera_matrix0 * ray_time + settings.camera_matrix1 * (1.f - ray_time);
+
+			Vector2f offset = settings.orthographic ? Vector2f::Zero() : ld_random_pixel_offset(settings.snap_to_pixel_centers ? 0 : spp);
+			Vector2f uv = (Vector2f{(float)x, (float)y} + offset).cwiseQuotient(resolution.cast<float>());
+			Vector2f plane = (uv - settings.screen_center).cwiseProduct(resolution.cast<float>()).cwiseQuotient(settings.focal_length);
+
+			Vector3f origin = camera_matrix.col(3);
+			Vector3f dir;
+			if (settings.orthographic) {
+				dir = camera_matrix.col(2);
+				origin += camera_matrix.col(0) * plane.x() + camera_matrix.col(1) * plane.y();
+			} else {
+				dir = camera_matrix.block<3, 3>(0, 0) * Vector3f{plane.x(), plane.y(), 1.0f};
+			}
+			dir.normalize();
+
+			float t = std::max(ray_intersect(m_render_aabb, origin, dir).x(), RENDERING_NEAR_DISTANCE) + 1e-6f;
+			if (!m_render_aabb.contains(origin + dir * t)) {
+				continue;
+			}
+
+			Vector3f idir = dir.cwiseInverse();
+			float dt = calc_dt(t, cone_angle);
+			t += ld_random_val(spp, idx * 786433) * dt;
+
+			bool alive = true;
+			Vector3f pos;
+			while (1) {
+				if (!m_render_aabb.contains(pos = origin + dir * t)) {
+					alive = false;
+					break;
+				}
+
+				dt = calc_dt(t, cone_angle);
+				uint32_t mip = (uint32_t)mip_from_dt(dt, pos);
+
+				if (density_grid_occupied_at(pos, grid, mip)) {
+					break;
+				}
+
+				t = advance_to_next_voxel(t, cone_angle, pos, dir, idir, mip, distance_field);
+			}
+
+			if (alive) {
+				scratch.payloads[n_alive++] = {origin, dir, t, idx, 0, true};
+			}
+		}
+	}
+
+	const uint32_t n_rays_initialized = n_pixels;
+	uint32_t i = 1;
+	bool first_iteration = true;
+	while (i < MARCH_ITER) {
+		// Compact rays that did not diverge yet and retire those that contributed
+		if (!first_iteration) {
+			uint32_t n_compacted = 0;
+			for (uint32_t j = 0; j < n_alive; ++j) {
+				if (scratch.payloads[j].alive) {
+					scratch.payloads[n_compacted] = scratch.payloads[j];
+					scratch.rgba[n_compacted] = scratch.rgba[j];
+					++n_compacted;
+				} else if (scratch.rgba[j].w() > 0.001f) {
+					scratch.hit_payloads.emplace_back(scratch.payloads[j]);
+					scratch.hit_rgba.emplace_back(scratch.rgba[j]);
+				}
+			}
+			n_alive = n_compacted;
+		}
+		first_iteration = false;
+
+		if (n_alive == 0) {
+			break;
+		}
+
+		const uint32_t n_steps_between_compaction = std::min(std::max(n_rays_initialized / n_alive, MIN_STEPS_INBETWEEN_COMPACTION), MAX_STEPS_INBETWEEN_COMPACTION);
+
+		// Generate the samples of all alive rays, packed densely (see generate_next_nerf_network_inputs)
+		scratch.sample_offsets.resize(n_alive + 1);
+		scratch.network_input.resize((size_t)n_alive * n_steps_between_compaction * NERF_COORDINATE_N_FLOATS);
+
+		uint32_t n_elements = 0;
+		for (uint32_t r = 0; r < n_alive; ++r) {
+			CpuNerfPayload& payload = scratch.payloads[r];
+			scratch.sample_offsets[r] = n_elements;
+
+			const Vector3f& origin = payload.origin;
+			const Vector3f& dir = payload.dir;
+			const Vector3f idir = dir.cwiseInverse();
+			const Vector3f warped_dir = warp_direction(dir);
+
+			float t = payload.t;
+			uint32_t j = 0;
+			for (; j < n_steps_between_compaction; ++j) {
+				Vector3f pos;
+				float dt = 0.0f;
+				bool exited = false;
+				while (1) {
+					if (!m_render_aabb.contains(pos = origin + dir * t)) {
+						exited = true;
+						break;
+					}
+
+					dt = calc_dt(t, cone_angle);
+					uint32_t mip = (uint32_t)mip_from_dt(dt, pos);
+
+					if (density_grid_occupied_at(pos, grid, mip)) {
+						break;
+					}
+
+					t = advance_to_next_voxel(t, cone_angle, pos, dir, idir, mip, distance_field);
+				}
+
+				if (exited) {
+					break;
+				}
+
+				float* coord = &scratch.network_input[(size_t)n_elements * NERF_COORDINATE_N_FLOATS];
+				Vector3f warped_pos = warp_position(pos, m_aabb);
+				coord[0] = warped_pos.x();
+				coord[1] = warped_pos.y();
+				coord[2] = warped_pos.z();
+				coord[3] = warp_dt(dt);
+				coord[4] = warped_dir.x();
+				coord[5] = warped_dir.y();
+				coord[6] = warped_dir.z();
+				++n_elements;
+
+				t += dt;
+			}
+
+			if (j == n_steps_between_compaction) {
+				payload.t = t;
+			}
+			payload.n_steps = (uint16_t)j;
+		}
+		scratch.sample_offsets[n_alive] = n_elements;
+
+		scratch.network_output.resize((size_t)n_elements * 4);
+		m_network.inference(n_elements, scratch.network_input.data(), NERF_COORDINATE_N_FLOATS, scratch.network_output.data());
+		n_samples += n_elements;
+
+		// Composite, see composite_kernel_nerf
+		for (uint32_t r = 0; r < n_alive; ++r) {
+			CpuNerfPayload& payload = scratch.payloads[r];
+			Array4f local_rgba = scratch.rgba[r];
+			const uint32_t offset = scratch.sample_offsets[r];
+			const uint32_t actual_n_steps = payload.n_steps;
+
+			uint32_t j = 0;
+			for (; j < actual_n_steps; ++j) {
+				const float* coord = &scratch.network_input[(size_t)(offset + j) * NERF_COORDINATE_N_FLOATS];
+				const float* network_output = &scratch.network_output[(size_t)(offset + j) * 4];
+
+				Vector3f pos = unwarp_position(Vector3f{coord[0], coord[1], coord[2]}, m_aabb);
+				float T = 1.f - local_rgba.w();
+				float dt = unwarp_dt(coord[3]);
+				float alpha = 1.f - std::exp(-network_to_density(network_output[3], settings.density_activation) * dt);
+				float weight = alpha * T;
+
+				Array3f rgb = {
+					network_to_rgb(network_output[0], settings.rgb_activation),
+					network_to_rgb(network_output[1], settings.rgb_activation),
+					network_to_rgb(network_output[2], settings.rgb_activation),
+				};
+
+				if (settings.render_mode == ERenderMode::Positions) {
+					rgb = pos.array();
+				} else if (settings.render_mode == ERenderMode::Depth) {
+					float z = camera_fwd.dot(pos - payload.origin) * settings.depth_scale;
+					rgb = {z, z, z};
+				} else if (settings.render_mode == ERenderMode::Distance) {
+					float z = (pos - payload.origin).norm() * settings.depth_scale;
+					rgb = {z, z, z};
+				} else if (settings.render_mode == ERenderMode::Stepsize) {
+					float warped_dt = warp_dt(dt);
+					rgb = {warped_dt, warped_dt, warped_dt};
+				} else if (settings.render_mode == ERenderMode::AO) {
+					rgb = Array3f::Constant(alpha);
+				}
+
+				local_rgba.head<3>() += rgb * weight;
+				local_rgba.w() += weight;
+
+				if (local_rgba.w() > (1.0f - settings.min_alpha)) {
+					break;
+				}
+			}
+
+			if (j < n_steps_between_compaction) {
+				payload.alive = false;
+				payload.n_steps = (uint16_t)(j + i);
+			}
+
+			scratch.rgba[r] = local_rgba;
+		}
+
+		i += n_steps_between_compaction;
+	}
+
+	// Shade, see shade_kernel_nerf
+	Array4f* frame_buffer = scratch.frame_buffer.data();
+	const int tile_width = tile.max.x() - tile.min.x();
+	for (size_t h = 0; h < scratch.hit_payloads.size(); ++h) {
+		const CpuNerfPayload& payload = scratch.hit_payloads[h];
+		Array4f tmp = scratch.hit_rgba[h];
+
+		if (settings.render_mode == ERenderMode::Cost) {
+			float col = (float)payload.n_steps / 128;
+			tmp = {col, col, col, 1.0f};
+		}
+
+		if (!settings.linear_colors && settings.render_mode == ERenderMode::Shade) {
+			tmp.head<3>() = srgb_to_linear(tmp.head<3>());
+		}
+
+		const int x = (int)(payload.idx % resolution.x()) - tile.min.x();
+		const int y = (int)(payload.idx / resolution.x()) - tile.min.y();
+		Array4f& dst = frame_buffer[x + y * tile_width];
+		dst = tmp + dst * (1.0f - tmp.w());
+	}
+}
+
+void CpuNerfRenderer::render_tile(const CpuNerfRenderSettings& settings, const Tile& tile, Array4f* out, TileScratch& scratch, uint64_t& n_samples) const {
+	const uint32_t n_pixels = tile.n_pixels();
+	scratch.accumulate_buffer.assign(n_pixels, Array4f::Zero());
+
+	for (uint32_t s = 0; s < settings.spp; ++s) {
+		scratch.frame_buffer.assign(n_pixels, Array4f::Zero());
+		trace_tile(settings, settings.spp_offset + s, tile, scratch, n_samples);
+
+		// Same as accumulate_kernel in render_buffer.cu
+		const float sample_count = (float)s;
+		for (uint32_t p = 0; p < n_pixels; ++p) {
+			Array4f color = scratch.frame_buffer[p];
+			Array4f& tmp = scratch.accumulate_buffer[p];
+
+			if (settings.color_space == EColorSpace::VisPosNeg) {
+				float val = color.x() - color.y();
+				float tmp_val = tmp.x() - tmp.y();
+				tmp_val = (tmp_val * sample_count + val) / (sample_count+1);
+				tmp.x() = std::max(tmp_val, 0.0f);
+				tmp.y() = std::max(-tmp_val, 0.0f);
+			} else {
+				if (settings.color_space == EColorSpace::SRGB) {
+					color.head<3>() = linear_to_srgb(color.head<3>());
+				}
+				tmp.head<3>() = (tmp.head<3>() * sample_count + color.head<3>()) / (sample_count+1);
+			}
+
+			tmp.w() = (tmp.w() * sample_count + color.w()) / (sample_count+1);
+		}
+	}
+
+	// Same as tonemap_kernel in render_buffer.cu
+	Array4f background_color = settings.background_color;
+	if (settings.color_space != EColorSpace::SRGB) {
+		background_color.head<3>() = srgb_to_linear(background_color.head<3>());
+	}
+
+	const int tile_width = tile.max.x() - tile.min.x();
+	for (int y = tile.min.y(); y < tile.max.y(); ++y) {
+		for (int x = tile.min.x(); x < tile.max.x(); ++x) {
+			Array4f color = scratch.accumulate_buffer[(x - tile.min.x()) + (y - tile.min.y()) * tile_width];
+			float weight = (1 - color.w()) * background_color.w();
+			color.head<3>() += background_color.head<3>() * weight;
+			color.w() += weight;
+
+			Array3f col = color.head<3>();
+			if (settings.color_space == EColorSpace::SRGB) {
+				col = srgb_to_linear(col);
+			}
+			col *= std::exp2(settings.exposure);
+			col = tonemap(col, settings.tonemap_curve);
+			if (settings.to_srgb) {
+				col = linear_to_srgb(col);
+			}
+			color.head<3>() = col;
+
+			out[x + y * settings.resolution.x()] = color;
+		}
+	}
+}
+
+CpuNerfRenderStats CpuNerfRenderer::render(const CpuNerfRenderSettings& settings, ThreadPool& pool, Array4f* out) const {
+	if (!m_network.loaded()) {
+		throw std::runtime_error{"CpuNerfRenderer: no snapshot loaded."};
+	}
+
+	switch (settings.render_mode) {
+		case ERenderMode::Shade:
+		case ERenderMode::AO:
+		case ERenderMode::Positions:
+		case ERenderMode::Depth:
+		case ERenderMode::Distance:
+		case ERenderMode::Stepsize:
+		case ERenderMode::Cost:
+			break;
+		default:
+			throw std::runtime_error{"CpuNerfRenderer: unsupported render mode."};
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	const Vector2i& resolution = settings.resolution;
+	const int tile_size = (int)std::max(settings.tile_size, 1u);
+
+	std::vector<Tile> tiles;
+	for (int y = 0; y < resolution.y(); y += tile_size) {
+		for (int x = 0; x < resolution.x(); x += tile_size) {
+			tiles.push_back({{x, y}, {std::min(x + tile_size, resolution.x()), std::min(y + tile_size, resolution.y())}});
+		}
+	}
+
+	std::vector<uint64_t> n_samples(tiles.size(), 0);
+	std::vector<std::future<void>> futures;
+	futures.reserve(tiles.size());
+	for (size_t i = 0; i < tiles.size(); ++i) {
+		futures.emplace_back(pool.enqueueTask([&, i]() {
+			thread_local TileScratch scratch;
+			render_tile(settings, tiles[i], out, scratch, n_samples[i]);
+		}));
+	}
+	waitAll(futures);
+
+	CpuNerfRenderStats stats;
+	stats.n_rays = (uint64_t)resolution.x() * resolution.y() * settings.spp;
+	for (auto n : n_samples) {
+		stats.n_samples += n;
+	}
+	stats.n_threads = (uint32_t)std::min(pool.numThreads(), std::max(tiles.size(), (size_t)1));
+	stats.milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return stats;
+}
+
+std::vector<Array4f> CpuNerfRenderer::render(const CpuNerfRenderSettings& settings, ThreadPool& pool) const {
+	std::vector<Array4f> result((size_t)settings.resolution.x() * settings.resolution.y());
+	render(settings, pool, result.data());
+	return result;
+}
+
+void CpuNerfRenderer::render_batch(const CpuNerfRenderSettings& settings, const BatchRenderPlan& plan, ThreadPool& pool, float* out) const {
+	std::vector<Array4f> slots[BATCH_RENDER_N_SLOTS];
+
+	ngp::render_batch(plan, out, pool,
+		[&](const BatchRenderView& view, uint32_t slot) {
+			CpuNerfRenderSettings view_settings = settings;
+			view_settings.camera_matrix0 = view_settings.camera_matrix1 = view.camera_matrix;
+			view_settings.resolution = view.resolution;
+			view_settings.spp = view.spp;
+			view_settings.spp_offset = settings.spp_offset + view.spp_offset;
+			if (view.focal_length.x() > 0) {
+				view_settings.focal_length = view.focal_length;
+			} else if (settings.resolution.x() > 0) {
+				view_settings.focal_length *= (float)view.resolution.x() / settings.resolution.x();
+			}
+
+			slots[slot].resize((size_t)view.resolution.x() * view.resolution.y());
+			render(view_settings, pool, slots[slot].data());
+		},
+		[&](const BatchRenderView& view, uint32_t slot, float* dst) {
+			std::copy_n((const float*)slots[slot].data(), view.n_floats(), dst);
+		}
+	);
+}
+
+NGP_NAMESPACE_END
@@ -0,0 +1,388 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+/** @file   occupancy_distance_field.cpp
+ *  @author Thomas Müller, NVIDIA
+ *  @brief  Incremental host-side construction of the occupancy distance field. The passes along y and z
+ *          combine whole rows of distances at once and are vectorized with SSE2.
+ */
+
+#include <neural-graphics-primitives/occupancy_distance_field.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#  define NGP_OCCUPANCY_DISTANCE_SSE2
+#  include <emmintrin.h>
+#endif
+
+using namespace Eigen;
+
+NGP_NAMESPACE_BEGIN
+
+namespace {
+
+constexpr uint32_t GRIDSIZE = OCCUPANCY_DISTANCE_GRIDSIZE;
+constexpr uint32_t N_CELLS = OCCUPANCY_DISTANCE_N_CELLS_PER_CASCADE;
+constexpr uint32_t N_BYTES_PER_CASCADE = N_CELLS / 8;
+
+// Bytes of the bitfield that are compared by one task
+constexpr uint32_t CHUNK_BYTES = 1 << 14;
+
+// The constants and helpers below mirror their __device__ counterparts in testbed_nerf.cu.
+constexpr uint32_t CASCADES = OccupancyGrid::CASCADES;
+constexpr float MIN_CONE_STEPSIZE = 1.73205080757f / 1024;
+constexpr float MAX_CONE_STEPSIZE = MIN_CONE_STEPSIZE * (1<<(CASCADES-1)) * 1024 / GRIDSIZE;
+
+inline uint32_t expand_bits(uint32_t v) {
+	v = (v * 0x00010001u) & 0xFF0000FFu;
+	v = (v * 0x00000101u) & 0x0F00F00Fu;
+	v = (v * 0x00000011u) & 0xC30C30C3u;
+	v = (v * 0x00000005u) & 0x49249249u;
+	return v;
+}
+
+inline uint32_t morton3D_invert(uint32_t x) {
+	x = x & 0x49249249;
+	x = (x | (x >> 2)) & 0xc30c30c3;
+	x = (x | (x >> 4)) & 0x0f00f00f;
+	x = (x | (x >> 8)) & 0xff0000ff;
+	x = (x | (x >> 16)) & 0x0000ffff;
+	return x;
+}
+
+inline float calc_dt(float t, float cone_angle) {
+	return std::min(std::max(t * cone_angle, MIN_CONE_STEPSIZE), MAX_CONE_STEPSIZE);
+}
+
+inline int mip_from_pos(const Vector3f& pos) {
+	int exponent;
+	float maxval = (pos - Vector3f::Constant(0.5f)).cwiseAbs().maxCoeff();
+	std::frexp(maxval, &exponent);
+	return std::min((int)CASCADES-1, std::max(0, exponent+1));
+}
+
+inline int mip_from_dt(float dt, const Vector3f& pos) {
+	int mip = mip_from_pos(pos);
+	dt *= 2*GRIDSIZE;
+	if (dt < 1.f) {
+		return mip;
+	}
+	int exponent;
+	std::frexp(dt, &exponent);
+	return std::min((int)CASCADES-1, std::max(exponent, mip));
+}
+
+inline bool density_grid_occupied_at(const Vector3f& pos, const uint8_t* bitfield, uint32_t mip) {
+	float mip_scale = std::scalbn(1.0f, -(int)mip);
+	Vector3f p = (pos - Vector3f::Constant(0.5f)) * mip_scale + Vector3f::Constant(0.5f);
+	Vector3i i = (p * GRIDSIZE).cast<int>().cwiseMax(0).cwiseMin((int)GRIDSIZE-1);
+	uint32_t idx = expand_bits(i.x()) | (expand_bits(i.y()) << 1) | (expand_bits(i.z()) << 2);
+	return bitfield[idx/8 + mip*N_BYTES_PER_CASCADE] & (1<<(idx%8));
+}
+
+inline uint64_t splitmix64(uint64_t& state) {
+	uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
+
+inline float random_float(uint64_t& state) {
+	return (float)(splitmix64(state) >> 40) * (1.0f / (1u << 24));
+}
+
+template <typename F>
+void for_each_index(uint32_t n, ThreadPool* pool, F&& body) {
+	if (!pool) {
+		for (uint32_t i = 0; i < n; ++i) {
+			body(i);
+		}
+		return;
+	}
+
+	pool->parallelFor<uint32_t>(0, n, body);
+}
+
+// Row-wise occupancy_distance_combine(): combines the rows `src + k*stride` of GRIDSIZE distances each,
+// k being the position along the line, into the distances of row `i`.
+void combine_rows(const uint8_t* src, size_t stride, int i, uint8_t* dst) {
+	const int n = (int)GRIDSIZE;
+	const uint8_t bound = (uint8_t)std::min(std::min(i + 1, n - i), (int)OCCUPANCY_DISTANCE_MAX);
+	const uint8_t* row = src + i * stride;
+
+	uint8_t max_distance = 0;
+	for (uint32_t x = 0; x < GRIDSIZE; ++x) {
+		dst[x] = std::min(row[x], bound);
+		max_distance = std::max(max_distance, dst[x]);
+	}
+
+	for (int k = 1; k < (int)max_distance; ++k) {
+		for (int j : {i - k, i + k}) {
+			if (j < 0 || j >= n) {
+				continue;
+			}
+
+			const uint8_t* other = src + j * stride;
+#ifdef NGP_OCCUPANCY_DISTANCE_SSE2
+			const __m128i kk = _mm_set1_epi8((char)k);
+			for (uint32_t x = 0; x < GRIDSIZE; x += 16) {
+				__m128i d = _mm_loadu_si128((const __m128i*)(dst + x));
+				__m128i o = _mm_max_epu8(_mm_loadu_si128((const __m128i*)(other + x)), kk);
+				_mm_storeu_si128((__m128i*)(dst + x), _mm_min_epu8(d, o));
+			}
+#else
+			for (uint32_t x = 0; x < GRIDSIZE; ++x) {
+				dst[x] = std::min(dst[x], std::max(other[x], (uint8_t)k));
+			}
+#endif
+		}
+	}
+}
+
+}
+
+uint32_t OccupancyDistanceField::update(const uint8_t* bitfield, uint32_t n_cascades, ThreadPool* pool) {
+	const size_t n_bytes = (size_t)n_cascades * N_BYTES_PER_CASCADE;
+	const uint32_t n_slices = n_cascades * GRIDSIZE;
+
+	bool rebuild = n_cascades != m_n_cascades;
+	if (rebuild) {
+		m_n_cascades = n_cascades;
+		m_bitfield.assign(n_bytes, 0);
+		m_distances.assign((size_t)n_cascades * N_CELLS, 0);
+		m_distances_xy.assign((size_t)n_cascades * N_CELLS, 0);
+	}
+
+	// Slices whose bits changed. Every chunk flags its own copy, which are merged afterwards.
+	std::vector<uint8_t> dirty(n_slices, rebuild ? 1 : 0);
+	if (!rebuild) {
+		const uint32_t n_chunks = (uint32_t)((n_bytes + CHUNK_BYTES - 1) / CHUNK_BYTES);
+		std::vector<std::vector<uint8_t>> chunk_dirty(n_chunks);
+		for_each_index(n_chunks, pool, [&](uint32_t chunk) {
+			size_t begin = (size_t)chunk * CHUNK_BYTES;
+			size_t end = std::min(begin + CHUNK_BYTES, n_bytes);
+			if (std::memcmp(bitfield + begin, m_bitfield.data() + begin, end - begin) == 0) {
+				return;
+			}
+
+			auto& flags = chunk_dirty[chunk];
+			flags.assign(n_slices, 0);
+			for (size_t i = begin; i < end; ++i) {
+				uint8_t diff = bitfield[i] ^ m_bitfield[i];
+				if (!diff) {
+					continue;
+				}
+
+				uint32_t cascade = (uint32_t)(i / N_BYTES_PER_CASCADE);
+				uint32_t idx = (uint32_t)(i % N_BYTES_PER_CASCADE) * 8;
+				for (uint32_t j = 0; j < 8; ++j) {
+					if (diff & (1 << j)) {
+						flags[cascade * GRIDSIZE + morton3D_invert((idx + j) >> 2)] = 1;
+					}
+				}
+			}
+		});
+
+		for (const auto& flags : chunk_dirty) {
+			for (uint32_t i = 0; i < flags.size(); ++i) {
+				dirty[i] |= flags[i];
+			}
+		}
+	}
+
+	std::vector<uint32_t> dirty_slices;
+	for (uint32_t i = 0; i < n_slices; ++i) {
+		if (dirty[i]) {
+			dirty_slices.emplace_back(i);
+		}
+	}
+
+	if (dirty_slices.empty()) {
+		return 0;
+	}
+
+	// Passes along x and y of the dirty slices. The first pass is written to the final distances of the
+	// slice, which are overwritten by the pass along z anyway.
+	for_each_index((uint32_t)dirty_slices.size(), pool, [&](uint32_t i) {
+		uint32_t cascade = dirty_slices[i] / GRIDSIZE;
+		uint32_t z = dirty_slices[i] % GRIDSIZE;
+		const uint8_t* cascade_bits = bitfield + (size_t)cascade * N_BYTES_PER_CASCADE;
+		uint8_t* rows = &m_distances[occupancy_distance_idx(cascade, 0, 0, z)];
+
+		for (uint32_t y = 0; y < GRIDSIZE; ++y) {
+			uint64_t bits[GRIDSIZE / 64] = {};
+			uint32_t yz = (expand_bits(y) << 1) | (expand_bits(z) << 2);
+			for (uint32_t x = 0; x < GRIDSIZE; ++x) {
+				uint32_t idx = expand_bits(x) | yz;
+				if (cascade_bits[idx/8] & (1 << (idx%8))) {
+					bits[x/64] |= 1ull << (x%64);
+				}
+			}
+			occupancy_distance_row(bits, rows + y * GRIDSIZE);
+		}
+
+		uint8_t* xy = &m_distances_xy[occupancy_distance_idx(cascade, 0, 0, z)];
+		for (uint32_t y = 0; y < GRIDSIZE; ++y) {
+			combine_rows(rows, GRIDSIZE, (int)y, xy + y * GRIDSIZE);
+		}
+	});
+
+	// Pass along z of all slices within reach of a dirty one
+	std::vector<uint32_t> affected_slices;
+	for (uint32_t i = 0; i < n_slices; ++i) {
+		uint32_t z = i % GRIDSIZE;
+		uint32_t begin = i - std::min(z, OCCUPANCY_DISTANCE_MAX-1);
+		uint32_t end = i + std::min(GRIDSIZE-1 - z, OCCUPANCY_DISTANCE_MAX-1);
+		for (uint32_t j = begin; j <= end; ++j) {
+			if (dirty[j]) {
+				affected_slices.emplace_back(i);
+				break;
+			}
+		}
+	}
+
+	for_each_index((uint32_t)affected_slices.size(), pool, [&](uint32_t i) {
+		uint32_t cascade = affected_slices[i] / GRIDSIZE;
+		uint32_t z = affected_slices[i] % GRIDSIZE;
+		const uint8_t* xy = &m_distances_xy[occupancy_distance_idx(cascade, 0, 0, 0)];
+		for (uint32_t y = 0; y < GRIDSIZE; ++y) {
+			combine_rows(xy + y * GRIDSIZE, GRIDSIZE * GRIDSIZE, (int)z, &m_distances[occupancy_distance_idx(cascade, 0, y, z)]);
+		}
+	});
+
+	std::memcpy(m_bitfield.data(), bitfield, n_bytes);
+	return (uint32_t)affected_slices.size();
+}
+
+void OccupancyDistanceField::clear() {
+	m_n_cascades = 0;
+	m_bitfield.clear();
+	m_distances.clear();
+	m_distances_xy.clear();
+}
+
+EmptySpaceSkippingBenchmark benchmark_empty_space_skipping(const OccupancyGrid& grid, float cone_angle, uint32_t n_rays, uint32_t seed, ThreadPool* pool) {
+	using namespace std::chrono;
+
+	EmptySpaceSkippingBenchmark result;
+	result.n_rays = n_rays;
+
+	const uint8_t* bitfield = grid.bitfield().data();
+
+	OccupancyDistanceField distance_field;
+	auto start = steady_clock::now();
+	distance_field.update(bitfield, CASCADES, pool);
+	result.build_milliseconds = duration<double, std::milli>(steady_clock::now() - start).count();
+	result.memory_bytes = distance_field.memory_bytes();
+
+	if (n_rays == 0) {
+		return result;
+	}
+
+	const AlignedBox3f aabb{Vector3f::Zero(), Vector3f::Ones()};
+
+	struct Ray {
+		Vector3f origin;
+		Vector3f dir;
+		float t_min;
+	};
+
+	std::vector<Ray> rays(n_rays);
+	uint64_t state = seed;
+	for (auto& ray : rays) {
+		Vector3f target = {random_float(state), random_float(state), random_float(state)};
+
+		float cos_theta = 2.0f * random_float(state) - 1.0f;
+		float sin_theta = std::sqrt(std::max(1.0f - cos_theta * cos_theta, 0.0f));
+		float phi = 6.28318530718f * random_float(state);
+		ray.dir = {sin_theta * std::cos(phi), sin_theta * std::sin(phi), cos_theta};
+		ray.origin = target - ray.dir * 2.0f;
+
+		// Entry into the unit cube
+		float t_min = 0.0f;
+		for (uint32_t i = 0; i < 3; ++i) {
+			if (ray.dir[i] != 0.0f) {
+				t_min = std::max(t_min, std::min(-ray.origin[i] / ray.dir[i], (1.0f - ray.origin[i]) / ray.dir[i]));
+			}
+		}
+		ray.t_min = t_min + 1e-6f;
+	}
+
+	// Same marching loop as generate_training_samples_nerf(): samples are taken in occupied cells and empty cells
+	// are skipped by regular steps of dt up to the next cell or, if given a distance field, the end of the free block.
+	auto march = [&](const Ray& ray, const uint8_t* distances, uint64_t& n_steps, uint64_t& n_samples) {
+		const Vector3f idir = ray.dir.cwiseInverse();
+		uint64_t hash = 0;
+
+		float t = ray.t_min;
+		Vector3f pos;
+		while (aabb.contains(pos = ray.origin + t * ray.dir)) {
+			++n_steps;
+			float dt = calc_dt(t, cone_angle);
+			uint32_t mip = mip_from_dt(dt, pos);
+			if (density_grid_occupied_at(pos, bitfield, mip)) {
+				uint32_t bits;
+				std::memcpy(&bits, &t, sizeof(bits));
+				hash = hash * 1099511628211ull + bits;
+				++n_samples;
+				t += dt;
+				continue;
+			}
+
+			uint32_t res = GRIDSIZE>>mip;
+			float t_target = t + distance_to_free_block_exit(pos, ray.dir, idir, res, 1);
+			if (distances) {
+				// Coarser cascades that the ray switches to within the free block may be occupied there
+				uint32_t distance = occupancy_distance_at(pos, distances, mip);
+				if (distance > 1) {
+					float t_block = t + distance_to_free_block_exit(pos, ray.dir, idir, res, distance);
+					if ((uint32_t)mip_from_dt(calc_dt(t_block, cone_angle), pos) == mip) {
+						t_target = std::max(t_target, t_block);
+					}
+				}
+			}
+
+			do {
+				t += calc_dt(t, cone_angle);
+			} while (t < t_target);
+		}
+
+		return hash;
+	};
+
+	std::vector<uint64_t> hashes(n_rays);
+	uint64_t n_steps = 0, n_samples = 0;
+	start = steady_clock::now();
+	for (uint32_t i = 0; i < n_rays; ++i) {
+		hashes[i] = march(rays[i], nullptr, n_steps, n_samples);
+	}
+	result.ns_per_ray = duration<double, std::nano>(steady_clock::now() - start).count() / n_rays;
+	result.steps_per_ray = (double)n_steps / n_rays;
+	result.samples_per_ray = (double)n_samples / n_rays;
+
+	n_steps = 0;
+	n_samples = 0;
+	start = steady_clock::now();
+	for (uint32_t i = 0; i < n_rays; ++i) {
+		if (march(rays[i], distance_field.data(), n_steps, n_samples) != hashes[i]) {
+			++result.n_rays_with_different_samples;
+		}
+	}
+	result.ns_per_ray_skipping = duration<double, std::nano>(steady_clock::now() - start).count() / n_rays;
+	result.steps_per_ray_skipping = (double)n_steps / n_rays;
+
+	return result;
+}
+
+NGP_NAMESPACE_END
@@ -0,0 +1,560 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+/** @file   occupancy_grid.cpp
+ *  @author Thomas Müller, NVIDIA
+ *  @brief  Host-side copy of the NeRF density grid and its occupancy bitfield. Thresholding and
+ *          max-pooling are vectorized with SSE2, or AVX when compiled with NGP_BUILD_HOST_SIMD.
+ */
+
+#include <neural-graphics-primitives/nerf_network_cpu.h>
+#include <neural-graphics-primitives/occupancy_grid.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#if defined(__AVX__)
+#  define NGP_OCCUPANCY_GRID_AVX
+#  include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#  define NGP_OCCUPANCY_GRID_SSE2
+#  include <emmintrin.h>
+#endif
+
+using namespace Eigen;
+using namespace nlohmann;
+
+NGP_NAMESPACE_BEGIN
+
+namespace {
+
+constexpr uint32_t GRIDSIZE = OccupancyGrid::GRIDSIZE;
+constexpr uint32_t CASCADES = OccupancyGrid::CASCADES;
+constexpr uint32_t N_CELLS = OccupancyGrid::N_CELLS_PER_CASCADE;
+constexpr uint32_t N_BYTES_PER_CASCADE = N_CELLS / 8;
+
+// Bytes of the bitfield that are processed by one task
+constexpr uint32_t CHUNK_BYTES = 1 << 14;
+
+// The helpers below mirror their __device__ counterparts in testbed_nerf.cu.
+inline uint32_t expand_bits(uint32_t v) {
+	v = (v * 0x00010001u) & 0xFF0000FFu;
+	v = (v * 0x00000101u) & 0x0F00F00Fu;
+	v = (v * 0x00000011u) & 0xC30C30C3u;
+	v = (v * 0x00000005u) & 0x49249249u;
+	return v;
+}
+
+inline uint32_t morton3D(uint32_t x, uint32_t y, uint32_t z) {
+	return expand_bits(x) | (expand_bits(y) << 1) | (expand_bits(z) << 2);
+}
+
+inline uint32_t morton3D_invert(uint32_t x) {
+	x = x & 0x49249249;
+	x = (x | (x >> 2)) & 0xc30c30c3;
+	x = (x | (x >> 4)) & 0x0f00f00f;
+	x = (x | (x >> 8)) & 0xff0000ff;
+	x = (x | (x >> 16)) & 0x0000ffff;
+	return x;
+}
+
+inline uint32_t popcount(uint64_t x) {
+	x = x - ((x >> 1) & 0x5555555555555555ull);
+	x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+	x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0full;
+	return (uint32_t)((x * 0x0101010101010101ull) >> 56);
+}
+
+uint32_t popcount(const uint8_t* bytes, uint32_t n_bytes) {
+	uint32_t result = 0;
+	uint32_t i = 0;
+	for (; i + 8 <= n_bytes; i += 8) {
+		uint64_t word;
+		std::memcpy(&word, bytes + i, sizeof(word));
+		result += popcount(word);
+	}
+	for (; i < n_bytes; ++i) {
+		result += popcount((uint64_t)bytes[i]);
+	}
+	return result;
+}
+
+// Calls `body(begin, end)` for chunks of [0, n_bytes), in parallel if a pool is given.
+template <typename F>
+void for_each_chunk(uint32_t n_bytes, ThreadPool* pool, F&& body) {
+	if (!pool || n_bytes <= CHUNK_BYTES) {
+		body(0u, n_bytes);
+		return;
+	}
+
+	uint32_t n_chunks = (n_bytes + CHUNK_BYTES - 1) / CHUNK_BYTES;
+	pool->parallelFor<uint32_t>(0, n_chunks, [&](uint32_t chunk) {
+		body(chunk * CHUNK_BYTES, std::min(n_bytes, (chunk + 1) * CHUNK_BYTES));
+	});
+}
+
+template <typename F>
+void for_each_index(uint32_t n, ThreadPool* pool, F&& body) {
+	if (!pool) {
+		for (uint32_t i = 0; i < n; ++i) {
+			body(i);
+		}
+		return;
+	}
+
+	pool->parallelFor<uint32_t>(0, n, body);
+}
+
+// Mean of the non-negative densities. The partial sums of the chunks are added in a fixed
+// order, such that the result does not depend on the number of threads.
+double mean_density(const float* density, uint32_t n, ThreadPool* pool) {
+	constexpr uint32_t CHUNK = CHUNK_BYTES * 8;
+	uint32_t n_chunks = (n + CHUNK - 1) / CHUNK;
+	std::vector<double> sums(n_chunks, 0.0);
+
+	for_each_index(n_chunks, pool, [&](uint32_t chunk) {
+		double sum = 0.0;
+		for (uint32_t i = chunk * CHUNK; i < std::min(n, (chunk + 1) * CHUNK); ++i) {
+			sum += std::max(density[i], 0.0f);
+		}
+		sums[chunk] = sum;
+	});
+
+	double result = 0.0;
+	for (double sum : sums) {
+		result += sum;
+	}
+	return result / n;
+}
+
+// One bit per density, set if the density exceeds `thresh`.
+void threshold_to_bits(const float* density, float thresh, uint8_t* bits, uint32_t n_bytes, ThreadPool* pool) {
+	for_each_chunk(n_bytes, pool, [&](uint32_t begin, uint32_t end) {
+#if defined(NGP_OCCUPANCY_GRID_AVX)
+		const __m256 t = _mm256_set1_ps(thresh);
+		for (uint32_t i = begin; i < end; ++i) {
+			bits[i] = (uint8_t)_mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(density + i*8), t, _CMP_GT_OQ));
+		}
+#elif defined(NGP_OCCUPANCY_GRID_SSE2)
+		const __m128 t = _mm_set1_ps(thresh);
+		for (uint32_t i = begin; i < end; ++i) {
+			int lo = _mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(density + i*8), t));
+			int hi = _mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(density + i*8 + 4), t));
+			bits[i] = (uint8_t)(lo | (hi << 4));
+		}
+#else
+		for (uint32_t i = begin; i < end; ++i) {
+			uint8_t result = 0;
+			for (uint8_t j = 0; j < 8; ++j) {
+				result |= density[i*8+j] > thresh ? ((uint8_t)1 << j) : 0;
+			}
+			bits[i] = result;
+		}
+#endif
+	});
+}
+
+// Same as bitfield_max_pool() in testbed_nerf.cu: every cascade is max-pooled into the center of the next coarser one.
+void max_pool_mips(uint8_t* bitfield, ThreadPool* pool) {
+	// Every byte of the finer level pools into one bit of the coarser one.
+	constexpr uint32_t N_POOLED_BYTES = N_BYTES_PER_CASCADE / 8;
+
+	for (uint32_t level = 1; level < CASCADES; ++level) {
+		const uint8_t* prev_level = bitfield + (level-1) * N_BYTES_PER_CASCADE;
+		uint8_t* next_level = bitfield + level * N_BYTES_PER_CASCADE;
+
+		// Different `i` map to different bytes of the next level, hence chunks can be pooled concurrently.
+		for_each_chunk(N_POOLED_BYTES, pool, [&](uint32_t begin, uint32_t end) {
+			auto store = [&](uint32_t i, uint8_t bits) {
+				uint32_t x = morton3D_invert(i>>0) + GRIDSIZE/8;
+				uint32_t y = morton3D_invert(i>>1) + GRIDSIZE/8;
+				uint32_t z = morton3D_invert(i>>2) + GRIDSIZE/8;
+				next_level[morton3D(x, y, z)] |= bits;
+			};
+
+			uint32_t i = begin;
+#if defined(NGP_OCCUPANCY_GRID_AVX) || defined(NGP_OCCUPANCY_GRID_SSE2)
+			const __m128i zero = _mm_setzero_si128();
+			for (; i + 2 <= end; i += 2) {
+				__m128i v = _mm_loadu_si128((const __m128i*)(prev_level + i*8));
+				uint32_t nonzero = ~(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)) & 0xFFFF;
+				store(i, (uint8_t)nonzero);
+				store(i+1, (uint8_t)(nonzero >> 8));
+			}
+#endif
+			for (; i < end; ++i) {
+				uint8_t bits = 0;
+				for (uint8_t j = 0; j < 8; ++j) {
+					bits |= prev_level[i*8+j] > 0 ? ((uint8_t)1 << j) : 0;
+				}
+				store(i, bits);
+			}
+		});
+	}
+}
+
+// Shifts a row of GRIDSIZE bits towards higher (`shift` > 0) or lower x.
+inline void shift_row(const uint64_t* row, int shift, uint64_t* result) {
+	static_assert(GRIDSIZE == 128, "Rows are assumed to consist of two words.");
+	uint64_t lo = row[0], hi = row[1];
+	if (shift >= 64) {
+		hi = lo << (shift - 64);
+		lo = 0;
+	} else if (shift > 0) {
+		hi = (hi << shift) | (lo >> (64 - shift));
+		lo <<= shift;
+	} else if (shift <= -64) {
+		lo = hi >> (-shift - 64);
+		hi = 0;
+	} else if (shift < 0) {
+		lo = (lo >> -shift) | (hi << (64 + shift));
+		hi >>= -shift;
+	}
+	result[0] = lo;
+	result[1] = hi;
+}
+
+}
+
+void nerf_density_grid_to_bitfield(const float* density_grid, uint8_t* bitfield, ThreadPool* pool) {
+	// Same threshold as Testbed::update_density_grid_mean_and_bitfield(): the mean density of the finest cascade
+	const float thresh = std::min(OccupancyGrid::MIN_OPTICAL_THICKNESS, (float)mean_density(density_grid, N_CELLS, pool));
+
+	threshold_to_bits(density_grid, thresh, bitfield, N_BYTES_PER_CASCADE * CASCADES, pool);
+	max_pool_mips(bitfield, pool);
+}
+
+void OccupancyGrid::load(const json& config, ThreadPool* pool) {
+	if (!config.contains("snapshot")) {
+		throw std::runtime_error{"OccupancyGrid: network config does not contain a snapshot."};
+	}
+
+	const json& snapshot = config["snapshot"];
+	if (!snapshot.contains("density_grid_binary")) {
+		throw std::runtime_error{"OccupancyGrid: snapshot does not contain a density grid."};
+	}
+
+	if (snapshot.value("density_grid_size", 0u) != GRIDSIZE) {
+		throw std::runtime_error{"Incompatible grid size in snapshot."};
+	}
+
+	const auto& grid_binary = snapshot["density_grid_binary"].get_binary();
+	if (grid_binary.size() < N_ELEMENTS * sizeof(float)) {
+		throw std::runtime_error{"OccupancyGrid: density grid in snapshot is too small."};
+	}
+
+	std::vector<float> density_grid(N_ELEMENTS);
+	std::memcpy(density_grid.data(), grid_binary.data(), N_ELEMENTS * sizeof(float));
+	set_density_grid(std::move(density_grid), pool);
+}
+
+void OccupancyGrid::load_snapshot(const std::string& path, ThreadPool* pool) {
+	load(CpuNerfNetwork::read_snapshot(path), pool);
+}
+
+void OccupancyGrid::save(json& config) const {
+	if (m_density_grid.size() != N_ELEMENTS) {
+		throw std::runtime_error{"OccupancyGrid: no density grid to save."};
+	}
+
+	// Free cells get a non-positive and occupied cells a density above MIN_OPTICAL_THICKNESS. The threshold
+	// of update_density_grid_mean_and_bitfield(), min(MIN_OPTICAL_THICKNESS, mean density), lies inbetween,
+	// whichever the mean density turns out to be. Untrained (negative) and already fitting densities are kept.
+	const float occupied_density = std::nextafter(MIN_OPTICAL_THICKNESS, std::numeric_limits<float>::infinity());
+
+	std::vector<uint8_t> bytes(N_ELEMENTS * sizeof(float));
+	float* density = (float*)bytes.data();
+	for (uint32_t i = 0; i < N_ELEMENTS; ++i) {
+		float d = m_density_grid[i];
+		if (m_own_bits[i/8] & (1 << (i%8))) {
+			density[i] = d > occupied_density ? d : occupied_density;
+		} else {
+			density[i] = d > 0.0f ? 0.0f : d;
+		}
+	}
+
+	json& snapshot = config["snapshot"];
+	snapshot["density_grid_size"] = GRIDSIZE;
+	snapshot["density_grid_binary"] = json::binary_t{std::move(bytes)};
+}
+
+void OccupancyGrid::save_snapshot(const std::string& path) const {
+	json config = CpuNerfNetwork::read_snapshot(path);
+	save(config);
+
+	// Same format as Testbed::save_snapshot()
+	std::ofstream f{path, std::ios::out | std::ios::binary};
+	if (!f) {
+		throw std::runtime_error{"Could not write snapshot \"" + path + "\"."};
+	}
+	json::to_msgpack(config, f);
+}
+
+void OccupancyGrid::set_density_grid(std::vector<float> density_grid, ThreadPool* pool) {
+	if (density_grid.size() != N_ELEMENTS) {
+		throw std::runtime_error{"OccupancyGrid: density grid must have " + std::to_string(N_ELEMENTS) + " elements."};
+	}
+
+	m_density_grid = std::move(density_grid);
+	update_bitfield(pool);
+}
+
+bool OccupancyGrid::occupied(uint32_t cascade, uint32_t x, uint32_t y, uint32_t z) const {
+	uint32_t idx = morton3D(x, y, z);
+	return m_own_bits[cascade * N_BYTES_PER_CASCADE + idx/8] & (1 << (idx%8));
+}
+
+void OccupancyGrid::set_occupied(uint32_t cascade, uint32_t x, uint32_t y, uint32_t z, bool value) {
+	uint32_t idx = morton3D(x, y, z);
+	uint8_t& byte = m_own_bits[cascade * N_BYTES_PER_CASCADE + idx/8];
+	byte = value ? (byte | (1 << (idx%8))) : (byte & ~(1 << (idx%8)));
+}
+
+uint32_t OccupancyGrid::cascade_at(const Vector3f& pos) {
+	int exponent;
+	float maxval = (pos - Vector3f::Constant(0.5f)).cwiseAbs().maxCoeff();
+	std::frexp(maxval, &exponent);
+	return (uint32_t)std::min((int)CASCADES-1, std::max(0, exponent+1));
+}
+
+bool OccupancyGrid::occupied_at(const Vector3f& pos) const {
+	uint32_t mip = cascade_at(pos);
+
+	// Same as cascaded_grid_idx_at(), which clamps positions outside of the coarsest cascade
+	Vector3f p = (pos - Vector3f::Constant(0.5f)) * std::scalbnf(1.0f, -(int)mip) + Vector3f::Constant(0.5f);
+	Vector3i i = (p * (float)GRIDSIZE).cast<int>().cwiseMax(0).cwiseMin((int)GRIDSIZE-1);
+	uint32_t idx = morton3D(i.x(), i.y(), i.z());
+	return m_bitfield[mip * N_BYTES_PER_CASCADE + idx/8] & (1 << (idx%8));
+}
+
+void OccupancyGrid::update_bitfield(ThreadPool* pool) {
+	m_own_bits.resize(N_ELEMENTS/8);
+	const float thresh = std::min(MIN_OPTICAL_THICKNESS, (float)mean_density(m_density_grid.data(), N_CELLS, pool));
+	threshold_to_bits(m_density_grid.data(), thresh, m_own_bits.data(), N_ELEMENTS/8, pool);
+	update_mips(pool);
+}
+
+void OccupancyGrid::update_mips(ThreadPool* pool) {
+	m_bitfield = m_own_bits;
+	max_pool_mips(m_bitfield.data(), pool);
+}
+
+std::vector<OccupancyGridCascadeStats> OccupancyGrid::stats(ThreadPool* pool) const {
+	std::vector<OccupancyGridCascadeStats> result(CASCADES);
+
+	for (uint32_t cascade = 0; cascade < CASCADES; ++cascade) {
+		auto& stats = result[cascade];
+		const uint8_t* own = m_own_bits.data() + cascade * N_BYTES_PER_CASCADE;
+		const uint8_t* pooled = m_bitfield.data() + cascade * N_BYTES_PER_CASCADE;
+
+		stats.n_occupied = popcount(own, N_BYTES_PER_CASCADE);
+		stats.n_occupied_pooled = popcount(pooled, N_BYTES_PER_CASCADE);
+		stats.occupied_fraction = (float)stats.n_occupied / N_CELLS;
+		stats.occupied_fraction_pooled = (float)stats.n_occupied_pooled / N_CELLS;
+		stats.mean_density = (float)mean_density(m_density_grid.data() + cascade * N_CELLS, N_CELLS, pool);
+
+		// Index bounds of the occupied cells, per chunk and then merged
+		constexpr uint32_t N_CHUNKS = N_BYTES_PER_CASCADE / CHUNK_BYTES;
+		std::vector<Vector3i> mins(N_CHUNKS, Vector3i::Constant(GRIDSIZE)), maxs(N_CHUNKS, Vector3i::Constant(-1));
+		for_each_index(N_CHUNKS, pool, [&](uint32_t chunk) {
+			for (uint32_t i = chunk * CHUNK_BYTES; i < (chunk + 1) * CHUNK_BYTES; ++i) {
+				if (!pooled[i]) {
+					continue;
+				}
+
+				for (uint32_t j = 0; j < 8; ++j) {
+					if (pooled[i] & (1 << j)) {
+						uint32_t idx = i*8+j;
+						Vector3i cell{(int)morton3D_invert(idx>>0), (int)morton3D_invert(idx>>1), (int)morton3D_invert(idx>>2)};
+						mins[chunk] = mins[chunk].cwiseMin(cell);
+						maxs[chunk] = maxs[chunk].cwiseMax(cell);
+					}
+				}
+			}
+		});
+
+		Vector3i min = Vector3i::Constant(GRIDSIZE), max = Vector3i::Constant(-1);
+		for (uint32_t chunk = 0; chunk < N_CHUNKS; ++chunk) {
+			min = min.cwiseMin(mins[chunk]);
+			max = max.cwiseMax(maxs[chunk]);
+		}
+
+		stats.occupied_aabb.setEmpty();
+		if (stats.n_occupied_pooled > 0) {
+			const float scale = std::scalbnf(1.0f, cascade);
+			stats.occupied_aabb = AlignedBox3f{
+				((min.cast<float>() / (float)GRIDSIZE).array() - 0.5f) * scale + 0.5f,
+				(((max + Vector3i::Ones()).cast<float>() / (float)GRIDSIZE).array() - 0.5f) * scale + 0.5f,
+			};
+		}
+	}
+
+	return result;
+}
+
+void OccupancyGrid::dilate(uint32_t radius, ThreadPool* pool) {
+	if (radius == 0) {
+		return;
+	}
+
+	for (uint32_t cascade = 0; cascade < CASCADES; ++cascade) {
+		Volume volume = extract_volume(cascade, pool);
+		dilate_volume(volume, radius, pool);
+		insert_volume(cascade, volume, pool);
+	}
+
+	update_mips(pool);
+}
+
+void OccupancyGrid::erode(uint32_t radius, ThreadPool* pool) {
+	if (radius == 0) {
+		return;
+	}
+
+	// Erosion is the complement of dilating the complement. Cells outside of the grid are free in
+	// the complement and hence occupied in the result.
+	for (uint32_t cascade = 0; cascade < CASCADES; ++cascade) {
+		Volume volume = extract_volume(cascade, pool);
+		for (auto& word : volume) {
+			word = ~word;
+		}
+		dilate_volume(volume, radius, pool);
+		for (auto& word : volume) {
+			word = ~word;
+		}
+		insert_volume(cascade, volume, pool);
+	}
+
+	update_mips(pool);
+}
+
+void OccupancyGrid::crop(const AlignedBox3f& aabb, ThreadPool* pool) {
+	for (uint32_t cascade = 0; cascade < CASCADES; ++cascade) {
+		// The box is axis-aligned, hence whether a cell is inside factorizes into its coordinates.
+		std::array<uint8_t, GRIDSIZE> inside[3];
+		for (uint32_t dim = 0; dim < 3; ++dim) {
+			for (uint32_t i = 0; i < GRIDSIZE; ++i) {
+				float center = cell_center(cascade, i, i, i)[dim];
+				inside[dim][i] = center >= aabb.min()[dim] && center <= aabb.max()[dim];
+			}
+		}
+
+		uint8_t* own = m_own_bits.data() + cascade * N_BYTES_PER_CASCADE;
+		for_each_chunk(N_BYTES_PER_CASCADE, pool, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; ++i) {
+				if (!own[i]) {
+					continue;
+				}
+
+				uint8_t mask = 0;
+				for (uint32_t j = 0; j < 8; ++j) {
+					uint32_t idx = i*8+j;
+					if (inside[0][morton3D_invert(idx>>0)] && inside[1][morton3D_invert(idx>>1)] && inside[2][morton3D_invert(idx>>2)]) {
+						mask |= 1 << j;
+					}
+				}
+				own[i] &= mask;
+			}
+		});
+	}
+
+	update_mips(pool);
+}
+
+Vector3f OccupancyGrid::cell_center(uint32_t cascade, uint32_t x, uint32_t y, uint32_t z) {
+	// Inverse of cascaded_grid_idx_at()
+	Vector3f pos = (Vector3f{(float)x, (float)y, (float)z} + Vector3f::Constant(0.5f)) / (float)GRIDSIZE;
+	return (pos.array() - 0.5f) * std::scalbnf(1.0f, cascade) + 0.5f;
+}
+
+OccupancyGrid::Volume OccupancyGrid::extract_volume(uint32_t cascade, ThreadPool* pool) const {
+	Volume volume(GRIDSIZE * GRIDSIZE * WORDS_PER_ROW, 0);
+	const uint8_t* own = m_own_bits.data() + cascade * N_BYTES_PER_CASCADE;
+
+	// Every z-slice owns its words
+	for_each_index(GRIDSIZE, pool, [&](uint32_t z) {
+		for (uint32_t y = 0; y < GRIDSIZE; ++y) {
+			uint64_t* row = volume.data() + (z * GRIDSIZE + y) * WORDS_PER_ROW;
+			for (uint32_t x = 0; x < GRIDSIZE; ++x) {
+				uint32_t idx = morton3D(x, y, z);
+				if (own[idx/8] & (1 << (idx%8))) {
+					row[x/64] |= 1ull << (x%64);
+				}
+			}
+		}
+	});
+
+	return volume;
+}
+
+void OccupancyGrid::insert_volume(uint32_t cascade, const Volume& volume, ThreadPool* pool) {
+	uint8_t* own = m_own_bits.data() + cascade * N_BYTES_PER_CASCADE;
+
+	// Every byte of the bitfield owns its bits
+	for_each_chunk(N_BYTES_PER_CASCADE, pool, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i) {
+			uint8_t bits = 0;
+			for (uint32_t j = 0; j < 8; ++j) {
+				uint32_t idx = i*8+j;
+				uint32_t x = morton3D_invert(idx>>0), y = morton3D_invert(idx>>1), z = morton3D_invert(idx>>2);
+				if (volume[(z * GRIDSIZE + y) * WORDS_PER_ROW + x/64] & (1ull << (x%64))) {
+					bits |= 1 << j;
+				}
+			}
+			own[i] = bits;
+		}
+	});
+}
+
+void OccupancyGrid::dilate_volume(Volume& volume, uint32_t radius, ThreadPool* pool) {
+	// A box of side 2*radius+1 is separable: dilate along x, then y, then z.
+	const int r = (int)std::min(radius, GRIDSIZE - 1);
+
+	for_each_index(GRIDSIZE, pool, [&](uint32_t z) {
+		for (uint32_t y = 0; y < GRIDSIZE; ++y) {
+			uint64_t* row = volume.data() + (z * GRIDSIZE + y) * WORDS_PER_ROW;
+			uint64_t result[WORDS_PER_ROW] = {row[0], row[1]};
+			for (int s = 1; s <= r; ++s) {
+				uint64_t shifted[WORDS_PER_ROW];
+				shift_row(row, s, shifted);
+				result[0] |= shifted[0]; result[1] |= shifted[1];
+				shift_row(row, -s, shifted);
+				result[0] |= shifted[0]; result[1] |= shifted[1];
+			}
+			row[0] = result[0];
+			row[1] = result[1];
+		}
+	});
+
+	// Along y and then z. Every task dilates lines of rows that no other task touches.
+	Volume source;
+	auto dilate_lines = [&](auto row_index) {
+		source = volume;
+		for_each_index(GRIDSIZE, pool, [&](uint32_t line) {
+			for (int t = 0; t < (int)GRIDSIZE; ++t) {
+				uint64_t* dst = volume.data() + row_index(line, t) * WORDS_PER_ROW;
+				for (int u = std::max(t - r, 0); u <= std::min(t + r, (int)GRIDSIZE - 1); ++u) {
+					const uint64_t* src = source.data() + row_index(line, u) * WORDS_PER_ROW;
+					dst[0] |= src[0];
+					dst[1] |= src[1];
+				}
+			}
+		});
+	};
+
+	dilate_lines([](uint32_t z, int y) { return z * GRIDSIZE + y; });
+	dilate_lines([](uint32_t y, int z) { return z * GRIDSIZE + y; });
+}
+
+NGP_NAMESPACE_END
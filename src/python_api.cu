@@ -12,14 +12,22 @@
  *  @author Thomas Müller & Alex Evans, NVIDIA
  */
 
+#include <neural-graphics-primitives/batch_render.h>
+#include <neural-graphics-primitives/nerf_renderer_cpu.h>
+#include <neural-graphics-primitives/occupancy_distance_field.h>
+#include <neural-graphics-primitives/occupancy_grid.h>
+#include <neural-graphics-primitives/scene_cache.h>
+#include <neural-graphics-primitives/sparse_occupancy.h>
 #include <neural-graphics-primitives/testbed.h>
 #include <neural-graphics-primitives/thread_pool.h>
+#include <neural-graphics-primitives/training_session.h>
 
 #include <json/json.hpp>
 
 #include <pybind11/pybind11.h>
 #include <pybind11/numpy.h>
 #include <pybind11/eigen.h>
+#include <pybind11/functional.h>
 #include <pybind11/stl.h>
 #include <pybind11_json/pybind11_json.hpp>
 
@@ -75,102 +83,203 @@ void Testbed::override_sdf_training_data(py::array_t<float> points, py::array_t<
 	m_sdf.training.generate_sdf_data_online = false;
 }
 
+// Returns a numpy array that views `buffer` without copying. The array keeps the buffer alive;
+// if python still references the array of a previous call, a new buffer is allocated instead.
+template <typename T>
+py::array_t<T> staging_array(std::shared_ptr<std::vector<T>>& buffer, const std::vector<py::ssize_t>& shape) {
+	size_t n_elements = 1;
+	for (auto dim : shape) {
+		n_elements *= (size_t)dim;
+	}
+
+	if (!buffer || buffer.use_count() > 1) {
+		buffer = std::make_shared<std::vector<T>>();
+	}
+
+	buffer->resize(n_elements);
+
+	py::capsule owner{new std::shared_ptr<std::vector<T>>{buffer}, [](void* ptr) {
+		delete (std::shared_ptr<std::vector<T>>*)ptr;
+	}};
+
+	return py::array_t<T>(shape, buffer->data(), owner);
+}
+
+// Validates a caller-provided output array that results are written into directly.
+py::array_t<float> writeable_out_array(const py::object& out, size_t n_floats) {
+	if (!py::isinstance<py::array_t<float>>(out)) {
+		throw std::runtime_error{"`out` must be a float32 numpy array."};
+	}
+
+	auto result = py::reinterpret_borrow<py::array_t<float>>(out);
+	if (!(result.flags() & py::array::c_style) || !result.writeable() || (size_t)result.size() != n_floats) {
+		throw std::runtime_error{"`out` must be a writeable, C-contiguous array of " + std::to_string(n_floats) + " floats."};
+	}
+
+	return result;
+}
+
 pybind11::dict Testbed::compute_marching_cubes_mesh(Eigen::Vector3i res3d, BoundingBox aabb, float thresh) {
 	if (aabb.is_empty()) {
 		aabb = (m_testbed_mode == ETestbedMode::Nerf) ? m_render_aabb : m_aabb;
 	}
 
-	marching_cubes(res3d, aabb, thresh);
+	{
+		py::gil_scoped_release release;
+		marching_cubes(res3d, aabb, thresh);
+	}
+
+	py::array_t<float> cpuverts = staging_array(m_python_staging.mesh_verts, {(py::ssize_t)m_mesh.verts.size(), 3});
+	py::array_t<float> cpunormals = staging_array(m_python_staging.mesh_normals, {(py::ssize_t)m_mesh.vert_normals.size(), 3});
+	py::array_t<float> cpucolors = staging_array(m_python_staging.mesh_colors, {(py::ssize_t)m_mesh.vert_colors.size(), 3});
+	py::array_t<int> cpuindices = staging_array(m_python_staging.mesh_indices, {(py::ssize_t)m_mesh.indices.size()/3, 3});
+
+	{
+		py::gil_scoped_release release;
 
-	py::array_t<float> cpuverts({(int)m_mesh.verts.size(), 3});
-	py::array_t<float> cpunormals({(int)m_mesh.vert_normals.size(), 3});
-	py::array_t<float> cpucolors({(int)m_mesh.vert_colors.size(), 3});
-	py::array_t<int> cpuindices({(int)m_mesh.indices.size()/3, 3});
-	CUDA_CHECK_THROW(cudaMemcpy(cpuverts.request().ptr, m_mesh.verts.data() , m_mesh.verts.size() * 3 * sizeof(float), cudaMemcpyDeviceToHost));
-	CUDA_CHECK_THROW(cudaMemcpy(cpunormals.request().ptr, m_mesh.vert_normals.data() , m_mesh.vert_normals.size() * 3 * sizeof(float), cudaMemcpyDeviceToHost));
-	CUDA_CHECK_THROW(cudaMemcpy(cpucolors.request().ptr, m_mesh.vert_colors.data() , m_mesh.vert_colors.size() * 3 * sizeof(float), cudaMemcpyDeviceToHost));
-	CUDA_CHECK_THROW(cudaMemcpy(cpuindices.request().ptr, m_mesh.indices.data() , m_mesh.indices.size() * sizeof(int), cudaMemcpyDeviceToHost));
+		CUDA_CHECK_THROW(cudaMemcpy(m_python_staging.mesh_verts->data(), m_mesh.verts.data() , m_mesh.verts.size() * 3 * sizeof(float), cudaMemcpyDeviceToHost));
+		CUDA_CHECK_THROW(cudaMemcpy(m_python_staging.mesh_normals->data(), m_mesh.vert_normals.data() , m_mesh.vert_normals.size() * 3 * sizeof(float), cudaMemcpyDeviceToHost));
+		CUDA_CHECK_THROW(cudaMemcpy(m_python_staging.mesh_colors->data(), m_mesh.vert_colors.data() , m_mesh.vert_colors.size() * 3 * sizeof(float), cudaMemcpyDeviceToHost));
+		CUDA_CHECK_THROW(cudaMemcpy(m_python_staging.mesh_indices->data(), m_mesh.indices.data() , m_mesh.indices.size() * sizeof(int), cudaMemcpyDeviceToHost));
 
-	Eigen::Vector3f* ns = (Eigen::Vector3f*)cpunormals.request().ptr;
-	for (size_t i = 0; i < m_mesh.vert_normals.size(); ++i) {
-		ns[i].normalize();
+		Eigen::Vector3f* ns = (Eigen::Vector3f*)m_python_staging.mesh_normals->data();
+		for (size_t i = 0; i < m_mesh.vert_normals.size(); ++i) {
+			ns[i].normalize();
+		}
 	}
 
 	return py::dict("V"_a=cpuverts, "N"_a=cpunormals, "C"_a=cpucolors, "F"_a=cpuindices);
 }
 
 
-py::array_t<float> Testbed::render_to_cpu(int width, int height, int spp, bool linear, float start_time, float end_time, float fps, float shutter_fraction) {
-	m_windowless_render_surface.resize({width, height});
-	m_windowless_render_surface.reset_accumulation();
+py::array_t<float> Testbed::render_to_cpu(int width, int height, int spp, bool linear, float start_time, float end_time, float fps, float shutter_fraction, py::object out) {
+	py::array_t<float> result = out.is_none() ?
+		staging_array(m_python_staging.render, {height, width, 4}) :
+		writeable_out_array(out, (size_t)width * height * 4);
 
-	if (end_time < 0.f) {
-		end_time = start_time;
-	}
+	float* dst = result.mutable_data();
 
-	auto start_cam_matrix = m_smoothed_camera;
+	{
+		py::gil_scoped_release release;
 
-	if (start_time >= 0.f) {
-		set_camera_from_time(end_time);
-		apply_camera_smoothing(1000.f / fps);
-	} else {
-		start_cam_matrix = m_smoothed_camera = m_camera;
+		m_windowless_render_surface.resize({width, height});
+		m_windowless_render_surface.reset_accumulation();
+
+		render_camera_path_frame(m_windowless_render_surface, spp, !linear, start_time, end_time, fps, shutter_fraction);
+
+		CUDA_CHECK_THROW(cudaMemcpy2DFromArray(dst, width * sizeof(float) * 4, m_windowless_render_surface.surface_provider().array(), 0, 0, width * sizeof(float) * 4, height, cudaMemcpyDeviceToHost));
 	}
 
-	auto end_cam_matrix = m_smoothed_camera;
+	return result;
+}
+
+BatchRenderPlan plan_batch_render(const py::array_t<float, py::array::c_style | py::array::forcecast>& camera_matrices, const std::vector<Vector2i>& resolutions, const std::vector<uint32_t>& spps) {
+	py::buffer_info buf = camera_matrices.request();
+	if (buf.ndim != 3 || buf.shape[1] != 3 || buf.shape[2] != 4) {
+		throw std::runtime_error{"Batch render: camera matrices must have shape (N, 3, 4)."};
+	}
 
-	for (int i = 0; i < spp; ++i) {
-		float start_alpha = ((float)i)/(float)spp * shutter_fraction;
-		float end_alpha = ((float)i + 1.0f)/(float)spp * shutter_fraction;
+	return plan_batch_render((const float*)buf.ptr, (size_t)buf.shape[0], resolutions, spps);
+}
 
-		auto sample_start_cam_matrix = log_space_lerp(start_cam_matrix, end_cam_matrix, start_alpha);
-		auto sample_end_cam_matrix = log_space_lerp(start_cam_matrix, end_cam_matrix, end_alpha);
+// Returns `out` if it can hold the rendered views, otherwise allocates a new array.
+py::array_t<float> batch_render_output(const BatchRenderPlan& plan, const py::object& out) {
+	return out.is_none() ? py::array_t<float>(plan.n_floats) : writeable_out_array(out, plan.n_floats);
+}
 
-		if (start_time >= 0.f) {
-			set_camera_from_time(start_time + (end_time-start_time) * (start_alpha + end_alpha) / 2.0f);
-			m_smoothed_camera = m_camera;
-		}
+// Views of uniform resolution are returned as a single (N, H, W, 4) array. Otherwise,
+// a list of (H, W, 4) arrays is returned, all of which share the memory of `result`.
+py::object batch_render_result(const BatchRenderPlan& plan, const py::array_t<float>& result) {
+	float* data = (float*)result.data();
 
-		if (m_autofocus) {
-			autofocus();
-		}
+	if (plan.uniform_resolution) {
+		Vector2i res = plan.views.empty() ? Vector2i::Zero() : plan.views.front().resolution;
+		return py::array_t<float>({(py::ssize_t)plan.views.size(), (py::ssize_t)res.y(), (py::ssize_t)res.x(), (py::ssize_t)4}, data, result);
+	}
 
-		render_frame(sample_start_cam_matrix, sample_end_cam_matrix, m_windowless_render_surface, !linear);
+	py::list views;
+	for (const auto& view : plan.views) {
+		views.append(py::array_t<float>({(py::ssize_t)view.resolution.y(), (py::ssize_t)view.resolution.x(), (py::ssize_t)4}, data + view.offset, result));
 	}
 
-	// For cam smoothing when rendering the next frame.
-	m_smoothed_camera = end_cam_matrix;
+	return std::move(views);
+}
 
-	py::array_t<float> result({height, width, 4});
-	py::buffer_info buf = result.request();
+py::object Testbed::render_batch_to_cpu(py::array_t<float, py::array::c_style | py::array::forcecast> camera_matrices, std::vector<Vector2i> resolutions, std::vector<uint32_t> spps, bool linear, py::object out) {
+	BatchRenderPlan plan = plan_batch_render(camera_matrices, resolutions, spps);
+	py::array_t<float> result = batch_render_output(plan, out);
+	float* dst = result.mutable_data();
+
+	{
+		py::gil_scoped_release release;
+
+		CudaRenderBuffer* slots[BATCH_RENDER_N_SLOTS] = {&m_windowless_render_surface, &m_batch_render_surface};
+
+		cudaStream_t read_back_stream;
+		CUDA_CHECK_THROW(cudaStreamCreate(&read_back_stream));
+		ScopeGuard stream_guard{[&]() { cudaStreamDestroy(read_back_stream); }};
+
+		// A single worker suffices: it only waits for the device-to-host copy of the previous view.
+		ThreadPool pool{1};
+
+		render_batch(plan, dst, pool,
+			[&](const BatchRenderView& view, uint32_t slot) {
+				CudaRenderBuffer& surface = *slots[slot];
+				surface.resize(view.resolution);
+				surface.reset_accumulation();
+				for (uint32_t i = 0; i < view.spp; ++i) {
+					render_frame(view.camera_matrix, view.camera_matrix, surface, !linear);
+				}
+			},
+			[&](const BatchRenderView& view, uint32_t slot, float* view_dst) {
+				size_t pitch = view.resolution.x() * sizeof(float) * 4;
+				CUDA_CHECK_THROW(cudaMemcpy2DFromArrayAsync(view_dst, pitch, slots[slot]->surface_provider().array(), 0, 0, pitch, view.resolution.y(), cudaMemcpyDeviceToHost, read_back_stream));
+				CUDA_CHECK_THROW(cudaStreamSynchronize(read_back_stream));
+			}
+		);
+	}
 
-	CUDA_CHECK_THROW(cudaMemcpy2DFromArray(buf.ptr, width * sizeof(float) * 4, m_windowless_render_surface.surface_provider().array(), 0, 0, width * sizeof(float) * 4, height, cudaMemcpyDeviceToHost));
-	return result;
+	return batch_render_result(plan, result);
 }
 
-py::array_t<float> Testbed::screenshot(bool linear) const {
+py::array_t<float> Testbed::screenshot(bool linear, py::object out) const {
 #ifdef NGP_GUI
-	std::vector<float> tmp(m_window_res.prod() * 4);
-	glReadPixels(0, 0, m_window_res.x(), m_window_res.y(), GL_RGBA, GL_FLOAT, tmp.data());
-
-	py::array_t<float> result({m_window_res.y(), m_window_res.x(), 4});
-	py::buffer_info buf = result.request();
-	float* data = (float*)buf.ptr;
-
-	// Linear, alpha premultiplied, Y flipped
-	ThreadPool pool;
-	pool.parallelFor<size_t>(0, m_window_res.y(), [&](size_t y) {
-		size_t base = y * m_window_res.x();
-		size_t base_reverse = (m_window_res.y() - y - 1) * m_window_res.x();
-		for (uint32_t x = 0; x < m_window_res.x(); ++x) {
-			size_t px = base + x;
-			size_t px_reverse = base_reverse + x;
-			data[px_reverse*4+0] = linear ? srgb_to_linear(tmp[px*4+0]) : tmp[px*4+0];
-			data[px_reverse*4+1] = linear ? srgb_to_linear(tmp[px*4+1]) : tmp[px*4+1];
-			data[px_reverse*4+2] = linear ? srgb_to_linear(tmp[px*4+2]) : tmp[px*4+2];
-			data[px_reverse*4+3] = tmp[px*4+3];
-		}
-	});
+	py::array_t<float> result = out.is_none() ?
+		py::array_t<float>({m_window_res.y(), m_window_res.x(), 4}) :
+		writeable_out_array(out, (size_t)m_window_res.prod() * 4);
+
+	float* data = result.mutable_data();
+
+	{
+		py::gil_scoped_release release;
+
+		glReadPixels(0, 0, m_window_res.x(), m_window_res.y(), GL_RGBA, GL_FLOAT, data);
+
+		// Linear, alpha premultiplied, Y flipped. Rows are swapped in place such
+		// that no temporary copy of the screenshot is needed.
+		auto convert = [linear](float* px) {
+			if (linear) {
+				px[0] = srgb_to_linear(px[0]);
+				px[1] = srgb_to_linear(px[1]);
+				px[2] = srgb_to_linear(px[2]);
+			}
+		};
+
+		ThreadPool pool;
+		pool.parallelFor<size_t>(0, (m_window_res.y() + 1) / 2, [&](size_t y) {
+			float* row = data + y * m_window_res.x() * 4;
+			float* row_reverse = data + (m_window_res.y() - y - 1) * m_window_res.x() * 4;
+			for (uint32_t x = 0; x < m_window_res.x(); ++x) {
+				float* px = row + x * 4;
+				float* px_reverse = row_reverse + x * 4;
+				if (px != px_reverse) {
+					std::swap_ranges(px, px + 4, px_reverse);
+					convert(px_reverse);
+				}
+				convert(px);
+			}
+		});
+	}
 
 	return result;
 #else
@@ -178,6 +287,15 @@ py::array_t<float> Testbed::screenshot(bool linear) const {
 #endif
 }
 
+// Sessions wait for their training and hook threads upon destruction. The latter may
+// need the GIL to finish running a python hook, so it has to be released first.
+struct TrainingSessionDeleter {
+	void operator()(TrainingSession* session) const {
+		py::gil_scoped_release release;
+		delete session;
+	}
+};
+
 PYBIND11_MODULE(pyngp, m) {
 	m.doc() = "Instant neural graphics primitives";
 
@@ -246,6 +364,12 @@ PYBIND11_MODULE(pyngp, m) {
 		.value("Reinhard", ETonemapCurve::Reinhard)
 		.export_values();
 
+	py::enum_<ESceneTier>(m, "SceneTier")
+		.value("Disk", ESceneTier::Disk)
+		.value("Host", ESceneTier::Host)
+		.value("Resident", ESceneTier::Resident)
+		.export_values();
+
 	py::class_<BoundingBox>(m, "BoundingBox")
 		.def(py::init<>())
 		.def(py::init<const Vector3f&, const Vector3f&>())
@@ -272,7 +396,7 @@ PYBIND11_MODULE(pyngp, m) {
 		.def(py::init<ETestbedMode>())
 		.def(py::init<ETestbedMode, const std::string&, const std::string&>())
 		.def(py::init<ETestbedMode, const std::string&, const json&>())
-		.def("load_training_data", &Testbed::load_training_data, "Load training data from a given path.")
+		.def("load_training_data", &Testbed::load_training_data, py::call_guard<py::gil_scoped_release>(), "Load training data from a given path.")
 		.def("clear_training_data", &Testbed::clear_training_data, "Clears training data to free up GPU memory.")
 		// General control
 		.def("init_window", &Testbed::init_window, "Init a GLFW window that shows real-time progress and a GUI.",
@@ -281,8 +405,10 @@ PYBIND11_MODULE(pyngp, m) {
 			py::arg("hidden") = false
 		)
 		.def("want_repl", &Testbed::want_repl, "returns true if the user clicked the 'I want a repl' button")
-		.def("frame", &Testbed::frame, "Process a single frame. Renders if a window was previously created.")
-		.def("render", &Testbed::render_to_cpu, "Renders an image at the requested resolution. Does not require a window.",
+		.def("frame", &Testbed::frame, py::call_guard<py::gil_scoped_release>(), "Process a single frame. Renders if a window was previously created.")
+		.def("render", &Testbed::render_to_cpu,
+			"Renders an image at the requested resolution. Does not require a window. "
+			"The image is written to `out` if it is a C-contiguous float32 array of matching size.",
 			py::arg("width") = 1920,
 			py::arg("height") = 1080,
 			py::arg("spp") = 1,
@@ -290,17 +416,34 @@ PYBIND11_MODULE(pyngp, m) {
 			py::arg("start_t") = -1.f,
 			py::arg("end_t") = -1.f,
 			py::arg("fps") = 30.f,
-			py::arg("shutter_fraction") = 1.0f
+			py::arg("shutter_fraction") = 1.0f,
+			py::arg("out") = py::none()
+		)
+		.def("render_batch", &Testbed::render_batch_to_cpu,
+			"Renders one image per camera matrix (array of shape (N, 3, 4)) without requiring a window. "
+			"`resolutions` and `spp` hold either a single value or one value per view. "
+			"Returns an (N, H, W, 4) array if all views share a resolution and a list of (H, W, 4) arrays otherwise; "
+			"in both cases, the pixels are written to `out` if it is a C-contiguous float32 array of matching size.",
+			py::arg("camera_matrices"),
+			py::arg("resolutions") = std::vector<Vector2i>{Vector2i{1920, 1080}},
+			py::arg("spp") = std::vector<uint32_t>{1},
+			py::arg("linear") = true,
+			py::arg("out") = py::none()
+		)
+		.def("screenshot", &Testbed::screenshot,
+			"Takes a screenshot of the current window contents. "
+			"The screenshot is written to `out` if it is a C-contiguous float32 array of matching size.",
+			py::arg("linear")=true,
+			py::arg("out")=py::none()
 		)
-		.def("screenshot", &Testbed::screenshot, "Takes a screenshot of the current window contents.", py::arg("linear")=true)
 		.def("destroy_window", &Testbed::destroy_window, "Destroy the window again.")
-		.def("train", &Testbed::train, "Perform a specified number of training steps.")
+		.def("train", &Testbed::train, py::call_guard<py::gil_scoped_release>(), "Perform a specified number of training steps.")
 		.def("reset", &Testbed::reset_network, "Reset training.")
 		.def("reset_accumulation", &Testbed::reset_accumulation, "Reset rendering accumulation.")
 		.def("reload_network_from_file", &Testbed::reload_network_from_file, py::arg("path")="", "Reload the network from a config file.")
 		.def("reload_network_from_json", &Testbed::reload_network_from_json, "Reload the network from a json object.")
 		.def("override_sdf_training_data", &Testbed::override_sdf_training_data, "Override the training data for learning a signed distance function")
-		.def("calculate_iou", &Testbed::calculate_iou, "Calculate the intersection over union error value",
+		.def("calculate_iou", &Testbed::calculate_iou, py::call_guard<py::gil_scoped_release>(), "Calculate the intersection over union error value",
 			py::arg("n_samples") = 128*1024*1024,
 			py::arg("scale_existing_results_factor") = 0.0f,
 			py::arg("blocking") = true,
@@ -308,10 +451,19 @@ PYBIND11_MODULE(pyngp, m) {
 		)
 		.def("n_params", &Testbed::n_params, "Number of trainable parameters")
 		.def("n_encoding_params", &Testbed::n_encoding_params, "Number of trainable parameters in the encoding")
-		.def("save_snapshot", &Testbed::save_snapshot, py::arg("path"), py::arg("include_optimizer_state")=false, "Save a snapshot of the currently trained model")
-		.def("load_snapshot", &Testbed::load_snapshot, py::arg("path"), "Load a previously saved snapshot")
+		.def("save_snapshot", &Testbed::save_snapshot, py::call_guard<py::gil_scoped_release>(), py::arg("path"), py::arg("include_optimizer_state")=false, "Save a snapshot of the currently trained model")
+		.def("load_snapshot", py::overload_cast<const std::string&>(&Testbed::load_snapshot), py::call_guard<py::gil_scoped_release>(), py::arg("path"), "Load a previously saved snapshot")
+		.def("load_cached_snapshot", [](Testbed& testbed, SceneCache<CpuNerfRenderer>& cache, const std::string& name) {
+				testbed.load_snapshot(*cache.snapshot(name));
+			},
+			py::call_guard<py::gil_scoped_release>(),
+			py::arg("cache"),
+			py::arg("name"),
+			"Load a snapshot from the host tier of a scene cache, which avoids reading and parsing the file if it is cached."
+		)
 		.def("load_camera_path", &Testbed::load_camera_path, "Load a camera path", py::arg("path"))
-		.def("compute_and_save_marching_cubes_mesh", &Testbed::compute_and_save_marching_cubes_mesh,
+		.def_property_readonly("camera_path", [](Testbed& testbed) -> CameraPath& { return testbed.m_camera_path; }, py::return_value_policy::reference_internal)
+		.def("compute_and_save_marching_cubes_mesh", &Testbed::compute_and_save_marching_cubes_mesh, py::call_guard<py::gil_scoped_release>(),
 			py::arg("filename"),
 			py::arg("resolution") = Eigen::Vector3i::Constant(256),
 			py::arg("aabb") = BoundingBox{},
@@ -383,6 +535,270 @@ PYBIND11_MODULE(pyngp, m) {
 		.def_readwrite("tonemap_curve", &Testbed::m_tonemap_curve)
 		;
 
+	py::class_<CameraPath>(m, "CameraPath")
+		.def_readwrite("playtime", &CameraPath::m_playtime)
+		.def_readwrite("constant_speed", &CameraPath::m_constant_speed)
+		.def_readwrite("rotation_weight", &CameraPath::m_rotation_weight)
+		.def_property_readonly("n_keyframes", [](const CameraPath& path) { return path.m_keyframes.size(); })
+		.def("camera_matrices", [](const CameraPath& path, std::vector<float> times) {
+				std::vector<CameraKeyframe> keyframes;
+				{
+					py::gil_scoped_release release;
+					keyframes = path.eval_batch(times);
+				}
+
+				py::array_t<float> result({(py::ssize_t)keyframes.size(), (py::ssize_t)3, (py::ssize_t)4});
+				float* data = result.mutable_data();
+				for (size_t i = 0; i < keyframes.size(); ++i) {
+					Matrix<float, 3, 4> m = keyframes[i].m();
+					for (int row = 0; row < 3; ++row) {
+						for (int col = 0; col < 4; ++col) {
+							data[i*12 + row*4 + col] = m(row, col);
+						}
+					}
+				}
+
+				return result;
+			},
+			py::arg("times"),
+			"Evaluates the camera path at all `times` in [0, 1] and returns an (N, 3, 4) array of camera matrices, e.g. for Testbed.render_batch."
+		)
+		;
+
+	py::class_<TrainingSession, std::unique_ptr<TrainingSession, TrainingSessionDeleter>>(m, "TrainingSession")
+		.def(py::init<Testbed&, uint32_t, uint32_t>(),
+			py::keep_alive<1, 2>(),
+			py::arg("testbed"),
+			py::arg("batch_size") = 1<<18,
+			py::arg("steps_per_call") = 16,
+			"Trains `testbed` on a background thread, `steps_per_call` steps at a time. "
+			"Do not call into the testbed from other threads while training runs, unless the session is paused."
+		)
+		.def("start", &TrainingSession::start, py::arg("n_steps") = 0, "Start training for `n_steps` steps (0: until stopped).")
+		.def("stop", &TrainingSession::stop, py::call_guard<py::gil_scoped_release>(), "Stop training after the current batch of steps.")
+		.def("wait", &TrainingSession::wait, py::call_guard<py::gil_scoped_release>(), "Wait until training finished. Raises errors that occurred during training.")
+		.def("poll", &TrainingSession::poll, "Returns whether training is still running. Raises errors that occurred during training.")
+		.def("pause", &TrainingSession::pause, py::call_guard<py::gil_scoped_release>(), "Pause training, such that the testbed can be used for rendering, mesh export, etc.")
+		.def("resume", &TrainingSession::resume, "Resume training after a matching call to pause().")
+		.def("set_snapshot", &TrainingSession::set_snapshot,
+			py::arg("path"),
+			py::arg("interval"),
+			"Save a snapshot every `interval` steps from the training thread. `{step}` in `path` is replaced by the training step."
+		)
+		.def("set_hook", &TrainingSession::set_hook,
+			py::arg("hook"),
+			py::arg("interval"),
+			"Call `hook(step, loss)` every `interval` steps on a dedicated thread. Training does not wait for the hook; "
+			"invocations are skipped while the previous one is still running."
+		)
+		.def_property_readonly("running", &TrainingSession::running)
+		.def_property_readonly("training_step", &TrainingSession::training_step)
+		.def_property_readonly("loss", &TrainingSession::loss)
+		.def_property_readonly("n_skipped_hooks", &TrainingSession::n_skipped_hooks)
+		.def_property_readonly("steps_per_second", &TrainingSession::steps_per_second)
+		;
+
+	py::class_<CpuNerfRenderSettings>(m, "CpuNerfRenderSettings")
+		.def(py::init<>())
+		.def_readwrite("resolution", &CpuNerfRenderSettings::resolution)
+		.def_readwrite("focal_length", &CpuNerfRenderSettings::focal_length)
+		.def_readwrite("camera_matrix", &CpuNerfRenderSettings::camera_matrix0)
+		.def_readwrite("screen_center", &CpuNerfRenderSettings::screen_center)
+		.def_readwrite("spp", &CpuNerfRenderSettings::spp)
+		.def_readwrite("orthographic", &CpuNerfRenderSettings::orthographic)
+		.def_readwrite("snap_to_pixel_centers", &CpuNerfRenderSettings::snap_to_pixel_centers)
+		.def_readwrite("render_mode", &CpuNerfRenderSettings::render_mode)
+		.def_readwrite("rgb_activation", &CpuNerfRenderSettings::rgb_activation)
+		.def_readwrite("density_activation", &CpuNerfRenderSettings::density_activation)
+		.def_readwrite("min_alpha", &CpuNerfRenderSettings::min_alpha)
+		.def_readwrite("cone_angle_constant", &CpuNerfRenderSettings::cone_angle_constant)
+		.def_readwrite("skip_empty_space", &CpuNerfRenderSettings::skip_empty_space)
+		.def_readwrite("exposure", &CpuNerfRenderSettings::exposure)
+		.def_readwrite("background_color", &CpuNerfRenderSettings::background_color)
+		.def_readwrite("color_space", &CpuNerfRenderSettings::color_space)
+		.def_readwrite("tonemap_curve", &CpuNerfRenderSettings::tonemap_curve)
+		.def_readwrite("tile_size", &CpuNerfRenderSettings::tile_size)
+		;
+
+	py::class_<CpuNerfRenderer, std::shared_ptr<CpuNerfRenderer>>(m, "CpuNerfRenderer")
+		.def(py::init<>())
+		.def("load_snapshot", &CpuNerfRenderer::load_snapshot, py::arg("path"), "Load a NeRF snapshot for rendering on the CPU")
+		.def("render_batch", [](const CpuNerfRenderer& renderer, const CpuNerfRenderSettings& settings, py::array_t<float, py::array::c_style | py::array::forcecast> camera_matrices, std::vector<Vector2i> resolutions, std::vector<uint32_t> spps, bool linear, py::object out) {
+				BatchRenderPlan plan = plan_batch_render(camera_matrices, resolutions, spps);
+				py::array_t<float> result = batch_render_output(plan, out);
+				float* dst = result.mutable_data();
+
+				{
+					py::gil_scoped_release release;
+
+					CpuNerfRenderSettings batch_settings = settings;
+					batch_settings.to_srgb = !linear;
+
+					ThreadPool pool;
+					renderer.render_batch(batch_settings, plan, pool, dst);
+				}
+
+				return batch_render_result(plan, result);
+			},
+			"Same as Testbed.render_batch, but renders on the CPU. The focal length of `settings` applies to `settings.resolution` "
+			"and is scaled with the width of each view.",
+			py::arg("settings"),
+			py::arg("camera_matrices"),
+			py::arg("resolutions"),
+			py::arg("spp") = std::vector<uint32_t>{1},
+			py::arg("linear") = true,
+			py::arg("out") = py::none()
+		)
+		;
+
+	py::class_<OccupancyGridCascadeStats>(m, "OccupancyGridCascadeStats")
+		.def_readonly("n_occupied", &OccupancyGridCascadeStats::n_occupied)
+		.def_readonly("n_occupied_pooled", &OccupancyGridCascadeStats::n_occupied_pooled)
+		.def_readonly("occupied_fraction", &OccupancyGridCascadeStats::occupied_fraction)
+		.def_readonly("occupied_fraction_pooled", &OccupancyGridCascadeStats::occupied_fraction_pooled)
+		.def_readonly("mean_density", &OccupancyGridCascadeStats::mean_density)
+		.def_property_readonly("occupied_aabb", [](const OccupancyGridCascadeStats& stats) {
+			return stats.occupied_aabb.isEmpty() ? BoundingBox{} : BoundingBox{stats.occupied_aabb.min(), stats.occupied_aabb.max()};
+		})
+		;
+
+	py::class_<OccupancyGrid>(m, "OccupancyGrid")
+		.def(py::init<>())
+		.def("load_snapshot", [](OccupancyGrid& grid, const std::string& path) {
+			ThreadPool pool;
+			grid.load_snapshot(path, &pool);
+		}, py::call_guard<py::gil_scoped_release>(), py::arg("path"), "Load the density grid of a NeRF snapshot.")
+		.def("save_snapshot", &OccupancyGrid::save_snapshot, py::call_guard<py::gil_scoped_release>(), py::arg("path"),
+			"Write the density grid into the existing snapshot at `path`, such that loading it reproduces this grid's occupancy."
+		)
+		.def("stats", [](const OccupancyGrid& grid) {
+			ThreadPool pool;
+			return grid.stats(&pool);
+		}, py::call_guard<py::gil_scoped_release>(), "Occupancy statistics of every cascade.")
+		.def("dilate", [](OccupancyGrid& grid, uint32_t radius) {
+			ThreadPool pool;
+			grid.dilate(radius, &pool);
+		}, py::call_guard<py::gil_scoped_release>(), py::arg("radius") = 1, "Mark all cells within `radius` cells of an occupied cell as occupied.")
+		.def("erode", [](OccupancyGrid& grid, uint32_t radius) {
+			ThreadPool pool;
+			grid.erode(radius, &pool);
+		}, py::call_guard<py::gil_scoped_release>(), py::arg("radius") = 1, "Free all cells within `radius` cells of a free cell.")
+		.def("crop", [](OccupancyGrid& grid, const BoundingBox& aabb) {
+			ThreadPool pool;
+			grid.crop(AlignedBox3f{aabb.min, aabb.max}, &pool);
+		}, py::call_guard<py::gil_scoped_release>(), py::arg("aabb"), "Free all cells whose center lies outside of `aabb`.")
+		.def("occupied", &OccupancyGrid::occupied, py::arg("cascade"), py::arg("x"), py::arg("y"), py::arg("z"))
+		.def("set_occupied", &OccupancyGrid::set_occupied, py::arg("cascade"), py::arg("x"), py::arg("y"), py::arg("z"), py::arg("value"))
+		.def("update_mips", [](OccupancyGrid& grid) { grid.update_mips(); }, "Recompute the max-pooled cascades after editing cells with `set_occupied`.")
+		.def_property_readonly("bitfield", [](const OccupancyGrid& grid) {
+			const auto& bitfield = grid.bitfield();
+			return py::array_t<uint8_t>(bitfield.size(), bitfield.data());
+		})
+		;
+
+	py::class_<SparseOccupancyGrid>(m, "SparseOccupancyGrid")
+		.def(py::init([](const BoundingBox& domain, uint32_t resolution) {
+			return SparseOccupancyGrid{AlignedBox3f{domain.min, domain.max}, resolution};
+		}), py::arg("domain"), py::arg("resolution"))
+		.def("build", [](SparseOccupancyGrid& grid, const OccupancyGrid& coarse) {
+			ThreadPool pool;
+			grid.build(coarse, {}, &pool);
+		}, py::call_guard<py::gil_scoped_release>(), py::arg("coarse"), "Resample the occupancy of the dense cascades.")
+		.def("build_from_nerf", [](SparseOccupancyGrid& grid, const OccupancyGrid& coarse, const CpuNerfRenderer& renderer, float min_optical_thickness, ENerfActivation density_activation) {
+			ThreadPool pool;
+			grid.build(coarse, renderer.network(), renderer.aabb(), min_optical_thickness, density_activation, &pool);
+		},
+			py::call_guard<py::gil_scoped_release>(),
+			"Refine the occupancy of the dense cascades by the density of the network at the center of every cell.",
+			py::arg("coarse"),
+			py::arg("renderer"),
+			py::arg("min_optical_thickness") = OccupancyGrid::MIN_OPTICAL_THICKNESS,
+			py::arg("density_activation") = ENerfActivation::Exponential
+		)
+		.def("occupied_at", [](const SparseOccupancyGrid& grid, const Vector3f& pos) { return grid.view().occupied_at(pos); }, py::arg("pos"))
+		.def_property_readonly("resolution", &SparseOccupancyGrid::resolution)
+		.def_property_readonly("n_bricks", &SparseOccupancyGrid::n_bricks)
+		.def_property_readonly("n_full_bricks", &SparseOccupancyGrid::n_full_bricks)
+		.def_property_readonly("n_occupied_cells", &SparseOccupancyGrid::n_occupied_cells)
+		.def_property_readonly("memory_bytes", &SparseOccupancyGrid::memory_bytes)
+		;
+
+	py::class_<OccupancyTraversalBenchmark>(m, "OccupancyTraversalBenchmark")
+		.def_readonly("n_rays", &OccupancyTraversalBenchmark::n_rays)
+		.def_readonly("steps_per_ray_dense", &OccupancyTraversalBenchmark::steps_per_ray_dense)
+		.def_readonly("steps_per_ray_sparse", &OccupancyTraversalBenchmark::steps_per_ray_sparse)
+		.def_readonly("occupied_per_ray_dense", &OccupancyTraversalBenchmark::occupied_per_ray_dense)
+		.def_readonly("occupied_per_ray_sparse", &OccupancyTraversalBenchmark::occupied_per_ray_sparse)
+		.def_readonly("ns_per_ray_dense", &OccupancyTraversalBenchmark::ns_per_ray_dense)
+		.def_readonly("ns_per_ray_sparse", &OccupancyTraversalBenchmark::ns_per_ray_sparse)
+		.def_readonly("memory_bytes_dense_bitfield", &OccupancyTraversalBenchmark::memory_bytes_dense_bitfield)
+		.def_readonly("memory_bytes_dense_density_grid", &OccupancyTraversalBenchmark::memory_bytes_dense_density_grid)
+		.def_readonly("memory_bytes_sparse", &OccupancyTraversalBenchmark::memory_bytes_sparse)
+		;
+
+	m.def("benchmark_occupancy_traversal", &benchmark_occupancy_traversal, py::call_guard<py::gil_scoped_release>(),
+		"Compare DDA step counts, traversal time, and memory of the dense cascades and a sparse occupancy grid.",
+		py::arg("dense"),
+		py::arg("sparse"),
+		py::arg("n_rays") = 1 << 16,
+		py::arg("seed") = 1337
+	);
+
+	py::class_<EmptySpaceSkippingBenchmark>(m, "EmptySpaceSkippingBenchmark")
+		.def_readonly("n_rays", &EmptySpaceSkippingBenchmark::n_rays)
+		.def_readonly("steps_per_ray", &EmptySpaceSkippingBenchmark::steps_per_ray)
+		.def_readonly("steps_per_ray_skipping", &EmptySpaceSkippingBenchmark::steps_per_ray_skipping)
+		.def_readonly("samples_per_ray", &EmptySpaceSkippingBenchmark::samples_per_ray)
+		.def_readonly("n_rays_with_different_samples", &EmptySpaceSkippingBenchmark::n_rays_with_different_samples)
+		.def_readonly("ns_per_ray", &EmptySpaceSkippingBenchmark::ns_per_ray)
+		.def_readonly("ns_per_ray_skipping", &EmptySpaceSkippingBenchmark::ns_per_ray_skipping)
+		.def_readonly("build_milliseconds", &EmptySpaceSkippingBenchmark::build_milliseconds)
+		.def_readonly("memory_bytes", &EmptySpaceSkippingBenchmark::memory_bytes)
+		;
+
+	m.def("benchmark_empty_space_skipping",
+		[](const OccupancyGrid& grid, float cone_angle, uint32_t n_rays, uint32_t seed) {
+			ThreadPool pool;
+			return benchmark_empty_space_skipping(grid, cone_angle, n_rays, seed, &pool);
+		},
+		py::call_guard<py::gil_scoped_release>(),
+		"Compare occupancy lookups per ray of NeRF ray marching with and without skipping free blocks of the occupancy distance field.",
+		py::arg("grid"),
+		py::arg("cone_angle") = 0.0f,
+		py::arg("n_rays") = 1 << 16,
+		py::arg("seed") = 1337
+	);
+
+	py::class_<SceneCacheSettings>(m, "SceneCacheSettings")
+		.def(py::init<>())
+		.def_readwrite("resident_budget", &SceneCacheSettings::resident_budget)
+		.def_readwrite("host_budget", &SceneCacheSettings::host_budget)
+		.def_readwrite("n_prefetch", &SceneCacheSettings::n_prefetch)
+		.def_readwrite("n_threads", &SceneCacheSettings::n_threads)
+		;
+
+	using CpuSceneCache = SceneCache<CpuNerfRenderer>;
+	py::class_<CpuSceneCache>(m, "SceneCache")
+		.def(py::init([](const SceneCacheSettings& settings) {
+				return std::make_unique<CpuSceneCache>(settings,
+					[](const nlohmann::json& config) { return std::make_shared<CpuNerfRenderer>(config); },
+					[](const CpuNerfRenderer& renderer) { return renderer.memory_bytes(); }
+				);
+			}),
+			py::arg("settings") = SceneCacheSettings{}
+		)
+		.def("add", &CpuSceneCache::add, py::arg("name"), py::arg("path"), "Register the snapshot at `path` under `name`.")
+		.def("get", &CpuSceneCache::get, py::call_guard<py::gil_scoped_release>(), py::arg("name"),
+			"Return the resident CpuNerfRenderer of a scene, loading it if necessary. Evicts the least recently used scenes "
+			"to stay within the budgets and prefetches the scenes that most frequently followed this one."
+		)
+		.def("prefetch", &CpuSceneCache::prefetch, py::arg("name"), "Load a snapshot into the host tier in the background if it fits the budget.")
+		.def("wait", &CpuSceneCache::wait, py::call_guard<py::gil_scoped_release>(), "Wait until all prefetches finished.")
+		.def("tier", &CpuSceneCache::tier, py::arg("name"))
+		.def_property_readonly("resident_bytes", &CpuSceneCache::resident_bytes)
+		.def_property_readonly("host_bytes", &CpuSceneCache::host_bytes)
+		;
+
 	py::class_<Testbed::Nerf> nerf(testbed, "Nerf");
 	nerf
 		.def_readonly("training", &Testbed::Nerf::training)
@@ -392,6 +808,7 @@ PYBIND11_MODULE(pyngp, m) {
 		.def_readwrite("render_with_camera_distortion", &Testbed::Nerf::render_with_camera_distortion)
 		.def_readwrite("rendering_min_alpha", &Testbed::Nerf::rendering_min_alpha)
 		.def_readwrite("cone_angle_constant", &Testbed::Nerf::cone_angle_constant)
+		.def_readwrite("skip_empty_space", &Testbed::Nerf::skip_empty_space)
 		.def_readwrite("visualize_cameras", &Testbed::Nerf::visualize_cameras)
 		;
 
@@ -433,8 +850,10 @@ PYBIND11_MODULE(pyngp, m) {
 		.def_readwrite("optimize_extrinsics", &Testbed::Nerf::Training::optimize_extrinsics)
 		.def_readwrite("optimize_exposure", &Testbed::Nerf::Training::optimize_exposure)
 		.def_readwrite("optimize_distortion", &Testbed::Nerf::Training::optimize_distortion)
+		.def_readwrite("use_camera_undistortion_map", &Testbed::Nerf::Training::use_camera_undistortion_map)
 		.def_readwrite("optimize_focal_length", &Testbed::Nerf::Training::optimize_focal_length)
 		.def_readwrite("n_steps_between_cam_updates", &Testbed::Nerf::Training::n_steps_between_cam_updates)
+		.def_readwrite("deferred_stats_lag", &Testbed::Nerf::Training::deferred_stats_lag)
 		.def_readwrite("sample_focal_plane_proportional_to_error", &Testbed::Nerf::Training::sample_focal_plane_proportional_to_error)
 		.def_readwrite("sample_image_proportional_to_error", &Testbed::Nerf::Training::sample_image_proportional_to_error)
 		.def_readwrite("include_sharpness_in_error", &Testbed::Nerf::Training::include_sharpness_in_error)
@@ -0,0 +1,294 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+/** @file   render_main.cu
+ *  @author Thomas Müller, NVIDIA
+ *  @brief  Headless renderer that turns a NeRF snapshot and a camera path into a sequence of frames.
+ */
+
+#include <neural-graphics-primitives/camera_path.h>
+#include <neural-graphics-primitives/common_device.cuh>
+#include <neural-graphics-primitives/nerf_renderer_cpu.h>
+#include <neural-graphics-primitives/testbed.h>
+#include <neural-graphics-primitives/thread_pool.h>
+#include <neural-graphics-primitives/video_render.h>
+
+#include <tiny-cuda-nn/common.h>
+
+#include <args/args.hxx>
+
+#include <filesystem/path.h>
+
+using namespace args;
+using namespace Eigen;
+using namespace ngp;
+using namespace std;
+using namespace tcnn;
+namespace fs = filesystem;
+
+VideoRenderStats render_video_cpu(const VideoRenderSettings& settings, const string& snapshot_path, const string& camera_path_path, bool constant_speed, ThreadPool& render_pool, ThreadPool& encode_pool) {
+	CpuNerfRenderer renderer;
+	renderer.load_snapshot(snapshot_path);
+
+	CameraPath camera_path;
+	camera_path.load(camera_path_path, Matrix<float, 3, 4>::Identity());
+	camera_path.m_constant_speed = constant_speed;
+	if (camera_path.m_keyframes.empty()) {
+		throw runtime_error{"Camera path has no keyframes."};
+	}
+
+	CpuNerfRenderSettings render_settings;
+	render_settings.resolution = settings.resolution;
+	render_settings.spp = 1;
+	render_settings.to_srgb = false;
+
+	vector<Array4f> slots[VIDEO_RENDER_N_SLOTS];
+	vector<Array4f> sample;
+
+	return render_video(settings, encode_pool,
+		[&](const VideoFrame& frame, uint32_t slot) {
+			// Sample i moves the camera from keyframes[i] to keyframes[i+1]
+			vector<float> times(settings.spp + 1);
+			for (uint32_t i = 0; i <= settings.spp; ++i) {
+				times[i] = frame.sample_time(i, settings.spp, settings.shutter_fraction);
+			}
+			vector<CameraKeyframe> keyframes = camera_path.eval_batch(times);
+
+			size_t n_pixels = (size_t)settings.resolution.prod();
+			slots[slot].assign(n_pixels, Array4f::Zero());
+			sample.resize(n_pixels);
+
+			for (uint32_t i = 0; i < settings.spp; ++i) {
+				const CameraKeyframe& k = keyframes[i+1];
+				render_settings.camera_matrix0 = keyframes[i].m();
+				render_settings.camera_matrix1 = k.m();
+				// Same as Testbed::set_camera_from_keyframe followed by Testbed::calc_focal_length with fov axis 1
+				render_settings.focal_length = Vector2f::Constant(fov_to_focal_length(1, k.fov) * settings.resolution.y() * k.ortho_scale);
+				render_settings.spp_offset = i;
+
+				renderer.render(render_settings, render_pool, sample.data());
+
+				float weight = 1.0f / (i + 1);
+				for (size_t p = 0; p < n_pixels; ++p) {
+					slots[slot][p] += (sample[p] - slots[slot][p]) * weight;
+				}
+			}
+		},
+		[&](const VideoFrame& frame, uint32_t slot, float* dst) {
+			copy_n((const float*)slots[slot].data(), slots[slot].size() * 4, dst);
+		}
+	);
+}
+
+VideoRenderStats render_video_cuda(const VideoRenderSettings& settings, const string& snapshot_path, const string& camera_path_path, bool constant_speed, ThreadPool& encode_pool) {
+	Testbed testbed{ETestbedMode::Nerf};
+	testbed.load_snapshot(snapshot_path);
+	testbed.load_camera_path(camera_path_path);
+	testbed.m_camera_path.m_constant_speed = constant_speed;
+	if (testbed.m_camera_path.m_keyframes.empty()) {
+		throw runtime_error{"Camera path has no keyframes."};
+	}
+
+	// Start at rest, such that the first frame is not blurred by a move from the default camera.
+	testbed.set_camera_from_time(0.0f);
+	testbed.m_smoothed_camera = testbed.m_camera;
+
+	CudaRenderBuffer* slots[VIDEO_RENDER_N_SLOTS] = {&testbed.m_windowless_render_surface, &testbed.m_batch_render_surface};
+
+	cudaStream_t read_back_stream;
+	CUDA_CHECK_THROW(cudaStreamCreate(&read_back_stream));
+	ScopeGuard stream_guard{[&]() { cudaStreamDestroy(read_back_stream); }};
+
+	return render_video(settings, encode_pool,
+		[&](const VideoFrame& frame, uint32_t slot) {
+			CudaRenderBuffer& surface = *slots[slot];
+			surface.resize(settings.resolution);
+			surface.reset_accumulation();
+			testbed.render_camera_path_frame(surface, settings.spp, false, frame.start_time, frame.end_time, settings.fps, settings.shutter_fraction);
+		},
+		[&](const VideoFrame& frame, uint32_t slot, float* dst) {
+			size_t pitch = settings.resolution.x() * sizeof(float) * 4;
+			CUDA_CHECK_THROW(cudaMemcpy2DFromArrayAsync(dst, pitch, slots[slot]->surface_provider().array(), 0, 0, pitch, settings.resolution.y(), cudaMemcpyDeviceToHost, read_back_stream));
+			CUDA_CHECK_THROW(cudaStreamSynchronize(read_back_stream));
+		}
+	);
+}
+
+int main(int argc, char** argv) {
+	ArgumentParser parser{
+		"neural graphics primitives headless video renderer\n"
+		"version " NGP_VERSION,
+		"",
+	};
+
+	HelpFlag help_flag{
+		parser,
+		"HELP",
+		"Display this help menu.",
+		{'h', "help"},
+	};
+
+	ValueFlag<string> snapshot_flag{
+		parser,
+		"SNAPSHOT",
+		"NeRF snapshot to render.",
+		{"snapshot"},
+	};
+
+	ValueFlag<string> camera_path_flag{
+		parser,
+		"CAMERA_PATH",
+		"Camera path (as saved from the GUI) along which the video is rendered.",
+		{"camera_path"},
+	};
+
+	ValueFlag<string> output_flag{
+		parser,
+		"OUTPUT",
+		"printf-style pattern of the output frames. '.exr' files store linear colors, all others are written as PNG. Default: 'frames/%04d.png'.",
+		{'o', "output"},
+	};
+
+	ValueFlag<uint32_t> width_flag{
+		parser,
+		"WIDTH",
+		"Width of the frames. Default: 1920.",
+		{"width"},
+	};
+
+	ValueFlag<uint32_t> height_flag{
+		parser,
+		"HEIGHT",
+		"Height of the frames. Default: 1080.",
+		{"height"},
+	};
+
+	ValueFlag<float> fps_flag{
+		parser,
+		"FPS",
+		"Frames per second. Default: 30.",
+		{"fps"},
+	};
+
+	ValueFlag<float> duration_flag{
+		parser,
+		"DURATION",
+		"Duration of the video in seconds. Default: 5.",
+		{"duration"},
+	};
+
+	ValueFlag<uint32_t> spp_flag{
+		parser,
+		"SPP",
+		"Samples per pixel, distributed across the shutter interval for motion blur. Default: 8.",
+		{"spp"},
+	};
+
+	ValueFlag<float> shutter_fraction_flag{
+		parser,
+		"SHUTTER_FRACTION",
+		"Fraction of a frame during which the shutter is open. Default: 0.5.",
+		{"shutter_fraction"},
+	};
+
+	ValueFlag<uint32_t> queue_depth_flag{
+		parser,
+		"QUEUE_DEPTH",
+		"Maximum number of frames that are being read back or encoded at once. Default: 8.",
+		{"queue_depth"},
+	};
+
+	ValueFlag<uint32_t> encode_threads_flag{
+		parser,
+		"ENCODE_THREADS",
+		"Number of threads that read back and encode frames. Default: number of hardware threads.",
+		{"encode_threads"},
+	};
+
+	Flag constant_speed_flag{
+		parser,
+		"CONSTANT_SPEED",
+		"Moves along the camera path at constant speed rather than spending equal time between keyframes.",
+		{"constant_speed"},
+	};
+
+	Flag cpu_flag{
+		parser,
+		"CPU",
+		"Renders on the CPU rather than with CUDA.",
+		{"cpu"},
+	};
+
+	// Parse command line arguments and react to parsing
+	// errors using exceptions.
+	try {
+		parser.ParseCLI(argc, argv);
+	} catch (const Help&) {
+		cout << parser;
+		return 0;
+	} catch (const ParseError& e) {
+		cerr << e.what() << endl;
+		cerr << parser;
+		return -1;
+	} catch (const ValidationError& e) {
+		cerr << e.what() << endl;
+		cerr << parser;
+		return -2;
+	}
+
+	try {
+		if (!snapshot_flag || !camera_path_flag) {
+			tlog::error() << "Must specify a snapshot and a camera path.";
+			return 1;
+		}
+
+		for (const auto& path : {get(snapshot_flag), get(camera_path_flag)}) {
+			if (!fs::path{path}.exists()) {
+				tlog::error() << "Path " << path << " does not exist.";
+				return 1;
+			}
+		}
+
+		VideoRenderSettings settings;
+		settings.output_pattern = output_flag ? get(output_flag) : "frames/%04d.png";
+		settings.resolution = {width_flag ? get(width_flag) : 1920, height_flag ? get(height_flag) : 1080};
+		settings.fps = fps_flag ? get(fps_flag) : 30.0f;
+		settings.n_frames = (uint32_t)std::round((duration_flag ? get(duration_flag) : 5.0f) * settings.fps);
+		settings.spp = spp_flag ? get(spp_flag) : 8;
+		settings.shutter_fraction = shutter_fraction_flag ? get(shutter_fraction_flag) : 0.5f;
+		settings.queue_depth = queue_depth_flag ? get(queue_depth_flag) : 8;
+
+		fs::path output_dir = fs::path{video_frame_path(settings.output_pattern, 0)}.parent_path();
+		if (!output_dir.empty() && !output_dir.exists()) {
+			fs::create_directories(output_dir);
+		}
+
+		ThreadPool encode_pool{encode_threads_flag ? (size_t)get(encode_threads_flag) : (size_t)thread::hardware_concurrency()};
+
+		tlog::info() << "Rendering " << settings.n_frames << " frames at " << settings.resolution.x() << "x" << settings.resolution.y() << " with " << settings.spp << " spp.";
+
+		VideoRenderStats stats;
+		if (cpu_flag) {
+			ThreadPool render_pool;
+			stats = render_video_cpu(settings, get(snapshot_flag), get(camera_path_flag), constant_speed_flag, render_pool, encode_pool);
+		} else {
+			stats = render_video_cuda(settings, get(snapshot_flag), get(camera_path_flag), constant_speed_flag, encode_pool);
+		}
+
+		tlog::success() << "Rendered " << stats.n_frames << " frames in " << tlog::durationToString(std::chrono::milliseconds{(long long)stats.total_milliseconds}) << " (" << stats.frames_per_second() << " frames/s)";
+		tlog::info()
+			<< "render=" << stats.render_milliseconds / std::max(stats.n_frames, 1u) << "ms/frame"
+			<< " stall=" << stats.stall_milliseconds / std::max(stats.n_frames, 1u) << "ms/frame"
+			<< " encode=" << stats.encode_milliseconds / std::max(stats.n_frames, 1u) << "ms/frame";
+	} catch (const exception& e) {
+		tlog::error() << "Uncaught exception: " << e.what();
+		return 1;
+	}
+}
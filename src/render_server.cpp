@@ -0,0 +1,694 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+/** @file   render_server.cpp
+ *  @author Thomas Müller, NVIDIA
+ */
+
+#include <neural-graphics-primitives/render_server.h>
+#include <neural-graphics-primitives/video_render.h>
+
+#include <stb_image/stb_image_write.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <future>
+
+#ifndef _WIN32
+#  include <arpa/inet.h>
+#  include <netinet/in.h>
+#  include <netinet/tcp.h>
+#  include <sys/socket.h>
+#  include <sys/un.h>
+#  include <unistd.h>
+#endif
+
+using namespace Eigen;
+
+NGP_NAMESPACE_BEGIN
+
+namespace {
+
+static constexpr uint32_t MAX_SCENE_NAME_LENGTH = 1024;
+
+bool is_unix_address(const std::string& address) {
+	return address.rfind("unix:", 0) == 0;
+}
+
+#ifdef _WIN32
+int open_socket(const std::string&, bool) {
+	throw std::runtime_error{"The render server requires POSIX sockets."};
+}
+
+void shutdown_socket(int) {}
+void close_socket(int) {}
+
+bool read_bytes(int, void*, size_t) {
+	throw std::runtime_error{"The render server requires POSIX sockets."};
+}
+
+void write_bytes(int, const void*, size_t) {
+	throw std::runtime_error{"The render server requires POSIX sockets."};
+}
+#else
+int open_socket(const std::string& address, bool listening) {
+	int s;
+	if (is_unix_address(address)) {
+		std::string path = address.substr(5);
+
+		sockaddr_un addr = {};
+		addr.sun_family = AF_UNIX;
+		if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+			throw std::runtime_error{"Invalid Unix socket path \"" + path + "\"."};
+		}
+		std::copy(path.begin(), path.end(), addr.sun_path);
+
+		s = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (s < 0) {
+			throw std::runtime_error{std::string{"Failed to create socket: "} + strerror(errno)};
+		}
+
+		if (listening) {
+			// Remove the socket file of a previous server that did not shut down cleanly.
+			unlink(path.c_str());
+		}
+
+		int result = listening ? bind(s, (sockaddr*)&addr, sizeof(addr)) : connect(s, (sockaddr*)&addr, sizeof(addr));
+		if (result < 0) {
+			int error = errno;
+			close(s);
+			throw std::runtime_error{"Failed to " + std::string{listening ? "bind" : "connect"} + " to \"" + path + "\": " + strerror(error)};
+		}
+	} else {
+		int port = std::stoi(address);
+		if (port <= 0 || port > 65535) {
+			throw std::runtime_error{"Invalid port \"" + address + "\"."};
+		}
+
+		sockaddr_in addr = {};
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons((uint16_t)port);
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		s = socket(AF_INET, SOCK_STREAM, 0);
+		if (s < 0) {
+			throw std::runtime_error{std::string{"Failed to create socket: "} + strerror(errno)};
+		}
+
+		int one = 1;
+		setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		if (listening) {
+			setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+		}
+
+		int result = listening ? bind(s, (sockaddr*)&addr, sizeof(addr)) : connect(s, (sockaddr*)&addr, sizeof(addr));
+		if (result < 0) {
+			int error = errno;
+			close(s);
+			throw std::runtime_error{"Failed to " + std::string{listening ? "bind" : "connect"} + " to port " + address + ": " + strerror(error)};
+		}
+	}
+
+#ifdef SO_NOSIGPIPE
+	int one = 1;
+	setsockopt(s, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+
+	if (listening && listen(s, SOMAXCONN) < 0) {
+		int error = errno;
+		close(s);
+		throw std::runtime_error{std::string{"Failed to listen: "} + strerror(error)};
+	}
+
+	return s;
+}
+
+void shutdown_socket(int s) {
+	shutdown(s, SHUT_RDWR);
+}
+
+void close_socket(int s) {
+	close(s);
+}
+
+// Returns false if the peer closed the connection.
+bool read_bytes(int s, void* dst, size_t n_bytes) {
+	uint8_t* ptr = (uint8_t*)dst;
+	while (n_bytes > 0) {
+		ssize_t n = recv(s, ptr, n_bytes, 0);
+		if (n == 0) {
+			return false;
+		} else if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+
+		ptr += n;
+		n_bytes -= n;
+	}
+
+	return true;
+}
+
+void write_bytes(int s, const void* src, size_t n_bytes) {
+#ifdef MSG_NOSIGNAL
+	const int flags = MSG_NOSIGNAL;
+#else
+	const int flags = 0;
+#endif
+
+	const uint8_t* ptr = (const uint8_t*)src;
+	while (n_bytes > 0) {
+		ssize_t n = send(s, ptr, n_bytes, flags);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			throw std::runtime_error{std::string{"Failed to send: "} + strerror(errno)};
+		}
+
+		ptr += n;
+		n_bytes -= n;
+	}
+}
+#endif
+
+template <typename T>
+void put(std::vector<uint8_t>& buffer, const T& value) {
+	const uint8_t* ptr = (const uint8_t*)&value;
+	buffer.insert(buffer.end(), ptr, ptr + sizeof(T));
+}
+
+template <typename T>
+bool get(int s, T& value) {
+	return read_bytes(s, &value, sizeof(T));
+}
+
+void send_request(int s, const RenderServerRequest& request) {
+	std::vector<uint8_t> buffer;
+	put(buffer, RENDER_SERVER_MAGIC);
+	put(buffer, (uint32_t)request.scene.size());
+	buffer.insert(buffer.end(), request.scene.begin(), request.scene.end());
+	put(buffer, (uint32_t)request.resolution.x());
+	put(buffer, (uint32_t)request.resolution.y());
+	for (int row = 0; row < 3; ++row) {
+		for (int col = 0; col < 4; ++col) {
+			put(buffer, request.camera_matrix(row, col));
+		}
+	}
+	put(buffer, request.fov);
+	put(buffer, request.zoom);
+	put(buffer, request.max_spp);
+	put(buffer, (uint32_t)request.format);
+	write_bytes(s, buffer.data(), buffer.size());
+}
+
+// Returns false if the peer closed the connection and throws if the request is malformed.
+bool receive_request(int s, RenderServerRequest& request) {
+	uint32_t magic, name_length;
+	if (!get(s, magic)) {
+		return false;
+	}
+
+	if (magic != RENDER_SERVER_MAGIC) {
+		throw std::runtime_error{"Invalid request magic."};
+	}
+
+	if (!get(s, name_length)) {
+		return false;
+	}
+
+	if (name_length > MAX_SCENE_NAME_LENGTH) {
+		throw std::runtime_error{"Scene name is too long."};
+	}
+
+	request.scene.resize(name_length);
+	uint32_t width, height, format;
+	float camera[12];
+	if (!read_bytes(s, &request.scene[0], name_length) || !get(s, width) || !get(s, height) || !get(s, camera) ||
+		!get(s, request.fov) || !get(s, request.zoom) || !get(s, request.max_spp) || !get(s, format)) {
+		return false;
+	}
+
+	request.resolution = {(int)std::min(width, (uint32_t)INT32_MAX), (int)std::min(height, (uint32_t)INT32_MAX)};
+	for (int row = 0; row < 3; ++row) {
+		for (int col = 0; col < 4; ++col) {
+			request.camera_matrix(row, col) = camera[row*4 + col];
+		}
+	}
+	request.format = (ERenderServerFormat)format;
+	return true;
+}
+
+void send_response(int s, const RenderServerResponse& response) {
+	std::vector<uint8_t> buffer;
+	put(buffer, RENDER_SERVER_MAGIC);
+	put(buffer, (uint32_t)response.status);
+	put(buffer, response.spp);
+	put(buffer, (uint32_t)response.resolution.x());
+	put(buffer, (uint32_t)response.resolution.y());
+	put(buffer, (uint32_t)response.format);
+	put(buffer, (uint32_t)response.payload.size());
+	write_bytes(s, buffer.data(), buffer.size());
+	write_bytes(s, response.payload.data(), response.payload.size());
+}
+
+bool receive_response(int s, RenderServerResponse& response) {
+	uint32_t magic, status, width, height, format, size;
+	if (!get(s, magic)) {
+		return false;
+	}
+
+	if (magic != RENDER_SERVER_MAGIC) {
+		throw std::runtime_error{"Invalid response magic."};
+	}
+
+	if (!get(s, status) || !get(s, response.spp) || !get(s, width) || !get(s, height) || !get(s, format) || !get(s, size)) {
+		return false;
+	}
+
+	response.status = (ERenderServerStatus)status;
+	response.resolution = {(int)width, (int)height};
+	response.format = (ERenderServerFormat)format;
+	response.payload.resize(size);
+	return read_bytes(s, response.payload.data(), size);
+}
+
+RenderServerResponse error_response(ERenderServerStatus status, const std::string& message) {
+	RenderServerResponse response;
+	response.status = status;
+	response.payload.assign(message.begin(), message.end());
+	return response;
+}
+
+}
+
+Vector2f RenderServerRequest::focal_length() const {
+	// Same as Testbed::set_fov followed by Testbed::calc_focal_length with fov axis 1
+	const float pi = 3.14159265358979323846f;
+	return Vector2f::Constant(0.5f / std::tan(0.5f * fov * pi / 180.0f) * resolution.y() * zoom);
+}
+
+CpuRenderServerScene::CpuRenderServerScene(const std::string& snapshot_path, const CpuNerfRenderSettings& settings) : m_settings{settings} {
+	m_renderer.load_snapshot(snapshot_path);
+
+	// Views are accumulated in linear space and only tonemapped when they are sent.
+	m_settings.to_srgb = false;
+	m_settings.resolution = Vector2i::Zero();
+}
+
+void CpuRenderServerScene::render(const std::vector<RenderServerView>& views, ThreadPool& pool) {
+	BatchRenderPlan plan;
+	plan.views.resize(views.size());
+
+	for (size_t i = 0; i < views.size(); ++i) {
+		const RenderServerRequest& request = *views[i].request;
+
+		BatchRenderView& view = plan.views[i];
+		view.camera_matrix = request.camera_matrix;
+		view.resolution = request.resolution;
+		view.spp = views[i].spp;
+		view.spp_offset = views[i].spp_offset;
+		view.focal_length = request.focal_length();
+		view.offset = plan.n_floats;
+
+		plan.n_floats += view.n_floats();
+		plan.uniform_resolution &= view.resolution == plan.views[0].resolution;
+		plan.max_resolution = plan.max_resolution.cwiseMax(view.resolution);
+	}
+
+	m_samples.resize(plan.n_floats);
+	m_renderer.render_batch(m_settings, plan, pool, m_samples.data());
+
+	for (size_t i = 0; i < views.size(); ++i) {
+		const BatchRenderView& view = plan.views[i];
+		const float* samples = m_samples.data() + view.offset;
+		float* rgba = views[i].rgba;
+
+		float weight = (float)view.spp / (view.spp_offset + view.spp);
+		pool.parallelFor<size_t>(0, view.n_floats(), [&](size_t j) {
+			rgba[j] += (samples[j] - rgba[j]) * weight;
+		});
+	}
+}
+
+struct RenderServer::Client {
+	uint32_t id;
+	int socket;
+	std::thread thread;
+	std::atomic<bool> done{false};
+
+	// The view that is being refined. Only touched by the dispatch thread while a job of the client is pending.
+	bool has_view = false;
+	RenderServerRequest view;
+	uint32_t spp = 0;
+	std::vector<float> rgba;
+};
+
+struct RenderServer::Job {
+	Client* client;
+	uint32_t spp;
+	std::promise<void> done;
+};
+
+RenderServer::RenderServer(const RenderServerSettings& settings) : m_settings{settings} {
+	m_settings.spp_per_pass = std::max(m_settings.spp_per_pass, 1u);
+	m_settings.max_batch_views = std::max(m_settings.max_batch_views, 1u);
+}
+
+RenderServer::~RenderServer() {
+	stop();
+}
+
+void RenderServer::add_scene(const std::string& name, std::shared_ptr<RenderServerScene> scene) {
+	if (name.size() > MAX_SCENE_NAME_LENGTH) {
+		throw std::runtime_error{"Scene name is too long."};
+	}
+
+	std::lock_guard<std::mutex> lock{m_scenes_mutex};
+	m_scenes[name] = std::move(scene);
+}
+
+void RenderServer::start() {
+	if (m_accept_thread.joinable()) {
+		throw std::runtime_error{"Render server is already running."};
+	}
+
+	m_stopping = false;
+	m_listen_socket = open_socket(m_settings.address, true);
+	m_dispatch_thread = std::thread{[this]() { dispatch_loop(); }};
+	m_accept_thread = std::thread{[this]() { accept_loop(); }};
+
+	tlog::info() << "Render server listening on " << (is_unix_address(m_settings.address) ? m_settings.address : "127.0.0.1:" + m_settings.address);
+}
+
+void RenderServer::stop() {
+	if (!m_accept_thread.joinable()) {
+		return;
+	}
+
+	m_stopping = true;
+
+	// Wakes up the accept thread
+	shutdown_socket(m_listen_socket);
+	m_accept_thread.join();
+	close_socket(m_listen_socket);
+	m_listen_socket = -1;
+
+#ifndef _WIN32
+	if (is_unix_address(m_settings.address)) {
+		unlink(m_settings.address.substr(5).c_str());
+	}
+#endif
+
+	// Taking the lock ensures that the dispatch thread either sees `m_stopping` or is already waiting.
+	{
+		std::lock_guard<std::mutex> lock{m_jobs_mutex};
+	}
+	m_jobs_condition.notify_all();
+	m_dispatch_thread.join();
+
+	reap_clients(true);
+}
+
+void RenderServer::accept_loop() {
+	while (!m_stopping) {
+#ifdef _WIN32
+		int s = -1;
+#else
+		int s = accept(m_listen_socket, nullptr, nullptr);
+#endif
+		if (s < 0) {
+			if (m_stopping) {
+				break;
+			}
+
+			if (errno == EINTR || errno == ECONNABORTED) {
+				continue;
+			}
+
+			tlog::error() << "Render server: failed to accept connection: " << strerror(errno);
+			break;
+		}
+
+		reap_clients(false);
+
+		std::lock_guard<std::mutex> lock{m_clients_mutex};
+		if (m_clients.size() >= m_settings.max_clients) {
+			++m_stats.n_rejected;
+			try {
+				send_response(s, error_response(ERenderServerStatus::Busy, "Too many clients."));
+			} catch (const std::runtime_error&) {}
+			close_socket(s);
+			continue;
+		}
+
+		auto client = std::make_unique<Client>();
+		client->id = m_next_client_id++;
+		client->socket = s;
+
+		Client* ptr = client.get();
+		client->thread = std::thread{[this, ptr]() { client_loop(*ptr); }};
+		m_clients[ptr->id] = std::move(client);
+	}
+}
+
+void RenderServer::client_loop(Client& client) {
+	try {
+		RenderServerRequest request;
+		while (true) {
+			try {
+				if (!receive_request(client.socket, request)) {
+					break;
+				}
+			} catch (const std::runtime_error& e) {
+				// The stream cannot be resynchronized after a malformed request.
+				send_response(client.socket, error_response(ERenderServerStatus::InvalidRequest, e.what()));
+				break;
+			}
+
+			++m_stats.n_requests;
+			send_response(client.socket, handle_request(client, request));
+		}
+	} catch (const std::exception& e) {
+		if (!m_stopping) {
+			tlog::warning() << "Render server: client " << client.id << ": " << e.what();
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> scenes_lock{m_scenes_mutex};
+		std::lock_guard<std::mutex> render_lock{m_render_mutex};
+		for (auto& scene : m_scenes) {
+			scene.second->release_client(client.id);
+		}
+	}
+
+	client.done = true;
+}
+
+RenderServerResponse RenderServer::handle_request(Client& client, const RenderServerRequest& request) {
+	if (request.resolution.x() <= 0 || request.resolution.y() <= 0 || (uint64_t)request.resolution.x() * request.resolution.y() > m_settings.max_pixels) {
+		return error_response(ERenderServerStatus::InvalidRequest, "Invalid resolution.");
+	}
+
+	if (request.max_spp == 0) {
+		return error_response(ERenderServerStatus::InvalidRequest, "max_spp must be at least 1.");
+	}
+
+	if ((uint32_t)request.format > (uint32_t)ERenderServerFormat::Float) {
+		return error_response(ERenderServerStatus::InvalidRequest, "Unknown image format.");
+	}
+
+	{
+		std::lock_guard<std::mutex> lock{m_scenes_mutex};
+		if (!m_scenes.count(request.scene)) {
+			return error_response(ERenderServerStatus::UnknownScene, "Unknown scene \"" + request.scene + "\".");
+		}
+	}
+
+	size_t n_pixels = (size_t)request.resolution.x() * request.resolution.y();
+
+	// A changed view restarts the refinement
+	if (!client.has_view || !client.view.same_view(request)) {
+		client.has_view = true;
+		client.view = request;
+		client.spp = 0;
+		client.rgba.assign(n_pixels * 4, 0.0f);
+	}
+
+	uint32_t target_spp = std::min(request.max_spp, m_settings.max_spp);
+	if (client.spp < target_spp) {
+		Job job;
+		job.client = &client;
+		job.spp = std::min(m_settings.spp_per_pass, target_spp - client.spp);
+
+		auto done = job.done.get_future();
+		{
+			std::lock_guard<std::mutex> lock{m_jobs_mutex};
+			if (m_stopping) {
+				return error_response(ERenderServerStatus::Error, "Render server is shutting down.");
+			}
+
+			if (m_jobs.size() >= m_settings.max_pending) {
+				++m_stats.n_rejected;
+				return error_response(ERenderServerStatus::Busy, "Too many pending requests.");
+			}
+
+			m_jobs.emplace_back(&job);
+		}
+		m_jobs_condition.notify_one();
+
+		try {
+			done.get();
+		} catch (const std::exception& e) {
+			client.has_view = false;
+			return error_response(ERenderServerStatus::Error, e.what());
+		}
+	}
+
+	// Encoding happens on the client's thread, such that the frames of different clients are compressed in parallel.
+	RenderServerResponse response;
+	response.spp = client.spp;
+	response.resolution = request.resolution;
+	response.format = request.format;
+
+	switch (request.format) {
+		case ERenderServerFormat::Png: {
+			std::vector<uint8_t> pixels = linear_to_srgb8(client.rgba.data(), n_pixels);
+			auto append = [](void* context, void* data, int size) {
+				auto& payload = *(std::vector<uint8_t>*)context;
+				payload.insert(payload.end(), (uint8_t*)data, (uint8_t*)data + size);
+			};
+
+			if (!stbi_write_png_to_func(append, &response.payload, request.resolution.x(), request.resolution.y(), 4, pixels.data(), request.resolution.x() * 4)) {
+				return error_response(ERenderServerStatus::Error, "Failed to encode PNG.");
+			}
+		} break;
+		case ERenderServerFormat::Rgba8: response.payload = linear_to_srgb8(client.rgba.data(), n_pixels); break;
+		case ERenderServerFormat::Float:
+			response.payload.resize(client.rgba.size() * sizeof(float));
+			std::memcpy(response.payload.data(), client.rgba.data(), response.payload.size());
+			break;
+	}
+
+	return response;
+}
+
+void RenderServer::dispatch_loop() {
+	while (true) {
+		std::vector<Job*> batch;
+		std::string scene_name;
+
+		{
+			std::unique_lock<std::mutex> lock{m_jobs_mutex};
+			m_jobs_condition.wait(lock, [&]() { return !m_jobs.empty() || m_stopping; });
+
+			if (m_stopping) {
+				for (Job* job : m_jobs) {
+					job->done.set_exception(std::make_exception_ptr(std::runtime_error{"Render server is shutting down."}));
+				}
+				m_jobs.clear();
+				return;
+			}
+
+			// Coalesce pending views of the oldest job's scene. Apart from the oldest job, views with the fewest
+			// accumulated samples go first, such that clients that moved their camera see a new image quickly.
+			Job* oldest = m_jobs.front();
+			scene_name = oldest->client->view.scene;
+
+			std::vector<Job*> candidates;
+			std::copy_if(m_jobs.begin() + 1, m_jobs.end(), std::back_inserter(candidates), [&](Job* job) { return job->client->view.scene == scene_name; });
+			std::stable_sort(candidates.begin(), candidates.end(), [](Job* a, Job* b) { return a->client->spp < b->client->spp; });
+
+			batch.emplace_back(oldest);
+			batch.insert(batch.end(), candidates.begin(), candidates.begin() + std::min(candidates.size(), (size_t)m_settings.max_batch_views - 1));
+
+			m_jobs.erase(std::remove_if(m_jobs.begin(), m_jobs.end(), [&](Job* job) {
+				return std::find(batch.begin(), batch.end(), job) != batch.end();
+			}), m_jobs.end());
+		}
+
+		std::exception_ptr error;
+		try {
+			std::shared_ptr<RenderServerScene> scene;
+			{
+				std::lock_guard<std::mutex> lock{m_scenes_mutex};
+				scene = m_scenes.at(scene_name);
+			}
+
+			std::vector<RenderServerView> views;
+			for (Job* job : batch) {
+				views.push_back({&job->client->view, job->client->id, job->client->spp, job->spp, job->client->rgba.data()});
+			}
+
+			std::lock_guard<std::mutex> lock{m_render_mutex};
+			scene->render(views, m_pool);
+		} catch (...) {
+			error = std::current_exception();
+		}
+
+		++m_stats.n_batches;
+		m_stats.n_views += batch.size();
+
+		for (Job* job : batch) {
+			if (error) {
+				job->done.set_exception(error);
+			} else {
+				job->client->spp += job->spp;
+				job->done.set_value();
+			}
+		}
+	}
+}
+
+void RenderServer::reap_clients(bool all) {
+	std::lock_guard<std::mutex> lock{m_clients_mutex};
+	for (auto it = m_clients.begin(); it != m_clients.end();) {
+		Client& client = *it->second;
+		if (!all && !client.done) {
+			++it;
+			continue;
+		}
+
+		// Unblocks a client thread that waits for the next request
+		shutdown_socket(client.socket);
+		client.thread.join();
+		close_socket(client.socket);
+		it = m_clients.erase(it);
+	}
+}
+
+RenderClient::RenderClient(const std::string& address) {
+	m_socket = open_socket(address, false);
+}
+
+RenderClient::~RenderClient() {
+	if (m_socket >= 0) {
+		close_socket(m_socket);
+	}
+}
+
+RenderServerResponse RenderClient::render(const RenderServerRequest& request) {
+	send_request(m_socket, request);
+
+	RenderServerResponse response;
+	if (!receive_response(m_socket, response)) {
+		throw std::runtime_error{"Render server closed the connection."};
+	}
+
+	return response;
+}
+
+NGP_NAMESPACE_END
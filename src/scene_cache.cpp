@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+/** @file   scene_cache.cpp
+ *  @author Thomas Müller, NVIDIA
+ */
+
+#include <neural-graphics-primitives/scene_cache.h>
+
+#include <algorithm>
+
+NGP_NAMESPACE_BEGIN
+
+void SceneCachePolicy::add(const std::string& name, size_t host_bytes) {
+	Entry& entry = m_entries[name];
+
+	// Re-adding a scene invalidates what was loaded from its previous file
+	set_tier(entry, ESceneTier::Disk);
+	entry.host_bytes = host_bytes;
+	entry.resident_bytes = 0;
+}
+
+const SceneCachePolicy::Entry& SceneCachePolicy::entry(const std::string& name) const {
+	auto it = m_entries.find(name);
+	if (it == m_entries.end()) {
+		throw std::runtime_error{"Unknown scene \"" + name + "\"."};
+	}
+	return it->second;
+}
+
+void SceneCachePolicy::touch(const std::string& name) {
+	auto it = m_entries.find(name);
+	if (it == m_entries.end()) {
+		throw std::runtime_error{"Unknown scene \"" + name + "\"."};
+	}
+
+	it->second.last_use = ++m_clock;
+
+	if (!m_last_touched.empty() && m_last_touched != name) {
+		++m_successors[m_last_touched][name];
+	}
+	m_last_touched = name;
+}
+
+std::vector<SceneCachePolicy::Demotion> SceneCachePolicy::promote(const std::string& name, ESceneTier tier, size_t resident_bytes) {
+	auto it = m_entries.find(name);
+	if (it == m_entries.end()) {
+		throw std::runtime_error{"Unknown scene \"" + name + "\"."};
+	}
+
+	Entry& entry = it->second;
+	if (tier == ESceneTier::Resident) {
+		set_tier(entry, ESceneTier::Host);
+		entry.resident_bytes = resident_bytes;
+	}
+	set_tier(entry, std::max(entry.tier, tier));
+
+	std::vector<Demotion> demotions;
+	while (m_resident_bytes > m_resident_budget) {
+		auto victim = least_recently_used(ESceneTier::Resident, name);
+		if (victim == m_entries.end()) {
+			break;
+		}
+
+		set_tier(victim->second, ESceneTier::Host);
+		demotions.push_back({victim->first, ESceneTier::Host});
+	}
+
+	while (m_host_bytes > m_host_budget) {
+		auto victim = least_recently_used(ESceneTier::Host, name);
+		if (victim == m_entries.end()) {
+			break;
+		}
+
+		set_tier(victim->second, ESceneTier::Disk);
+		demotions.push_back({victim->first, ESceneTier::Disk});
+	}
+
+	return demotions;
+}
+
+void SceneCachePolicy::demote(const std::string& name, ESceneTier tier) {
+	auto it = m_entries.find(name);
+	if (it == m_entries.end()) {
+		throw std::runtime_error{"Unknown scene \"" + name + "\"."};
+	}
+
+	set_tier(it->second, std::min(it->second.tier, tier));
+}
+
+std::vector<std::string> SceneCachePolicy::predict_successors(const std::string& name, size_t n) const {
+	auto it = m_successors.find(name);
+	if (it == m_successors.end()) {
+		return {};
+	}
+
+	std::vector<std::pair<std::string, uint32_t>> successors(it->second.begin(), it->second.end());
+	std::stable_sort(successors.begin(), successors.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+
+	std::vector<std::string> result;
+	for (size_t i = 0; i < std::min(n, successors.size()); ++i) {
+		result.emplace_back(successors[i].first);
+	}
+	return result;
+}
+
+void SceneCachePolicy::set_tier(Entry& entry, ESceneTier tier) {
+	if (entry.tier >= ESceneTier::Host) {
+		m_host_bytes -= entry.host_bytes;
+	}
+	if (entry.tier == ESceneTier::Resident) {
+		m_resident_bytes -= entry.resident_bytes;
+	}
+
+	entry.tier = tier;
+
+	if (entry.tier >= ESceneTier::Host) {
+		m_host_bytes += entry.host_bytes;
+	}
+	if (entry.tier == ESceneTier::Resident) {
+		m_resident_bytes += entry.resident_bytes;
+	}
+}
+
+std::map<std::string, SceneCachePolicy::Entry>::iterator SceneCachePolicy::least_recently_used(ESceneTier tier, const std::string& except) {
+	auto result = m_entries.end();
+	for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+		if (it->first == except || it->second.tier < tier) {
+			continue;
+		}
+
+		if (result == m_entries.end() || it->second.last_use < result->second.last_use) {
+			result = it;
+		}
+	}
+
+	return result;
+}
+
+NGP_NAMESPACE_END
@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+/** @file   serve_main.cu
+ *  @author Thomas Müller, NVIDIA
+ *  @brief  Render service that hosts several NeRF snapshots in one process and
+ *          serves interactive previews to local clients.
+ */
+
+#include <neural-graphics-primitives/render_buffer.h>
+#include <neural-graphics-primitives/render_server.h>
+#include <neural-graphics-primitives/testbed.h>
+
+#include <tiny-cuda-nn/common.h>
+
+#include <args/args.hxx>
+
+#include <filesystem/path.h>
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <thread>
+
+using namespace args;
+using namespace Eigen;
+using namespace ngp;
+using namespace std;
+using namespace tcnn;
+namespace fs = filesystem;
+
+// Renders with CUDA. Every client accumulates its samples in a render buffer of its own,
+// such that progressive refinement continues where the client's previous request stopped.
+class TestbedRenderServerScene : public RenderServerScene {
+public:
+	TestbedRenderServerScene(const string& snapshot_path) : m_testbed{ETestbedMode::Nerf} {
+		CUDA_CHECK_THROW(cudaGetDevice(&m_device));
+		m_testbed.load_snapshot(snapshot_path);
+	}
+
+	void render(const vector<RenderServerView>& views, ThreadPool& pool) override {
+		CUDA_CHECK_THROW(cudaSetDevice(m_device));
+
+		for (const auto& view : views) {
+			const RenderServerRequest& request = *view.request;
+
+			auto& buffer = m_buffers[view.client];
+			if (!buffer) {
+				buffer = make_unique<CudaRenderBuffer>(make_shared<CudaSurface2D>());
+			}
+
+			// Restart if the buffer does not hold the samples that the server expects, e.g. after an error.
+			uint32_t spp = view.spp;
+			if (view.spp_offset == 0 || buffer->spp() != view.spp_offset || buffer->resolution() != request.resolution) {
+				buffer->resize(request.resolution);
+				buffer->reset_accumulation();
+				spp += view.spp_offset;
+			}
+
+			m_testbed.set_fov(request.fov);
+			m_testbed.m_zoom = request.zoom;
+			for (uint32_t i = 0; i < spp; ++i) {
+				m_testbed.render_frame(request.camera_matrix, request.camera_matrix, *buffer, false);
+			}
+
+			size_t pitch = request.resolution.x() * sizeof(float) * 4;
+			CUDA_CHECK_THROW(cudaMemcpy2DFromArray(view.rgba, pitch, buffer->surface_provider().array(), 0, 0, pitch, request.resolution.y(), cudaMemcpyDeviceToHost));
+		}
+	}
+
+	void release_client(uint32_t client) override {
+		m_buffers.erase(client);
+	}
+
+private:
+	Testbed m_testbed;
+	int m_device;
+	map<uint32_t, unique_ptr<CudaRenderBuffer>> m_buffers;
+};
+
+namespace {
+	atomic<bool> g_stop{false};
+}
+
+int main(int argc, char** argv) {
+	ArgumentParser parser{
+		"neural graphics primitives render server\n"
+		"version " NGP_VERSION,
+		"",
+	};
+
+	HelpFlag help_flag{
+		parser,
+		"HELP",
+		"Display this help menu.",
+		{'h', "help"},
+	};
+
+	ValueFlagList<string> scene_flag{
+		parser,
+		"SCENE",
+		"Snapshot to serve, given as NAME=PATH. May be repeated to host several scenes.",
+		{'s', "scene"},
+	};
+
+	ValueFlag<string> address_flag{
+		parser,
+		"ADDRESS",
+		"'unix:<path>' to listen on a Unix domain socket or a TCP port on localhost. Default: 'unix:/tmp/ngp_render.sock'.",
+		{'a', "address"},
+	};
+
+	ValueFlag<uint32_t> spp_per_pass_flag{
+		parser,
+		"SPP_PER_PASS",
+		"Samples per pixel by which a client's view is refined per request. Default: 1.",
+		{"spp_per_pass"},
+	};
+
+	ValueFlag<uint32_t> max_clients_flag{
+		parser,
+		"MAX_CLIENTS",
+		"Maximum number of connected clients. Default: 64.",
+		{"max_clients"},
+	};
+
+	ValueFlag<uint32_t> max_pending_flag{
+		parser,
+		"MAX_PENDING",
+		"Maximum number of requests waiting to be rendered; further requests are rejected as busy. Default: 32.",
+		{"max_pending"},
+	};
+
+	ValueFlag<uint32_t> max_batch_views_flag{
+		parser,
+		"MAX_BATCH_VIEWS",
+		"Maximum number of views of a scene that are rendered as one batch. Default: 16.",
+		{"max_batch_views"},
+	};
+
+	Flag cpu_flag{
+		parser,
+		"CPU",
+		"Renders on the CPU rather than with CUDA.",
+		{"cpu"},
+	};
+
+	// Parse command line arguments and react to parsing
+	// errors using exceptions.
+	try {
+		parser.ParseCLI(argc, argv);
+	} catch (const Help&) {
+		cout << parser;
+		return 0;
+	} catch (const ParseError& e) {
+		cerr << e.what() << endl;
+		cerr << parser;
+		return -1;
+	} catch (const ValidationError& e) {
+		cerr << e.what() << endl;
+		cerr << parser;
+		return -2;
+	}
+
+	try {
+		RenderServerSettings settings;
+		if (address_flag) {
+			settings.address = get(address_flag);
+		}
+		if (spp_per_pass_flag) {
+			settings.spp_per_pass = get(spp_per_pass_flag);
+		}
+		if (max_clients_flag) {
+			settings.max_clients = get(max_clients_flag);
+		}
+		if (max_pending_flag) {
+			settings.max_pending = get(max_pending_flag);
+		}
+		if (max_batch_views_flag) {
+			settings.max_batch_views = get(max_batch_views_flag);
+		}
+
+		RenderServer server{settings};
+
+		if (get(scene_flag).empty()) {
+			tlog::error() << "Must specify at least one scene.";
+			return 1;
+		}
+
+		for (const auto& scene : get(scene_flag)) {
+			size_t separator = scene.find('=');
+			if (separator == string::npos) {
+				tlog::error() << "Scene " << scene << " is not of the form NAME=PATH.";
+				return 1;
+			}
+
+			string name = scene.substr(0, separator);
+			string path = scene.substr(separator + 1);
+			if (!fs::path{path}.exists()) {
+				tlog::error() << "Path " << path << " does not exist.";
+				return 1;
+			}
+
+			tlog::info() << "Loading scene " << name << " from " << path;
+			if (cpu_flag) {
+				server.add_scene(name, make_shared<CpuRenderServerScene>(path));
+			} else {
+				server.add_scene(name, make_shared<TestbedRenderServerScene>(path));
+			}
+		}
+
+		signal(SIGINT, [](int) { g_stop = true; });
+		signal(SIGTERM, [](int) { g_stop = true; });
+
+		server.start();
+		while (!g_stop) {
+			this_thread::sleep_for(chrono::milliseconds{100});
+		}
+
+		tlog::info() << "Shutting down";
+		server.stop();
+
+		const auto& stats = server.stats();
+		tlog::success()
+			<< "Served " << stats.n_requests << " requests in " << stats.n_batches << " batches"
+			<< " (" << (stats.n_batches > 0 ? (double)stats.n_views / stats.n_batches : 0.0) << " views/batch), "
+			<< stats.n_rejected << " rejected";
+	} catch (const exception& e) {
+		tlog::error() << "Uncaught exception: " << e.what();
+		return 1;
+	}
+}
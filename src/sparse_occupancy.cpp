@@ -0,0 +1,321 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+/** @file   sparse_occupancy.cpp
+ *  @author Thomas Müller, NVIDIA
+ *  @brief  Construction of the two-level occupancy brick map and its comparison against the dense cascades.
+ */
+
+#include <neural-graphics-primitives/sparse_occupancy.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <tuple>
+
+using namespace Eigen;
+
+NGP_NAMESPACE_BEGIN
+
+namespace {
+
+constexpr uint32_t BRICK_SIZE = SPARSE_OCCUPANCY_BRICK_SIZE;
+constexpr uint32_t BRICK_CELLS = BRICK_SIZE * BRICK_SIZE * BRICK_SIZE;
+
+// Same as MIN_CONE_STEPSIZE() in testbed_nerf.cu
+constexpr float MIN_CONE_STEPSIZE = 1.73205080757f / 1024;
+
+inline float network_to_density(float val, ENerfActivation activation) {
+	switch (activation) {
+		case ENerfActivation::None: return val;
+		case ENerfActivation::ReLU: return val > 0.0f ? val : 0.0f;
+		case ENerfActivation::Logistic: return 1.0f / (1.0f + std::exp(-val));
+		case ENerfActivation::Exponential: return std::exp(val);
+	}
+	return 0.0f;
+}
+
+inline uint64_t splitmix64(uint64_t& state) {
+	uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
+
+inline float random_float(uint64_t& state) {
+	return (float)(splitmix64(state) >> 40) * (1.0f / (1u << 24));
+}
+
+// Cells of all cascades are aligned to multiples of their size, such that the dense
+// traversal is the same DDA as distance_to_next_voxel() in testbed_nerf.cu.
+inline float distance_to_cell_exit(const Vector3f& pos, const Vector3f& dir, float cell_size) {
+	float t = std::numeric_limits<float>::infinity();
+	for (uint32_t i = 0; i < 3; ++i) {
+		float p = pos[i] / cell_size;
+		if (dir[i] > 0.0f) {
+			t = std::min(t, (std::floor(p) + 1.0f - p) / dir[i]);
+		} else if (dir[i] < 0.0f) {
+			t = std::min(t, (std::floor(p) - p) / dir[i]);
+		}
+	}
+	return std::max(t, 0.0f) * cell_size;
+}
+
+// Interval of the ray within `box`. Empty if the first element exceeds the second.
+inline std::pair<float, float> ray_intersect(const AlignedBox3f& box, const Vector3f& origin, const Vector3f& dir) {
+	float t0 = 0.0f, t1 = std::numeric_limits<float>::infinity();
+	for (uint32_t i = 0; i < 3; ++i) {
+		if (dir[i] == 0.0f) {
+			if (origin[i] < box.min()[i] || origin[i] > box.max()[i]) {
+				return {1.0f, 0.0f};
+			}
+			continue;
+		}
+
+		float near = (box.min()[i] - origin[i]) / dir[i];
+		float far = (box.max()[i] - origin[i]) / dir[i];
+		t0 = std::max(t0, std::min(near, far));
+		t1 = std::min(t1, std::max(near, far));
+	}
+	return {t0, t1};
+}
+
+}
+
+SparseOccupancyGrid::SparseOccupancyGrid(const AlignedBox3f& domain, uint32_t resolution) {
+	if (domain.isEmpty() || resolution == 0) {
+		throw std::runtime_error{"SparseOccupancyGrid: domain and resolution must not be empty."};
+	}
+
+	m_domain_min = domain.min();
+	m_cell_size = domain.diagonal().maxCoeff() / resolution;
+	for (uint32_t i = 0; i < 3; ++i) {
+		float n_cells = std::ceil(domain.diagonal()[i] / m_cell_size - 1e-3f);
+		m_top_resolution[i] = std::max(1, (int)std::ceil(n_cells / BRICK_SIZE));
+	}
+
+	m_top.assign((size_t)m_top_resolution.prod(), SPARSE_OCCUPANCY_EMPTY_BRICK);
+}
+
+void SparseOccupancyGrid::build(const OccupancyGrid& coarse, const occupancy_fun_t& fun, ThreadPool* pool) {
+	if (m_top.empty()) {
+		throw std::runtime_error{"SparseOccupancyGrid: domain and resolution must be set before building."};
+	}
+
+	std::fill(m_top.begin(), m_top.end(), SPARSE_OCCUPANCY_EMPTY_BRICK);
+	m_bricks.clear();
+	m_n_full_bricks = 0;
+	m_n_occupied_cells = 0;
+
+	// Bricks are evaluated one slice of the top level at a time, such that only the
+	// bits of a single slice are held before the partially occupied bricks are compacted.
+	const uint32_t n_slice = m_top_resolution.x() * m_top_resolution.y();
+	std::vector<uint64_t> slice_bits(n_slice * SPARSE_OCCUPANCY_BRICK_WORDS);
+	std::vector<uint32_t> slice_counts(n_slice);
+
+	// Whether a brick is free in `coarse` without looking up every cell. If the centers at the corners of the brick
+	// lie in cells of one cascade that are at least as large as the brick, all other centers lie in the cells of the
+	// corners, or in cells of finer cascades that are max-pooled into them.
+	auto coarse_free = [&](const Vector3i& brick_cell) {
+		Vector3f first = m_domain_min + (brick_cell.cast<float>() + Vector3f::Constant(0.5f)) * m_cell_size;
+		Vector3f last = first + Vector3f::Constant((BRICK_SIZE - 1) * m_cell_size);
+
+		uint32_t cascade = OccupancyGrid::cascade_at(first);
+		if (std::scalbnf(1.0f, cascade) / OccupancyGrid::GRIDSIZE < BRICK_SIZE * m_cell_size) {
+			return false;
+		}
+
+		for (uint32_t i = 0; i < 8; ++i) {
+			Vector3f corner = {(i & 1) ? last.x() : first.x(), (i & 2) ? last.y() : first.y(), (i & 4) ? last.z() : first.z()};
+			if (OccupancyGrid::cascade_at(corner) != cascade || coarse.occupied_at(corner)) {
+				return false;
+			}
+		}
+
+		return true;
+	};
+
+	auto build_row = [&](uint32_t z, uint32_t y) {
+		std::vector<Vector3f> positions;
+		std::vector<uint32_t> bits;
+		std::vector<uint8_t> occupied;
+		positions.reserve(BRICK_CELLS);
+		bits.reserve(BRICK_CELLS);
+		occupied.reserve(BRICK_CELLS);
+
+		for (uint32_t x = 0; x < (uint32_t)m_top_resolution.x(); ++x) {
+			positions.clear();
+			bits.clear();
+
+			const uint32_t idx = x + y * m_top_resolution.x();
+			uint64_t* words = slice_bits.data() + idx * SPARSE_OCCUPANCY_BRICK_WORDS;
+			std::fill_n(words, SPARSE_OCCUPANCY_BRICK_WORDS, 0);
+			slice_counts[idx] = 0;
+
+			const Vector3i brick_cell = Vector3i{(int)x, (int)y, (int)z} * BRICK_SIZE;
+			if (coarse_free(brick_cell)) {
+				continue;
+			}
+
+			for (uint32_t i = 0; i < BRICK_CELLS; ++i) {
+				Vector3i cell = brick_cell + Vector3i{(int)(i % BRICK_SIZE), (int)((i / BRICK_SIZE) % BRICK_SIZE), (int)(i / (BRICK_SIZE * BRICK_SIZE))};
+				Vector3f center = m_domain_min + (cell.cast<float>() + Vector3f::Constant(0.5f)) * m_cell_size;
+				if (coarse.occupied_at(center)) {
+					positions.emplace_back(center);
+					bits.emplace_back(i);
+				}
+			}
+
+			occupied.assign(positions.size(), 1);
+			if (fun && !positions.empty()) {
+				fun((uint32_t)positions.size(), positions.data(), occupied.data());
+			}
+
+			uint32_t count = 0;
+			for (size_t j = 0; j < bits.size(); ++j) {
+				if (occupied[j]) {
+					words[bits[j] / 64] |= 1ull << (bits[j] % 64);
+					++count;
+				}
+			}
+			slice_counts[idx] = count;
+		}
+	};
+
+	for (uint32_t z = 0; z < (uint32_t)m_top_resolution.z(); ++z) {
+		if (pool) {
+			pool->parallelFor<uint32_t>(0, m_top_resolution.y(), [&](uint32_t y) { build_row(z, y); });
+		} else {
+			for (uint32_t y = 0; y < (uint32_t)m_top_resolution.y(); ++y) {
+				build_row(z, y);
+			}
+		}
+
+		for (uint32_t idx = 0; idx < n_slice; ++idx) {
+			uint32_t& entry = m_top[z * n_slice + idx];
+			m_n_occupied_cells += slice_counts[idx];
+
+			if (slice_counts[idx] == 0) {
+				entry = SPARSE_OCCUPANCY_EMPTY_BRICK;
+			} else if (slice_counts[idx] == BRICK_CELLS) {
+				entry = SPARSE_OCCUPANCY_FULL_BRICK;
+				++m_n_full_bricks;
+			} else {
+				entry = (uint32_t)n_bricks();
+				const uint64_t* words = slice_bits.data() + idx * SPARSE_OCCUPANCY_BRICK_WORDS;
+				m_bricks.insert(m_bricks.end(), words, words + SPARSE_OCCUPANCY_BRICK_WORDS);
+			}
+		}
+	}
+}
+
+void SparseOccupancyGrid::build(
+	const OccupancyGrid& coarse,
+	const CpuNerfNetwork& network,
+	const AlignedBox3f& aabb,
+	float min_optical_thickness,
+	ENerfActivation density_activation,
+	ThreadPool* pool
+) {
+	build(coarse, [&](uint32_t n, const Vector3f* positions, uint8_t* occupied) {
+		std::vector<float> warped(n * 3);
+		std::vector<float> density(n);
+		for (uint32_t i = 0; i < n; ++i) {
+			Vector3f pos = (positions[i] - aabb.min()).cwiseQuotient(aabb.diagonal());
+			warped[i*3+0] = pos.x();
+			warped[i*3+1] = pos.y();
+			warped[i*3+2] = pos.z();
+		}
+
+		network.density(n, warped.data(), 3, density.data());
+
+		for (uint32_t i = 0; i < n; ++i) {
+			occupied[i] = network_to_density(density[i], density_activation) * MIN_CONE_STEPSIZE > min_optical_thickness;
+		}
+	}, pool);
+}
+
+OccupancyTraversalBenchmark benchmark_occupancy_traversal(const OccupancyGrid& dense, const SparseOccupancyGrid& sparse, uint32_t n_rays, uint32_t seed) {
+	OccupancyTraversalBenchmark result;
+	result.n_rays = n_rays;
+	result.memory_bytes_dense_bitfield = dense.bitfield().size();
+	result.memory_bytes_dense_density_grid = dense.density_grid().size() * sizeof(float);
+	result.memory_bytes_sparse = sparse.memory_bytes();
+
+	if (n_rays == 0) {
+		return result;
+	}
+
+	const AlignedBox3f domain = sparse.domain();
+	const float diag = domain.diagonal().norm();
+
+	struct Ray {
+		Vector3f origin;
+		Vector3f dir;
+		float t_min, t_max;
+	};
+
+	std::vector<Ray> rays(n_rays);
+	uint64_t state = seed;
+	for (auto& ray : rays) {
+		Vector3f target = domain.min() + Vector3f{random_float(state), random_float(state), random_float(state)}.cwiseProduct(domain.diagonal());
+
+		float cos_theta = 2.0f * random_float(state) - 1.0f;
+		float sin_theta = std::sqrt(std::max(1.0f - cos_theta * cos_theta, 0.0f));
+		float phi = 6.28318530718f * random_float(state);
+		ray.dir = {sin_theta * std::cos(phi), sin_theta * std::sin(phi), cos_theta};
+		ray.origin = target - ray.dir * diag;
+
+		std::tie(ray.t_min, ray.t_max) = ray_intersect(domain, ray.origin, ray.dir);
+	}
+
+	using namespace std::chrono;
+
+	// Dense cascades: the cell that a position is in is the one of the finest cascade containing it
+	uint64_t n_steps = 0, n_occupied = 0;
+	auto start = steady_clock::now();
+	for (const auto& ray : rays) {
+		float t = ray.t_min;
+		while (t < ray.t_max) {
+			Vector3f pos = ray.origin + ray.dir * t;
+			++n_steps;
+			if (dense.occupied_at(pos)) {
+				++n_occupied;
+			}
+
+			float cell_size = std::scalbnf(1.0f, OccupancyGrid::cascade_at(pos)) / OccupancyGrid::GRIDSIZE;
+			t += distance_to_cell_exit(pos, ray.dir, cell_size) + 1e-3f * cell_size;
+		}
+	}
+	result.ns_per_ray_dense = duration<double, std::nano>(steady_clock::now() - start).count() / n_rays;
+	result.steps_per_ray_dense = (double)n_steps / n_rays;
+	result.occupied_per_ray_dense = (double)n_occupied / n_rays;
+
+	const SparseOccupancyGridView view = sparse.view();
+	n_steps = 0;
+	n_occupied = 0;
+	start = steady_clock::now();
+	for (const auto& ray : rays) {
+		uint32_t steps = 0;
+		float t = ray.t_min;
+		while ((t = view.next_occupied(ray.origin, ray.dir, t, ray.t_max, &steps)) < ray.t_max) {
+			++n_occupied;
+			t += view.distance_to_next_cell(ray.origin, ray.dir, t);
+		}
+		n_steps += steps;
+	}
+	result.ns_per_ray_sparse = duration<double, std::nano>(steady_clock::now() - start).count() / n_rays;
+	result.steps_per_ray_sparse = (double)n_steps / n_rays;
+	result.occupied_per_ray_sparse = (double)n_occupied / n_rays;
+
+	return result;
+}
+
+NGP_NAMESPACE_END
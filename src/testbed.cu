@@ -305,7 +305,7 @@ void Testbed::imgui() {
 		if (path_filename_buf[0] == '\0') {
 			snprintf(path_filename_buf, sizeof(path_filename_buf), "%s", get_filename_in_data_path_with_suffix(m_data_path, m_network_config_path, "_cam.json").c_str());
 		}
-		if (m_camera_path.imgui(path_filename_buf, m_frame_milliseconds, m_camera, m_slice_plane_z, m_scale, fov(), m_dof, m_bounding_radius,
+		if (m_camera_path.imgui(path_filename_buf, m_frame_milliseconds, m_camera, m_slice_plane_z, m_scale, fov(), m_dof, m_zoom, m_bounding_radius,
 					!m_nerf.training.dataset.xforms.empty() ? m_nerf.training.dataset.xforms[0] : Matrix<float, 3, 4>::Identity())) {
 			if (m_camera_path.m_update_cam_from_path) {
 				set_camera_from_time(m_camera_path.m_playtime);
@@ -387,6 +387,7 @@ void Testbed::imgui() {
 				ImGui::Combo("RGB activation", (int*)&m_nerf.rgb_activation, NerfActivationStr);
 				ImGui::Combo("Density activation", (int*)&m_nerf.density_activation, NerfActivationStr);
 				ImGui::SliderFloat("Cone angle", &m_nerf.cone_angle_constant, 0.0f, 1.0f/128.0f);
+				ImGui::Checkbox("Skip empty space", &m_nerf.skip_empty_space);
 
 				// Importance sampling options, but still related to training
 				ImGui::Checkbox("Sample focal plane ~error", &m_nerf.training.sample_focal_plane_proportional_to_error);
@@ -491,7 +492,7 @@ void Testbed::imgui() {
 				if (m_nerf.training.optimize_exposure) {
 					std::vector<float> exposures(m_nerf.training.n_images);
 					for (uint32_t i = 0; i < m_nerf.training.n_images; ++i) {
-						exposures[i] = m_nerf.training.cam_exposure[i].variable().x();
+						exposures[i] = m_nerf.training.cam_exposure.variables(0)[i];
 					}
 
 					ImGui::PlotLines("Training view exposures", exposures.data(), exposures.size(), 0, nullptr, FLT_MAX, FLT_MAX, ImVec2(0, 60.f));
@@ -1222,7 +1223,7 @@ void Testbed::draw_contents() {
 			if (m_pip_render_surface->spp() < 8) {
 				// a bit gross, but let's copy the keyframe's state into the global state in order to not have to plumb through the fov etc to render_frame.
 				CameraKeyframe backup = copy_camera_to_keyframe();
-				CameraKeyframe pip_kf = m_camera_path.eval_camera_path(m_camera_path.m_playtime);
+				CameraKeyframe pip_kf = m_camera_path.eval(m_camera_path.m_playtime);
 				set_camera_from_keyframe(pip_kf);
 				render_frame(pip_kf.m(), pip_kf.m(), *m_pip_render_surface);
 				set_camera_from_keyframe(backup);
@@ -1419,7 +1420,7 @@ void Testbed::apply_camera_smoothing(float elapsed_ms) {
 }
 
 CameraKeyframe Testbed::copy_camera_to_keyframe() const {
-	return CameraKeyframe(m_camera, m_slice_plane_z, m_scale, fov(), m_dof );
+	return CameraKeyframe(m_camera, m_slice_plane_z, m_scale, fov(), m_dof, m_zoom);
 }
 
 void Testbed::set_camera_from_keyframe(const CameraKeyframe& k) {
@@ -1428,12 +1429,69 @@ void Testbed::set_camera_from_keyframe(const CameraKeyframe& k) {
 	m_scale = k.scale;
 	set_fov(k.fov);
 	m_dof = k.dof;
+	m_zoom = k.ortho_scale;
 }
 
 void Testbed::set_camera_from_time(float t) {
 	if (m_camera_path.m_keyframes.empty())
 		return;
-	set_camera_from_keyframe(m_camera_path.eval_camera_path(t));
+	set_camera_from_keyframe(m_camera_path.eval(t));
+}
+
+void Testbed::render_camera_path_frame(CudaRenderBuffer& render_buffer, int spp, bool to_srgb, float start_time, float end_time, float fps, float shutter_fraction) {
+	if (end_time < 0.f) {
+		end_time = start_time;
+	}
+
+	// Evaluate the camera path for the end of the frame and all samples at once
+	std::vector<CameraKeyframe> keyframes;
+	if (start_time >= 0.f && !m_camera_path.m_keyframes.empty()) {
+		std::vector<float> times(spp + 1);
+		times[0] = end_time;
+		for (int i = 0; i < spp; ++i) {
+			float start_alpha = ((float)i)/(float)spp * shutter_fraction;
+			float end_alpha = ((float)i + 1.0f)/(float)spp * shutter_fraction;
+			times[i+1] = start_time + (end_time-start_time) * (start_alpha + end_alpha) / 2.0f;
+		}
+		keyframes = m_camera_path.eval_batch(times);
+	}
+
+	auto start_cam_matrix = m_smoothed_camera;
+
+	if (start_time >= 0.f) {
+		if (!keyframes.empty()) {
+			set_camera_from_keyframe(keyframes[0]);
+		}
+		apply_camera_smoothing(1000.f / fps);
+	} else {
+		start_cam_matrix = m_smoothed_camera = m_camera;
+	}
+
+	auto end_cam_matrix = m_smoothed_camera;
+
+	for (int i = 0; i < spp; ++i) {
+		float start_alpha = ((float)i)/(float)spp * shutter_fraction;
+		float end_alpha = ((float)i + 1.0f)/(float)spp * shutter_fraction;
+
+		auto sample_start_cam_matrix = log_space_lerp(start_cam_matrix, end_cam_matrix, start_alpha);
+		auto sample_end_cam_matrix = log_space_lerp(start_cam_matrix, end_cam_matrix, end_alpha);
+
+		if (start_time >= 0.f) {
+			if (!keyframes.empty()) {
+				set_camera_from_keyframe(keyframes[i+1]);
+			}
+			m_smoothed_camera = m_camera;
+		}
+
+		if (m_autofocus) {
+			autofocus();
+		}
+
+		render_frame(sample_start_cam_matrix, sample_end_cam_matrix, render_buffer, to_srgb);
+	}
+
+	// For cam smoothing when rendering the next frame.
+	m_smoothed_camera = end_cam_matrix;
 }
 
 void Testbed::update_loss_graph() {
@@ -1541,12 +1599,14 @@ void Testbed::reset_network() {
 	reset_accumulation();
 	m_nerf.training.rays_per_batch = 1 << 12;
 	m_nerf.training.measured_batch_size_before_compaction = 0;
+	m_nerf.training.batch_size_controller.reset();
+	m_nerf.training.deferred_stats.clear();
 
 	m_nerf.training.n_steps_since_cam_update = 0;
 	m_nerf.training.n_steps_since_error_map_update = 0;
 	m_nerf.training.n_rays_since_error_map_update = 0;
 	m_nerf.training.n_steps_between_error_map_updates = 128;
-	m_nerf.training.error_map.is_cdf_valid = false;
+	m_nerf.training.error_map.is_alias_valid = false;
 
 	m_loss_graph_samples = 0;
 
@@ -1628,9 +1688,9 @@ void Testbed::reset_network() {
 
 	size_t n_encoding_params = 0;
 	if (m_testbed_mode == ETestbedMode::Nerf) {
-		m_nerf.training.cam_exposure.resize(m_nerf.training.n_images, AdamOptimizer<Array3f>(1e-3f));
-		m_nerf.training.cam_pos_offset.resize(m_nerf.training.n_images, AdamOptimizer<Vector3f>(1e-4f));
-		m_nerf.training.cam_rot_offset.resize(m_nerf.training.n_images, RotationAdamOptimizer(1e-4f));
+		m_nerf.training.cam_exposure.resize(m_nerf.training.n_images);
+		m_nerf.training.cam_pos_offset.resize(m_nerf.training.n_images);
+		m_nerf.training.cam_rot_offset.resize(m_nerf.training.n_images);
 		m_nerf.training.cam_focal_length_offset = AdamOptimizer<Vector2f>(1e-4f);
 
 		json& dir_encoding_config = config["dir_encoding"];
@@ -1825,7 +1885,10 @@ void Testbed::train(uint32_t n_training_steps, uint32_t batch_size) {
 			default: throw std::runtime_error{"Invalid training mode."};
 		}
 
-		CUDA_CHECK_THROW(cudaStreamSynchronize(m_training_stream));
+		// Deferred statistics let the host run ahead of the GPU. The timing then only covers enqueueing the work.
+		if (!defers_training_stats()) {
+			CUDA_CHECK_THROW(cudaStreamSynchronize(m_training_stream));
+		}
 	}
 
 	// Find leaf optimizer and update its settings
@@ -1851,7 +1914,10 @@ void Testbed::train(uint32_t n_training_steps, uint32_t batch_size) {
 			default: throw std::runtime_error{"Invalid training mode."};
 		}
 
-		CUDA_CHECK_THROW(cudaStreamSynchronize(m_training_stream));
+		// Deferred statistics let the host run ahead of the GPU. The timing then only covers enqueueing the work.
+		if (!defers_training_stats()) {
+			CUDA_CHECK_THROW(cudaStreamSynchronize(m_training_stream));
+		}
 	}
 }
 
@@ -1955,7 +2021,7 @@ void Testbed::render_frame(const Matrix<float, 3, 4>& camera_matrix0, const Matr
 			float alpha=1.f;
 			render_buffer.overlay_image(
 				alpha,
-				Array3f::Constant(m_exposure) + m_nerf.training.cam_exposure[m_nerf.training.view].variable(),
+				Array3f::Constant(m_exposure) + m_nerf.training.cam_exposure.variable<Array3f>(m_nerf.training.view),
 				m_background_color,
 				to_srgb ? EColorSpace::SRGB : EColorSpace::Linear,
 				m_nerf.training.dataset.images_data.data() + m_nerf.training.view * (size_t)m_nerf.training.dataset.image_resolution.prod() * 4,
@@ -2147,11 +2213,21 @@ void Testbed::load_snapshot(const std::string& filepath_string) {
 		throw std::runtime_error{std::string{"File '"} + filepath_string + "' does not contain a snapshot."};
 	}
 
+	load_snapshot(config);
 	m_network_config_path = filepath_string;
+}
+
+void Testbed::load_snapshot(const nlohmann::json& config) {
+	if (!config.contains("snapshot")) {
+		throw std::runtime_error{"Network config does not contain a snapshot."};
+	}
+
 	m_network_config = config;
 
 	if (m_testbed_mode == ETestbedMode::Nerf) {
 		m_nerf.training.rays_per_batch = m_network_config["snapshot"]["nerf"]["rays_per_batch"];
+		m_nerf.training.batch_size_controller.reset();
+		m_nerf.training.deferred_stats.clear();
 		m_nerf.training.measured_batch_size = m_network_config["snapshot"]["nerf"]["measured_batch_size"];
 		m_nerf.training.measured_batch_size_before_compaction = m_network_config["snapshot"]["nerf"]["measured_batch_size_before_compaction"];
 
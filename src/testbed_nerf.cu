@@ -13,12 +13,14 @@
  */
 
 #include <neural-graphics-primitives/adam_optimizer.h>
+#include <neural-graphics-primitives/alias_table.h>
 #include <neural-graphics-primitives/common.h>
 #include <neural-graphics-primitives/common_device.cuh>
 #include <neural-graphics-primitives/envmap.cuh>
 #include <neural-graphics-primitives/nerf_loader.h>
 #include <neural-graphics-primitives/nerf_network.h>
 #include <neural-graphics-primitives/marching_cubes.h>
+#include <neural-graphics-primitives/occupancy_distance_field.h>
 #include <neural-graphics-primitives/render_buffer.h>
 #include <neural-graphics-primitives/testbed.h>
 #include <neural-graphics-primitives/trainable_buffer.cuh>
@@ -184,20 +186,6 @@ inline __device__ float distance_to_next_voxel(const Vector3f& pos, const Vector
 	return fmaxf(t / res, 0.0f);
 }
 
-inline __device__ float advance_to_next_voxel(float t, float cone_angle, const Vector3f& pos, const Vector3f& dir, const Vector3f& idir, uint32_t res) {
-	// Analytic stepping by a multiple of dt. Make empty space unequal to non-empty space
-	// due to the different stepping.
-	// float dt = calc_dt(t, cone_angle);
-	// return t + ceilf(fmaxf(distance_to_next_voxel(pos, dir, idir, res) / dt, 0.5f)) * dt;
-
-	// Regular stepping (may be slower but matches non-empty space)
-	float t_target = t + distance_to_next_voxel(pos, dir, idir, res);
-	do {
-		t += calc_dt(t, cone_angle);
-	} while (t < t_target);
-	return t;
-}
-
 __device__ float network_to_rgb(float val, ENerfActivation activation) {
 	switch (activation) {
 		case ENerfActivation::None: return val;
@@ -434,6 +422,35 @@ inline __device__ int mip_from_dt(float dt, const Vector3f& pos) {
 	return min(NERF_CASCADES()-1, max(exponent, mip));
 }
 
+inline __device__ float advance_to_next_voxel(float t, float cone_angle, const Vector3f& pos, const Vector3f& dir, const Vector3f& idir, uint32_t mip, uint32_t min_mip, const uint8_t* __restrict__ distance_field) {
+	uint32_t res = NERF_GRIDSIZE()>>mip;
+
+	// Analytic stepping by a multiple of dt. Make empty space unequal to non-empty space
+	// due to the different stepping.
+	// float dt = calc_dt(t, cone_angle);
+	// return t + ceilf(fmaxf(distance_to_next_voxel(pos, dir, idir, res) / dt, 0.5f)) * dt;
+
+	// Regular stepping (may be slower but matches non-empty space)
+	float t_target = t + distance_to_next_voxel(pos, dir, idir, res);
+
+	// Skip the whole block of free cells around pos, unless the ray switches to a coarser cascade
+	// within it, which may be occupied there. Either way, the same samples are taken.
+	if (distance_field) {
+		uint32_t distance = occupancy_distance_at(pos, distance_field, mip);
+		if (distance > 1) {
+			float t_block = t + distance_to_free_block_exit(pos, dir, idir, res, distance);
+			if (max(min_mip, mip_from_dt(calc_dt(t_block, cone_angle), pos)) == mip) {
+				t_target = fmaxf(t_target, t_block);
+			}
+		}
+	}
+
+	do {
+		t += calc_dt(t, cone_angle);
+	} while (t < t_target);
+	return t;
+}
+
 
 __global__ void generate_grid_samples_nerf_nonuniform(const uint32_t n_elements, default_rng_t rng, const uint32_t step, BoundingBox aabb, const float* __restrict__ grid_in, NerfPosition* __restrict__ out, uint32_t* __restrict__ indices, uint32_t n_cascades, float thresh) {
 	const uint32_t i = threadIdx.x + blockIdx.x * blockDim.x;
@@ -576,6 +593,94 @@ __global__ void bitfield_max_pool(const uint32_t n_elements,
 	next_level[tcnn::morton3D(x, y, z)] |= bits;
 }
 
+__global__ void mark_dirty_distance_slices(const uint32_t n_elements,
+	const uint8_t* __restrict__ grid_bitfield,
+	const uint8_t* __restrict__ prev_grid_bitfield,
+	uint8_t* __restrict__ dirty_slices
+) {
+	const uint32_t i = threadIdx.x + blockIdx.x * blockDim.x;
+	if (i >= n_elements) return;
+
+	uint8_t diff = grid_bitfield[i] ^ prev_grid_bitfield[i];
+	if (!diff) return;
+
+	const uint32_t n_bytes_per_cascade = NERF_GRIDSIZE() * NERF_GRIDSIZE() * NERF_GRIDSIZE() / 8;
+	uint32_t cascade = i / n_bytes_per_cascade;
+	uint32_t idx = (i % n_bytes_per_cascade) * 8;
+
+	#pragma unroll
+	for (uint8_t j = 0; j < 8; ++j) {
+		if (diff & ((uint8_t)1 << j)) {
+			dirty_slices[cascade * NERF_GRIDSIZE() + tcnn::morton3D_invert((idx + j)>>2)] = 1;
+		}
+	}
+}
+
+__global__ void occupancy_distance_rows(const uint32_t n_elements,
+	const uint8_t* __restrict__ grid_bitfield,
+	const uint8_t* __restrict__ dirty_slices,
+	uint8_t* __restrict__ distance
+) {
+	const uint32_t i = threadIdx.x + blockIdx.x * blockDim.x;
+	if (i >= n_elements) return;
+
+	uint32_t slice = i / NERF_GRIDSIZE();
+	if (!dirty_slices[slice]) return;
+
+	uint32_t cascade = slice / NERF_GRIDSIZE();
+	uint32_t z = slice % NERF_GRIDSIZE();
+	uint32_t y = i % NERF_GRIDSIZE();
+
+	uint64_t bits[NERF_GRIDSIZE()/64] = {};
+	for (uint32_t x = 0; x < NERF_GRIDSIZE(); ++x) {
+		uint32_t idx = tcnn::morton3D(x, y, z);
+		if (grid_bitfield[idx/8+grid_mip_offset(cascade)/8] & (1<<(idx%8))) {
+			bits[x/64] |= 1ull << (x%64);
+		}
+	}
+
+	occupancy_distance_row(bits, distance + occupancy_distance_idx(cascade, 0, y, z));
+}
+
+__global__ void occupancy_distance_combine_y(const uint32_t n_elements,
+	const uint8_t* __restrict__ dirty_slices,
+	const uint8_t* __restrict__ distance,
+	uint8_t* __restrict__ distance_xy
+) {
+	const uint32_t i = threadIdx.x + blockIdx.x * blockDim.x;
+	if (i >= n_elements) return;
+
+	uint32_t slice = i / (NERF_GRIDSIZE() * NERF_GRIDSIZE());
+	if (!dirty_slices[slice]) return;
+
+	uint32_t x = i % NERF_GRIDSIZE();
+	uint32_t y = (i / NERF_GRIDSIZE()) % NERF_GRIDSIZE();
+	distance_xy[i] = occupancy_distance_combine(distance + slice * NERF_GRIDSIZE() * NERF_GRIDSIZE() + x, NERF_GRIDSIZE(), y);
+}
+
+__global__ void occupancy_distance_combine_z(const uint32_t n_elements,
+	const uint8_t* __restrict__ dirty_slices,
+	const uint8_t* __restrict__ distance_xy,
+	uint8_t* __restrict__ distance
+) {
+	const uint32_t i = threadIdx.x + blockIdx.x * blockDim.x;
+	if (i >= n_elements) return;
+
+	uint32_t slice = i / (NERF_GRIDSIZE() * NERF_GRIDSIZE());
+	uint32_t cascade = slice / NERF_GRIDSIZE();
+	int z = slice % NERF_GRIDSIZE();
+
+	// Slices further away than the maximum distance cannot have changed this cell's distance
+	bool dirty = false;
+	for (int j = max(z - (int)OCCUPANCY_DISTANCE_MAX + 1, 0); j <= min(z + (int)OCCUPANCY_DISTANCE_MAX - 1, (int)NERF_GRIDSIZE() - 1); ++j) {
+		dirty |= dirty_slices[cascade * NERF_GRIDSIZE() + j] != 0;
+	}
+	if (!dirty) return;
+
+	uint32_t xy = i % (NERF_GRIDSIZE() * NERF_GRIDSIZE());
+	distance[i] = occupancy_distance_combine(distance_xy + grid_mip_offset(cascade) + xy, NERF_GRIDSIZE() * NERF_GRIDSIZE(), z);
+}
+
 
 __global__ void advance_pos_nerf(
 	const uint32_t n_elements,
@@ -585,6 +690,7 @@ __global__ void advance_pos_nerf(
 	uint32_t spp,
 	NerfPayload* __restrict__ payloads,
 	const uint8_t* __restrict__ density_grid,
+	const uint8_t* __restrict__ density_grid_distance,
 	uint32_t min_mip,
 	float cone_angle_constant
 ) {
@@ -621,8 +727,7 @@ __global__ void advance_pos_nerf(
 			break;
 		}
 
-		uint32_t res = NERF_GRIDSIZE()>>mip;
-		t = advance_to_next_voxel(t, cone_angle, pos, dir, idir, res);
+		t = advance_to_next_voxel(t, cone_angle, pos, dir, idir, mip, min_mip, density_grid_distance);
 	}
 
 	payload.t = t;
@@ -667,6 +772,7 @@ __global__ void generate_next_nerf_network_inputs(
 	NerfCoordinate* __restrict__ network_input,
 	uint32_t n_steps,
 	const uint8_t* __restrict__ density_grid,
+	const uint8_t* __restrict__ density_grid_distance,
 	uint32_t min_mip,
 	float cone_angle_constant
 ) {
@@ -703,8 +809,7 @@ __global__ void generate_next_nerf_network_inputs(
 				break;
 			}
 
-			uint32_t res = NERF_GRIDSIZE()>>mip;
-			t = advance_to_next_voxel(t, cone_angle, pos, dir, idir, res);
+			t = advance_to_next_voxel(t, cone_angle, pos, dir, idir, mip, min_mip, density_grid_distance);
 		}
 
 		network_input[i*n_steps + j] = { warp_position(pos, train_aabb), warp_direction(dir), warp_dt(dt) }; // XXXCONE
@@ -823,7 +928,7 @@ __global__ void composite_kernel_nerf(
 
 static constexpr float UNIFORM_SAMPLING_FRACTION = 0.5f;
 
-inline __device__ Vector2f sample_cdf_2d(Vector2f sample, uint32_t img, const Vector2i& res, const float* __restrict__ cdf_x_cond_y, const float* __restrict__ cdf_y, float* __restrict__ pdf) {
+inline __device__ Vector2f sample_error_map_2d(Vector2f sample, uint32_t img, const Vector2i& res, const AliasEntry* __restrict__ alias_x_cond_y, const AliasEntry* __restrict__ alias_y, float* __restrict__ pdf) {
 	if (sample.x() < UNIFORM_SAMPLING_FRACTION) {
 		sample.x() /= UNIFORM_SAMPLING_FRACTION;
 		return sample;
@@ -831,57 +936,28 @@ inline __device__ Vector2f sample_cdf_2d(Vector2f sample, uint32_t img, const Ve
 
 	sample.x() = (sample.x() - UNIFORM_SAMPLING_FRACTION) / (1.0f - UNIFORM_SAMPLING_FRACTION);
 
-	cdf_y += img * res.y();
+	alias_y += img * res.y();
 
-	// First select row according to cdf_y
-	uint32_t y = binary_search(sample.y(), cdf_y, res.y());
-	float prev = y > 0 ? cdf_y[y-1] : 0.0f;
-	float pmf_y = cdf_y[y] - prev;
-	sample.y() = (sample.y() - prev) / pmf_y;
+	// First select row according to alias_y. The samples are rescaled to [0,1) and reused for the position within the cell.
+	uint32_t y = sample_alias_table(alias_y, res.y(), sample.y());
 
-	cdf_x_cond_y += img * res.y() * res.x() + y * res.x();
+	alias_x_cond_y += img * res.y() * res.x() + y * res.x();
 
 	// Then, select col according to x
-	uint32_t x = binary_search(sample.x(), cdf_x_cond_y, res.x());
-	prev = x > 0 ? cdf_x_cond_y[x-1] : 0.0f;
-	float pmf_x = cdf_x_cond_y[x] - prev;
-	sample.x() = (sample.x() - prev) / pmf_x;
+	uint32_t x = sample_alias_table(alias_x_cond_y, res.x(), sample.x());
 
 	if (pdf) {
-		*pdf = pmf_x * pmf_y * res.prod();
+		*pdf = alias_x_cond_y[x].pmf * alias_y[y].pmf * res.prod();
 	}
 
 	return {((float)x + sample.x()) / (float)res.x(), ((float)y + sample.y()) / (float)res.y()};
 }
 
-inline __device__ float pdf_2d(Vector2f sample, uint32_t img, const Vector2i& res, const float* __restrict__ cdf_x_cond_y, const float* __restrict__ cdf_y) {
-	Vector2i p = (sample.cwiseProduct(res.cast<float>())).cast<int>().cwiseMax(0).cwiseMin(res - Vector2i::Ones());
-
-	cdf_y += img * res.y();
-	cdf_x_cond_y += img * res.y() * res.x() + p.y() * res.x();
-
-	float pmf_y = cdf_y[p.y()];
-	if (p.y() > 0) {
-		pmf_y -= cdf_y[p.y()-1];
-	}
-
-	float pmf_x = cdf_x_cond_y[p.x()];
-	if (p.x() > 0) {
-		pmf_x -= cdf_x_cond_y[p.x()-1];
-	}
-
-	// Probability mass of picking the pixel
-	float pmf = pmf_x * pmf_y;
-
-	// To convert to probability density, divide by area of pixel
-	return UNIFORM_SAMPLING_FRACTION + pmf * res.prod() * (1.0f - UNIFORM_SAMPLING_FRACTION);
-}
-
-inline __device__ Vector2f nerf_random_image_pos_training(default_rng_t& rng, const Vector2i& resolution, bool snap_to_pixel_centers, const float* __restrict__ cdf_x_cond_y, const float* __restrict__ cdf_y, const Vector2i& cdf_res, uint32_t img, float* __restrict__ pdf = nullptr) {
+inline __device__ Vector2f nerf_random_image_pos_training(default_rng_t& rng, const Vector2i& resolution, bool snap_to_pixel_centers, const AliasEntry* __restrict__ alias_x_cond_y, const AliasEntry* __restrict__ alias_y, const Vector2i& alias_res, uint32_t img, float* __restrict__ pdf = nullptr) {
 	Vector2f xy = random_val_2d(rng);
 
-	if (cdf_x_cond_y) {
-		xy = sample_cdf_2d(xy, img, cdf_res, cdf_x_cond_y, cdf_y, pdf);
+	if (alias_x_cond_y) {
+		xy = sample_error_map_2d(xy, img, alias_res, alias_x_cond_y, alias_y, pdf);
 	} else if (pdf) {
 		*pdf = 1.0f;
 	}
@@ -892,15 +968,14 @@ inline __device__ Vector2f nerf_random_image_pos_training(default_rng_t& rng, co
 	return xy;
 }
 
-inline __device__ uint32_t image_idx(uint32_t base_idx, uint32_t n_rays, uint32_t n_rays_total, uint32_t n_training_images, const float* __restrict__ cdf = nullptr, float* __restrict__ pdf = nullptr) {
-	if (cdf) {
+inline __device__ uint32_t image_idx(uint32_t base_idx, uint32_t n_rays, uint32_t n_rays_total, uint32_t n_training_images, const AliasEntry* __restrict__ alias = nullptr, float* __restrict__ pdf = nullptr) {
+	if (alias) {
 		float sample = ld_random_val(base_idx + n_rays_total, 0xdeadbeef);
 		// float sample = random_val(base_idx + n_rays_total);
-		uint32_t img = binary_search(sample, cdf, n_training_images);
+		uint32_t img = sample_alias_table(alias, n_training_images, sample);
 
 		if (pdf) {
-			float prev = img > 0 ? cdf[img-1] : 0.0f;
-			*pdf = (cdf[img] - prev) * n_training_images;
+			*pdf = alias[img].pmf * n_training_images;
 		}
 
 		return img;
@@ -945,8 +1020,9 @@ __global__ void generate_training_samples_nerf(
 	Vector2f principal_point,
 	const Vector2f* __restrict__ focal_lengths,
 	const Matrix<float, 3, 4>* training_xforms,
-	CameraDistortion camera_distortion,
+	CameraUndistortion camera_undistortion,
 	const uint8_t* __restrict__ density_grid,
+	const uint8_t* __restrict__ density_grid_distance,
 	bool max_level_rand_training,
 	float* __restrict__ max_level_ptr,
 	bool snap_to_pixel_centers,
@@ -954,20 +1030,20 @@ __global__ void generate_training_samples_nerf(
 	float cone_angle_constant,
 	const float* __restrict__ distortion_data,
 	const Vector2i distortion_resolution,
-	const float* __restrict__ cdf_x_cond_y,
-	const float* __restrict__ cdf_y,
-	const float* __restrict__ cdf_img,
-	const Vector2i cdf_res,
+	const AliasEntry* __restrict__ alias_x_cond_y,
+	const AliasEntry* __restrict__ alias_y,
+	const AliasEntry* __restrict__ alias_img,
+	const Vector2i alias_res,
 	float near_distance,
 	const __half* __restrict__ training_images
 ) {
 	const uint32_t i = threadIdx.x + blockIdx.x * blockDim.x;
 	if (i >= n_rays) return;
 
-	uint32_t img = image_idx(i, n_rays, n_rays_total, n_training_images, cdf_img);
+	uint32_t img = image_idx(i, n_rays, n_rays_total, n_training_images, alias_img);
 
 	rng.advance(i * N_MAX_RANDOM_SAMPLES_PER_RAY());
-	Vector2f xy = nerf_random_image_pos_training(rng, resolution, snap_to_pixel_centers, cdf_x_cond_y, cdf_y, cdf_res, img);
+	Vector2f xy = nerf_random_image_pos_training(rng, resolution, snap_to_pixel_centers, alias_x_cond_y, alias_y, alias_res, img);
 
 	// Negative values indicate masked-away regions
 	if ((float)training_images[pixel_idx(xy, resolution, img)*4] < 0.0f) {
@@ -992,8 +1068,8 @@ __global__ void generate_training_samples_nerf(
 			(xy.y()-principal_point.y())*resolution.y() / focal_length.y(),
 			1.0f,
 		};
-		if (!camera_distortion.is_zero()) {
-			iterative_camera_undistortion((float*)&camera_distortion, &ray.d.x(), &ray.d.y());
+		if (!camera_undistortion.is_zero()) {
+			camera_undistortion.undistort(&ray.d.x(), &ray.d.y());
 		}
 		if (distortion_data) {
 			ray.d.head<2>() += read_image<2>(distortion_data, distortion_resolution, xy);
@@ -1024,8 +1100,7 @@ __global__ void generate_training_samples_nerf(
 			++j;
 			t += dt;
 		} else {
-			uint32_t res = NERF_GRIDSIZE()>>mip;
-			t = advance_to_next_voxel(t, cone_angle, pos, ray.d, idir, res);
+			t = advance_to_next_voxel(t, cone_angle, pos, ray.d, idir, mip, 0, density_grid_distance);
 		}
 	}
 	if (j == 0 && !train_envmap) {
@@ -1057,8 +1132,7 @@ __global__ void generate_training_samples_nerf(
 			++j;
 			t += dt;
 		} else {
-			uint32_t res = NERF_GRIDSIZE()>>mip;
-			t = advance_to_next_voxel(t, cone_angle, pos, ray.d, idir, res);
+			t = advance_to_next_voxel(t, cone_angle, pos, ray.d, idir, mip, 0, density_grid_distance);
 		}
 	}
 	if (max_level_rand_training) {
@@ -1134,6 +1208,26 @@ inline __device__ Array4f read_rgba(Vector2f pos, const Vector2i& resolution, ui
 	return read_val(idx);
 }
 
+__global__ void summarize_training_stats_nerf(
+	const uint32_t n_training_steps,
+	const uint32_t* __restrict__ counter,
+	const uint32_t* __restrict__ compacted_counter,
+	const float* __restrict__ loss_sum,
+	NerfTrainingStats* __restrict__ stats
+) {
+	NerfTrainingStats result = {0, 0, 0, *loss_sum};
+	for (uint32_t i = 0; i < n_training_steps; ++i) {
+		if (counter[i] == 0 || compacted_counter[i] == 0) {
+			++result.n_empty_steps;
+		}
+
+		result.n_samples_before_compaction += counter[i];
+		result.n_samples += compacted_counter[i];
+	}
+
+	*stats = result;
+}
+
 __global__ void compute_loss_kernel_train_nerf(
 	const uint32_t n_rays,
 	BoundingBox aabb,
@@ -1170,11 +1264,11 @@ __global__ void compute_loss_kernel_train_nerf(
 	ENerfActivation density_activation,
 	bool snap_to_pixel_centers,
 	float* __restrict__ error_map,
-	const float* __restrict__ cdf_x_cond_y,
-	const float* __restrict__ cdf_y,
-	const float* __restrict__ cdf_img,
+	const AliasEntry* __restrict__ alias_x_cond_y,
+	const AliasEntry* __restrict__ alias_y,
+	const AliasEntry* __restrict__ alias_img,
 	const Vector2i error_map_res,
-	const Vector2i error_map_cdf_res,
+	const Vector2i error_map_alias_res,
 	const float* __restrict__ sharpness_data,
 	Eigen::Vector2i sharpness_resolution,
 	float* __restrict__ sharpness_grid,
@@ -1231,10 +1325,10 @@ __global__ void compute_loss_kernel_train_nerf(
 	rng.advance(ray_idx * N_MAX_RANDOM_SAMPLES_PER_RAY());
 
 	float img_pdf = 1.0f;
-	uint32_t img = image_idx(ray_idx, n_rays, n_rays_total, n_training_images, cdf_img, &img_pdf);
+	uint32_t img = image_idx(ray_idx, n_rays, n_rays_total, n_training_images, alias_img, &img_pdf);
 
 	float xy_pdf = 1.0f;
-	Vector2f xy = nerf_random_image_pos_training(rng, resolution, snap_to_pixel_centers, cdf_x_cond_y, cdf_y, error_map_cdf_res, img, &xy_pdf);
+	Vector2f xy = nerf_random_image_pos_training(rng, resolution, snap_to_pixel_centers, alias_x_cond_y, alias_y, error_map_alias_res, img, &xy_pdf);
 	float max_level = max_level_rand_training ? (random_val(rng) * 2.0f) : 1.0f; // Multiply by 2 to ensure 50% of training is at max level
 
 	if (train_with_random_bg_color) {
@@ -1449,9 +1543,9 @@ __global__ void compute_cam_gradient_train_nerf(
 	float* __restrict__ distortion_gradient_weight,
 	const Vector2i distortion_resolution,
 	Vector2f* cam_focal_length_gradient,
-	const float* __restrict__ cdf_x_cond_y,
-	const float* __restrict__ cdf_y,
-	const float* __restrict__ cdf_img,
+	const AliasEntry* __restrict__ alias_x_cond_y,
+	const AliasEntry* __restrict__ alias_y,
+	const AliasEntry* __restrict__ alias_img,
 	const Vector2i error_map_res
 ) {
 	const uint32_t i = threadIdx.x + blockIdx.x * blockDim.x;
@@ -1471,7 +1565,7 @@ __global__ void compute_cam_gradient_train_nerf(
 	// Must be same seed as above to obtain the same
 	// background color.
 	uint32_t ray_idx = ray_indices_in[i];
-	uint32_t img = image_idx(ray_idx, n_rays, n_rays_total, n_training_images, cdf_img);
+	uint32_t img = image_idx(ray_idx, n_rays, n_rays_total, n_training_images, alias_img);
 
 	const Matrix<float, 3, 4>& xform = training_xforms[img];
 
@@ -1500,7 +1594,7 @@ __global__ void compute_cam_gradient_train_nerf(
 
 	rng.advance(ray_idx * N_MAX_RANDOM_SAMPLES_PER_RAY());
 	float xy_pdf = 1.0f;
-	Vector2f xy = nerf_random_image_pos_training(rng, resolution, snap_to_pixel_centers, cdf_x_cond_y, cdf_y, error_map_res, img, &xy_pdf);
+	Vector2f xy = nerf_random_image_pos_training(rng, resolution, snap_to_pixel_centers, alias_x_cond_y, alias_y, error_map_res, img, &xy_pdf);
 
 	if (distortion_gradient) {
 		// Rotate ray gradient to obtain image plane gradient.
@@ -1689,13 +1783,13 @@ __global__ void init_rays_with_payload_kernel_nerf(
 
 static constexpr float MIN_PDF = 0.01f;
 
-__global__ void construct_cdf_2d(
+__global__ void construct_alias_tables_x_cond_y(
 	uint32_t n_images,
 	uint32_t height,
 	uint32_t width,
 	const float* __restrict__ data,
-	float* __restrict__ cdf_x_cond_y,
-	float* __restrict__ cdf_y
+	AliasEntry* __restrict__ alias_x_cond_y,
+	float* __restrict__ row_sums
 ) {
 	const uint32_t y = threadIdx.x + blockIdx.x * blockDim.x;
 	const uint32_t img = threadIdx.y + blockIdx.y * blockDim.y;
@@ -1703,45 +1797,49 @@ __global__ void construct_cdf_2d(
 
 	const uint32_t offset_xy = img * height * width + y * width;
 	data += offset_xy;
-	cdf_x_cond_y += offset_xy;
+	alias_x_cond_y += offset_xy;
 
 	float cum = 0;
 	for (uint32_t x = 0; x < width; ++x) {
 		cum += data[x] + 1e-10f;
-		cdf_x_cond_y[x] = cum;
 	}
 
-	cdf_y[img * height + y] = cum;
+	row_sums[img * height + y] = cum;
 	float norm = __frcp_rn(cum);
 
 	for (uint32_t x = 0; x < width; ++x) {
-		cdf_x_cond_y[x] = (1.0f - MIN_PDF) * cdf_x_cond_y[x] * norm + MIN_PDF * (float)(x+1) / (float)width;
+		alias_x_cond_y[x].pmf = (1.0f - MIN_PDF) * (data[x] + 1e-10f) * norm + MIN_PDF / (float)width;
 	}
+
+	build_alias_table(alias_x_cond_y, width);
 }
 
-__global__ void construct_cdf_1d(
+__global__ void construct_alias_tables_y(
 	uint32_t n_images,
 	uint32_t height,
-	float* __restrict__ cdf_y,
-	float* __restrict__ cdf_img
+	const float* __restrict__ row_sums,
+	AliasEntry* __restrict__ alias_y,
+	float* __restrict__ image_sums
 ) {
 	const uint32_t img = threadIdx.x + blockIdx.x * blockDim.x;
 	if (img >= n_images) return;
 
-	cdf_y += img * height;
+	row_sums += img * height;
+	alias_y += img * height;
 
 	float cum = 0;
 	for (uint32_t y = 0; y < height; ++y) {
-		cum += cdf_y[y];
-		cdf_y[y] = cum;
+		cum += row_sums[y];
 	}
 
-	cdf_img[img] = cum;
+	image_sums[img] = cum;
 
 	float norm = __frcp_rn(cum);
 	for (uint32_t y = 0; y < height; ++y) {
-		cdf_y[y] = (1.0f - MIN_PDF) * cdf_y[y] * norm + MIN_PDF * (float)(y+1) / (float)height;
+		alias_y[y].pmf = (1.0f - MIN_PDF) * row_sums[y] * norm + MIN_PDF / (float)height;
 	}
+
+	build_alias_table(alias_y, height);
 }
 
 __global__ void safe_divide(const uint32_t num_elements, float* __restrict__ inout, const float* __restrict__ divisor) {
@@ -1771,6 +1869,7 @@ void Testbed::NerfTracer::init_rays_from_camera(
 	const Vector2i& distortion_resolution,
 	Eigen::Array4f* frame_buffer,
 	uint8_t *grid,
+	const uint8_t* grid_distance,
 	int show_accel,
 	float cone_angle_constant,
 	ERenderMode render_mode,
@@ -1815,6 +1914,7 @@ void Testbed::NerfTracer::init_rays_from_camera(
 		spp,
 		m_rays[0].payload,
 		grid,
+		grid_distance,
 		(show_accel >= 0) ? show_accel : 0,
 		cone_angle_constant
 	);
@@ -1829,6 +1929,7 @@ uint32_t Testbed::NerfTracer::trace(
 	const Vector2f& focal_length,
 	float cone_angle_constant,
 	const uint8_t* grid,
+	const uint8_t* grid_distance,
 	ERenderMode render_mode,
 	const Eigen::Matrix<float, 3, 4> &camera_matrix,
 	float depth_scale,
@@ -1886,6 +1987,7 @@ uint32_t Testbed::NerfTracer::trace(
 			m_network_input,
 			n_steps_between_compaction,
 			grid,
+			grid_distance,
 			(show_accel>=0) ? show_accel : 0,
 			cone_angle_constant
 		);
@@ -1990,6 +2092,7 @@ void Testbed::render_nerf(CudaRenderBuffer& render_buffer, const Vector2i& max_r
 		m_distortion.resolution,
 		render_buffer.frame_buffer(),
 		m_nerf.density_grid_bitfield.data(),
+		m_nerf.get_density_grid_distance(),
 		m_nerf.show_accel,
 		m_nerf.cone_angle_constant,
 		render_mode,
@@ -2010,6 +2113,7 @@ void Testbed::render_nerf(CudaRenderBuffer& render_buffer, const Vector2i& max_r
 			focal_length,
 			m_nerf.cone_angle_constant,
 			m_nerf.density_grid_bitfield.data(),
+			m_nerf.get_density_grid_distance(),
 			render_mode, camera_matrix1, depth_scale, m_visualized_layer, m_visualized_dimension,
 			m_nerf.rgb_activation, m_nerf.density_activation, m_nerf.show_accel, m_nerf.rendering_min_alpha,
 			stream
@@ -2077,19 +2181,51 @@ void Testbed::update_nerf_focal_lengths() {
 	m_nerf.training.focal_lengths_gpu.resize_and_copy_from_host(updated_focal_lengths);
 }
 
+CameraUndistortion Testbed::update_nerf_camera_undistortion() {
+	auto& training = m_nerf.training;
+	const CameraDistortion& distortion = training.dataset.camera_distortion;
+	if (distortion.is_zero() || !training.use_camera_undistortion_map) {
+		return distortion;
+	}
+
+	auto& map = training.camera_undistortion;
+	if (map.empty() || !std::equal(std::begin(distortion.params), std::end(distortion.params), std::begin(map.distortion.params))) {
+		ThreadPool pool;
+		map = build_camera_undistortion_map(distortion, training.dataset.principal_point, training.image_resolution, training.dataset.focal_lengths, pool);
+
+		// Normalized image coordinates are in units of the focal length
+		float max_focal_length = 0.0f;
+		for (const auto& focal_length : training.dataset.focal_lengths) {
+			max_focal_length = std::max(max_focal_length, focal_length.maxCoeff());
+		}
+
+		float max_error_px = map.max_error * max_focal_length;
+		if (max_error_px > 0.05f) {
+			tlog::warning() << "Camera undistortion map deviates by up to " << max_error_px << " pixels. Falling back to iterative undistortion.";
+			training.use_camera_undistortion_map = false;
+			map = {};
+			return distortion;
+		}
+
+		training.camera_undistortion_gpu.resize_and_copy_from_host(map.offsets);
+	}
+
+	return map.lookup(training.camera_undistortion_gpu.data());
+}
+
 void Testbed::update_nerf_transforms() {
 	m_nerf.training.transforms.resize(m_nerf.training.n_images);
 	for (uint32_t i = 0; i < m_nerf.training.n_images; ++i) {
 		auto xform = m_nerf.training.dataset.xforms[i];
 
-		Vector3f rot = m_nerf.training.cam_rot_offset[i].variable();
+		Vector3f rot = m_nerf.training.cam_rot_offset.variable<Vector3f>(i);
 		float angle = rot.norm();
 		rot /= angle;
 		if (angle > 0) {
 			xform.block<3,3>(0,0) = AngleAxisf(angle, rot) * xform.block<3,3>(0,0);
 		}
 
-		xform.col(3) += m_nerf.training.cam_pos_offset[i].variable();
+		xform.col(3) += m_nerf.training.cam_pos_offset.variable<Vector3f>(i);
 
 		m_nerf.training.transforms[i] = xform;
 	}
@@ -2127,11 +2263,14 @@ void Testbed::load_nerf() {
 	m_nerf.training.focal_lengths = m_nerf.training.dataset.focal_lengths;
 	m_nerf.training.focal_lengths_gpu.resize_and_copy_from_host(m_nerf.training.focal_lengths);
 
+	// Rebuilt for the new dataset on demand
+	m_nerf.training.camera_undistortion = {};
+
 	m_nerf.training.cam_pos_gradient.resize(m_nerf.training.n_images, Vector3f::Zero());
 	m_nerf.training.cam_pos_gradient_gpu.resize_and_copy_from_host(m_nerf.training.cam_pos_gradient);
 
-	m_nerf.training.cam_pos_offset.resize(m_nerf.training.n_images, AdamOptimizer<Vector3f>(1e-4f));
-	m_nerf.training.cam_rot_offset.resize(m_nerf.training.n_images, RotationAdamOptimizer(1e-4f));
+	m_nerf.training.cam_pos_offset.resize(m_nerf.training.n_images);
+	m_nerf.training.cam_rot_offset.resize(m_nerf.training.n_images);
 	m_nerf.training.cam_focal_length_offset = AdamOptimizer<Vector2f>(1e-4f);
 
 	m_nerf.training.cam_rot_gradient.resize(m_nerf.training.n_images, Vector3f::Zero());
@@ -2278,6 +2417,62 @@ void Testbed::update_density_grid_mean_and_bitfield(cudaStream_t stream) {
 	for (uint32_t level = 1; level < NERF_CASCADES(); ++level) {
 		linear_kernel(bitfield_max_pool, 0, stream, n_elements/64, m_nerf.get_density_grid_bitfield_mip(level-1), m_nerf.get_density_grid_bitfield_mip(level));
 	}
+
+	update_density_grid_distance(stream);
+}
+
+void Testbed::update_density_grid_distance(cudaStream_t stream) {
+	static_assert(OCCUPANCY_DISTANCE_GRIDSIZE == NERF_GRIDSIZE(), "The distance field must have the resolution of the density grid.");
+
+	const uint32_t n_elements = NERF_GRIDSIZE() * NERF_GRIDSIZE() * NERF_GRIDSIZE() * NERF_CASCADES();
+	const uint32_t n_slices = NERF_GRIDSIZE() * NERF_CASCADES();
+
+	// Only the slices whose bits changed since the previous update, and the slices within
+	// the maximum distance of them, are recomputed.
+	bool rebuild = m_nerf.density_grid_distance.size() < n_elements;
+	m_nerf.density_grid_distance.enlarge(n_elements);
+	m_nerf.density_grid_distance_xy.enlarge(n_elements);
+	m_nerf.density_grid_distance_bitfield.enlarge(n_elements/8);
+	m_nerf.density_grid_distance_dirty_slices.enlarge(n_slices);
+
+	if (rebuild) {
+		CUDA_CHECK_THROW(cudaMemsetAsync(m_nerf.density_grid_distance_dirty_slices.data(), 1, n_slices, stream));
+	} else {
+		CUDA_CHECK_THROW(cudaMemsetAsync(m_nerf.density_grid_distance_dirty_slices.data(), 0, n_slices, stream));
+		linear_kernel(mark_dirty_distance_slices, 0, stream, n_elements/8, m_nerf.density_grid_bitfield.data(), m_nerf.density_grid_distance_bitfield.data(), m_nerf.density_grid_distance_dirty_slices.data());
+	}
+
+	linear_kernel(occupancy_distance_rows, 0, stream, n_slices * NERF_GRIDSIZE(), m_nerf.density_grid_bitfield.data(), m_nerf.density_grid_distance_dirty_slices.data(), m_nerf.density_grid_distance.data());
+	linear_kernel(occupancy_distance_combine_y, 0, stream, n_elements, m_nerf.density_grid_distance_dirty_slices.data(), m_nerf.density_grid_distance.data(), m_nerf.density_grid_distance_xy.data());
+	linear_kernel(occupancy_distance_combine_z, 0, stream, n_elements, m_nerf.density_grid_distance_dirty_slices.data(), m_nerf.density_grid_distance_xy.data(), m_nerf.density_grid_distance.data());
+
+	CUDA_CHECK_THROW(cudaMemcpyAsync(m_nerf.density_grid_distance_bitfield.data(), m_nerf.density_grid_bitfield.data(), n_elements/8, cudaMemcpyDeviceToDevice, stream));
+}
+
+bool Testbed::defers_training_stats() const {
+	return m_testbed_mode == ETestbedMode::Nerf && m_nerf.training.deferred_stats_lag > 0;
+}
+
+bool Testbed::consume_nerf_training_stats(const NerfTrainingStats& stats, const NerfTrainingStatsContext& context) {
+	if (stats.n_empty_steps > 0) {
+		m_train = false;
+		tlog::warning() << "Nerf training generated 0 samples. Aborting training.";
+		return false;
+	}
+
+	m_nerf.training.measured_batch_size_before_compaction = stats.n_samples_before_compaction / context.n_training_steps;
+	m_nerf.training.measured_batch_size = stats.n_samples / context.n_training_steps;
+
+	m_loss_scalar = stats.loss_sum / (float)(context.n_training_steps);
+	m_loss_scalar *= (float)m_nerf.training.measured_batch_size / (float)context.target_batch_size;
+	update_loss_graph();
+
+	// Relate the measurement to the number of rays of the batches it was taken from, which differs from the
+	// current number of rays if the statistics were deferred.
+	auto& controller = m_nerf.training.batch_size_controller;
+	controller.measure(context.rays_per_batch, m_nerf.training.measured_batch_size);
+	m_nerf.training.rays_per_batch = controller.rays_per_batch(context.target_batch_size, m_nerf.training.rays_per_batch);
+	return true;
 }
 
 void Testbed::train_nerf(uint32_t target_batch_size, uint32_t n_training_steps, cudaStream_t stream) {
@@ -2337,86 +2532,90 @@ void Testbed::train_nerf(uint32_t target_batch_size, uint32_t n_training_steps,
 		m_envmap.trainer->optimizer_step(stream, LOSS_SCALE*(float)n_training_steps);
 	}
 
-	std::vector<uint32_t> counter_cpu(n_training_steps);
-	std::vector<uint32_t> compacted_counter_cpu(n_training_steps);
-	m_nerf.training.numsteps_counter.copy_to_host(counter_cpu, n_training_steps);
-	m_nerf.training.numsteps_counter_compacted.copy_to_host(compacted_counter_cpu, n_training_steps);
-
-	m_nerf.training.measured_batch_size = 0;
-	m_nerf.training.measured_batch_size_before_compaction = 0;
+	// Summarize the counters and the loss on the GPU, such that a single small readback suffices
+	uint32_t n_loss_elements = m_nerf.training.rays_per_batch * n_training_steps;
+	m_nerf.training.loss_sum.enlarge(reduce_sum_workspace_size(n_loss_elements));
+	m_nerf.training.stats.enlarge(1);
+	CUDA_CHECK_THROW(cudaMemsetAsync(m_nerf.training.loss_sum.data(), 0, sizeof(float), stream));
+	reduce_sum(m_nerf.training.loss.data(), [] __device__ (float val) { return val; }, m_nerf.training.loss_sum.data(), n_loss_elements, stream);
+	summarize_training_stats_nerf<<<1, 1, 0, stream>>>(n_training_steps, counter, compacted_counter, m_nerf.training.loss_sum.data(), m_nerf.training.stats.data());
+
+	NerfTrainingStatsContext context = {n_training_steps, m_nerf.training.rays_per_batch, target_batch_size};
+	auto& deferred_stats = m_nerf.training.deferred_stats;
+	if (defers_training_stats()) {
+		deferred_stats.set_capacity(m_nerf.training.deferred_stats_lag + 1);
+		deferred_stats.push(m_nerf.training.stats.data(), context, stream);
+
+		if (deferred_stats.n_pending() > m_nerf.training.deferred_stats_lag) {
+			NerfTrainingStats stats;
+			deferred_stats.pop(stats, context);
+			if (!consume_nerf_training_stats(stats, context)) {
+				return;
+			}
+		}
+	} else {
+		deferred_stats.set_capacity(0);
 
-	for (uint32_t i = 0; i < n_training_steps; ++i) {
-		if (counter_cpu[i] == 0 || compacted_counter_cpu[i] == 0) {
-			m_train = false;
-			tlog::warning() << "Nerf training generated 0 samples. Aborting training.";
+		std::vector<NerfTrainingStats> stats(1);
+		m_nerf.training.stats.copy_to_host(stats, 1);
+		if (!consume_nerf_training_stats(stats[0], context)) {
 			return;
 		}
-
-		m_nerf.training.measured_batch_size_before_compaction += counter_cpu[i];
-		m_nerf.training.measured_batch_size += compacted_counter_cpu[i];
 	}
 
-	m_nerf.training.measured_batch_size_before_compaction /= n_training_steps;
-	m_nerf.training.measured_batch_size /= n_training_steps;
-
-	m_loss_scalar = reduce_sum(m_nerf.training.loss.data(), m_nerf.training.rays_per_batch * n_training_steps, stream) / (float)(n_training_steps);
-	m_loss_scalar *= (float)m_nerf.training.measured_batch_size / (float)target_batch_size;
-	update_loss_graph();
-
-	m_nerf.training.rays_per_batch = (uint32_t)((float)m_nerf.training.rays_per_batch * (float)target_batch_size / (float)m_nerf.training.measured_batch_size);
-	m_nerf.training.rays_per_batch = std::min(next_multiple(m_nerf.training.rays_per_batch, BATCH_SIZE_MULTIPLE), 1u << 18);
-
 	// Compute CDFs from the error map
 	m_nerf.training.n_steps_since_error_map_update += n_training_steps;
 	// This is low-overhead enough to warrant always being on.
 	// It makes for useful visualizations of the training error.
 	bool accumulate_error = true;
 	if (accumulate_error && m_nerf.training.n_steps_since_error_map_update >= m_nerf.training.n_steps_between_error_map_updates) {
-		m_nerf.training.error_map.cdf_resolution = m_nerf.training.error_map.resolution;
-		m_nerf.training.error_map.cdf_x_cond_y.resize(m_nerf.training.error_map.cdf_resolution.prod() * m_nerf.training.dataset.n_images);
-		m_nerf.training.error_map.cdf_y.resize(m_nerf.training.error_map.cdf_resolution.y() * m_nerf.training.dataset.n_images);
-		m_nerf.training.error_map.cdf_img.resize(m_nerf.training.dataset.n_images);
-
-		CUDA_CHECK_THROW(cudaMemsetAsync(m_nerf.training.error_map.cdf_x_cond_y.data(), 0, m_nerf.training.error_map.cdf_x_cond_y.get_bytes(), stream));
-		CUDA_CHECK_THROW(cudaMemsetAsync(m_nerf.training.error_map.cdf_y.data(), 0, m_nerf.training.error_map.cdf_y.get_bytes(), stream));
-		CUDA_CHECK_THROW(cudaMemsetAsync(m_nerf.training.error_map.cdf_img.data(), 0, m_nerf.training.error_map.cdf_img.get_bytes(), stream));
-
+		auto& error_map = m_nerf.training.error_map;
+		error_map.alias_resolution = error_map.resolution;
+		error_map.alias_x_cond_y.resize(error_map.alias_resolution.prod() * m_nerf.training.dataset.n_images);
+		error_map.alias_y.resize(error_map.alias_resolution.y() * m_nerf.training.dataset.n_images);
+		error_map.alias_img.resize(m_nerf.training.dataset.n_images);
+		error_map.row_sums.resize(error_map.alias_resolution.y() * m_nerf.training.dataset.n_images);
+		error_map.image_sums.resize(m_nerf.training.dataset.n_images);
+
+		// One thread builds the alias table of each row and image in O(n)
 		const dim3 threads = { 16, 8, 1 };
-		const dim3 blocks = { div_round_up((uint32_t)m_nerf.training.error_map.cdf_resolution.y(), threads.x), div_round_up((uint32_t)m_nerf.training.dataset.n_images, threads.y), 1 };
-		construct_cdf_2d<<<blocks, threads, 0, stream>>>(
-			m_nerf.training.dataset.n_images, m_nerf.training.error_map.cdf_resolution.y(), m_nerf.training.error_map.cdf_resolution.x(),
-			m_nerf.training.error_map.data.data(),
-			m_nerf.training.error_map.cdf_x_cond_y.data(),
-			m_nerf.training.error_map.cdf_y.data()
+		const dim3 blocks = { div_round_up((uint32_t)error_map.alias_resolution.y(), threads.x), div_round_up((uint32_t)m_nerf.training.dataset.n_images, threads.y), 1 };
+		construct_alias_tables_x_cond_y<<<blocks, threads, 0, stream>>>(
+			m_nerf.training.dataset.n_images, error_map.alias_resolution.y(), error_map.alias_resolution.x(),
+			error_map.data.data(),
+			error_map.alias_x_cond_y.data(),
+			error_map.row_sums.data()
 		);
-		linear_kernel(construct_cdf_1d, 0, stream,
+		linear_kernel(construct_alias_tables_y, 0, stream,
 			m_nerf.training.dataset.n_images,
-			m_nerf.training.error_map.cdf_resolution.y(),
-			m_nerf.training.error_map.cdf_y.data(),
-			m_nerf.training.error_map.cdf_img.data()
+			error_map.alias_resolution.y(),
+			error_map.row_sums.data(),
+			error_map.alias_y.data(),
+			error_map.image_sums.data()
 		);
 
-		// Compute image CDF on the CPU. It's single-threaded anyway. No use parallelizing.
-		m_nerf.training.error_map.pmf_img_cpu.resize(m_nerf.training.error_map.cdf_img.size());
-		m_nerf.training.error_map.cdf_img.copy_to_host(m_nerf.training.error_map.pmf_img_cpu);
-		std::vector<float> cdf_img_cpu = m_nerf.training.error_map.pmf_img_cpu; // Copy unnormalized PDF into CDF buffer
+		// The image-level table is built on the CPU, which also needs the PMF for visualization.
+		error_map.pmf_img_cpu.resize(error_map.image_sums.size());
+		error_map.image_sums.copy_to_host(error_map.pmf_img_cpu);
 		float cum = 0;
-		for (float& f : cdf_img_cpu) {
+		for (float f : error_map.pmf_img_cpu) {
 			cum += f;
-			f = cum;
 		}
 		float norm = 1.0f / cum;
-		for (size_t i = 0; i < cdf_img_cpu.size(); ++i) {
+
+		std::vector<AliasEntry> alias_img_cpu(error_map.pmf_img_cpu.size());
+		for (size_t i = 0; i < alias_img_cpu.size(); ++i) {
 			constexpr float MIN_PMF = 0.1f;
-			m_nerf.training.error_map.pmf_img_cpu[i] = (1.0f - MIN_PMF) * m_nerf.training.error_map.pmf_img_cpu[i] * norm + MIN_PMF / (float)m_nerf.training.dataset.n_images;
-			cdf_img_cpu[i] = (1.0f - MIN_PMF) * cdf_img_cpu[i] * norm + MIN_PMF * (float)(i+1) / (float)m_nerf.training.dataset.n_images;
+			error_map.pmf_img_cpu[i] = (1.0f - MIN_PMF) * error_map.pmf_img_cpu[i] * norm + MIN_PMF / (float)m_nerf.training.dataset.n_images;
+			alias_img_cpu[i].pmf = error_map.pmf_img_cpu[i];
 		}
-		m_nerf.training.error_map.cdf_img.copy_from_host(cdf_img_cpu);
+		build_alias_table(alias_img_cpu.data(), (uint32_t)alias_img_cpu.size());
+		error_map.alias_img.copy_from_host(alias_img_cpu);
 
 		// Reset counters and decrease update rate.
 		m_nerf.training.n_steps_since_error_map_update = 0;
 		m_nerf.training.n_rays_since_error_map_update = 0;
-		m_nerf.training.error_map.is_cdf_valid = true;
+		m_nerf.training.error_map.is_alias_valid = true;
 
 		m_nerf.training.n_steps_between_error_map_updates = (uint32_t)(m_nerf.training.n_steps_between_error_map_updates * 1.5f);
 	}
@@ -2428,27 +2627,24 @@ void Testbed::train_nerf(uint32_t target_batch_size, uint32_t n_training_steps,
 	if (train_camera && m_nerf.training.n_steps_since_cam_update >= m_nerf.training.n_steps_between_cam_updates) {
 		float per_camera_loss_scale = (float)m_nerf.training.n_images / LOSS_SCALE / (float)m_nerf.training.n_steps_between_cam_updates;
 
+		if (!m_nerf.training.cam_update_pool) {
+			m_nerf.training.cam_update_pool = std::make_unique<ThreadPool>();
+		}
+
 		if (m_nerf.training.optimize_extrinsics) {
 			CUDA_CHECK_THROW(cudaMemcpyAsync(m_nerf.training.cam_pos_gradient.data(), m_nerf.training.cam_pos_gradient_gpu.data(), m_nerf.training.cam_pos_gradient_gpu.get_bytes(), cudaMemcpyDeviceToHost, stream));
 			CUDA_CHECK_THROW(cudaMemcpyAsync(m_nerf.training.cam_rot_gradient.data(), m_nerf.training.cam_rot_gradient_gpu.data(), m_nerf.training.cam_rot_gradient_gpu.get_bytes(), cudaMemcpyDeviceToHost, stream));
 
 			CUDA_CHECK_THROW(cudaStreamSynchronize(stream));
 
-			// Optimization step
-			for (uint32_t i = 0; i < m_nerf.training.n_images; ++i) {
-				Vector3f pos_gradient = m_nerf.training.cam_pos_gradient[i] * per_camera_loss_scale;
-				Vector3f rot_gradient = m_nerf.training.cam_rot_gradient[i] * per_camera_loss_scale;
-
-				float l2_reg = 0.01f;
-				pos_gradient += m_nerf.training.cam_pos_offset[i].variable() * l2_reg;
-				rot_gradient += m_nerf.training.cam_rot_offset[i].variable() * l2_reg;
-
-				m_nerf.training.cam_pos_offset[i].set_learning_rate(std::max(1e-3f * std::pow(0.33f, (float)(m_training_step / 2048)), m_optimizer->learning_rate()/1000.0f));
-				m_nerf.training.cam_rot_offset[i].set_learning_rate(std::max(1e-3f * std::pow(0.33f, (float)(m_training_step / 2048)), m_optimizer->learning_rate()/1000.0f));
+			// Optimization step of all cameras at once
+			float l2_reg = 0.01f;
+			float learning_rate = std::max(1e-3f * std::pow(0.33f, (float)(m_training_step / 2048)), m_optimizer->learning_rate()/1000.0f);
+			m_nerf.training.cam_pos_offset.set_learning_rate(learning_rate);
+			m_nerf.training.cam_rot_offset.set_learning_rate(learning_rate);
 
-				m_nerf.training.cam_pos_offset[i].step(pos_gradient);
-				m_nerf.training.cam_rot_offset[i].step(rot_gradient);
-			}
+			m_nerf.training.cam_pos_offset.step((const float*)m_nerf.training.cam_pos_gradient.data(), per_camera_loss_scale, l2_reg, m_nerf.training.cam_update_pool.get());
+			m_nerf.training.cam_rot_offset.step((const float*)m_nerf.training.cam_rot_gradient.data(), per_camera_loss_scale, l2_reg, m_nerf.training.cam_update_pool.get());
 
 			update_nerf_transforms();
 		}
@@ -2476,19 +2672,14 @@ void Testbed::train_nerf(uint32_t target_batch_size, uint32_t n_training_steps,
 		if (m_nerf.training.optimize_exposure) {
 			CUDA_CHECK_THROW(cudaMemcpyAsync(m_nerf.training.cam_exposure_gradient.data(), m_nerf.training.cam_exposure_gradient_gpu.data(), m_nerf.training.cam_exposure_gradient_gpu.get_bytes(), cudaMemcpyDeviceToHost, stream));
 
-			Array3f mean_exposure = Array3f::Constant(0.0f);
+			// Optimization step of all cameras at once
+			float l2_reg = 0.00f;
+			m_nerf.training.cam_exposure.set_learning_rate(m_optimizer->learning_rate());
+			m_nerf.training.cam_exposure.step((const float*)m_nerf.training.cam_exposure_gradient.data(), per_camera_loss_scale, l2_reg, m_nerf.training.cam_update_pool.get());
 
-			// Optimization step
+			Array3f mean_exposure = Array3f::Constant(0.0f);
 			for (uint32_t i = 0; i < m_nerf.training.n_images; ++i) {
-				Array3f gradient = m_nerf.training.cam_exposure_gradient[i] * per_camera_loss_scale;
-
-				float l2_reg = 0.00f;
-				gradient += m_nerf.training.cam_exposure[i].variable() * l2_reg;
-
-				m_nerf.training.cam_exposure[i].set_learning_rate(m_optimizer->learning_rate());
-				m_nerf.training.cam_exposure[i].step(gradient);
-
-				mean_exposure += m_nerf.training.cam_exposure[i].variable();
+				mean_exposure += m_nerf.training.cam_exposure.variable<Array3f>(i);
 			}
 
 			mean_exposure /= m_nerf.training.n_images;
@@ -2496,7 +2687,8 @@ void Testbed::train_nerf(uint32_t target_batch_size, uint32_t n_training_steps,
 			// Renormalize
 			std::vector<Array3f> cam_exposures(m_nerf.training.n_images);
 			for (uint32_t i = 0; i < m_nerf.training.n_images; ++i) {
-				cam_exposures[i] = m_nerf.training.cam_exposure[i].variable() -= mean_exposure;
+				cam_exposures[i] = m_nerf.training.cam_exposure.variable<Array3f>(i) - mean_exposure;
+				m_nerf.training.cam_exposure.set_variable(i, cam_exposures[i]);
 			}
 
 			CUDA_CHECK_THROW(cudaMemcpyAsync(m_nerf.training.cam_exposure_gpu.data(), cam_exposures.data(), m_nerf.training.cam_exposure_gpu.get_bytes(), cudaMemcpyHostToDevice, stream));
@@ -2579,8 +2771,8 @@ void Testbed::train_nerf_step(uint32_t target_batch_size, uint32_t n_rays_per_ba
 	// If we have an envmap, prepare its gradient buffer
 	float* envmap_gradient = m_nerf.training.train_envmap ? m_envmap.envmap->gradients() : nullptr;
 
-	bool sample_focal_plane_proportional_to_error = m_nerf.training.error_map.is_cdf_valid && m_nerf.training.sample_focal_plane_proportional_to_error;
-	bool sample_image_proportional_to_error = m_nerf.training.error_map.is_cdf_valid && m_nerf.training.sample_image_proportional_to_error;
+	bool sample_focal_plane_proportional_to_error = m_nerf.training.error_map.is_alias_valid && m_nerf.training.sample_focal_plane_proportional_to_error;
+	bool sample_image_proportional_to_error = m_nerf.training.error_map.is_alias_valid && m_nerf.training.sample_image_proportional_to_error;
 	bool include_sharpness_in_error = m_nerf.training.include_sharpness_in_error;
 	// This is low-overhead enough to warrant always being on.
 	// It makes for useful visualizations of the training error.
@@ -2606,8 +2798,9 @@ void Testbed::train_nerf_step(uint32_t target_batch_size, uint32_t n_rays_per_ba
 		m_nerf.training.dataset.principal_point,
 		m_nerf.training.focal_lengths_gpu.data(),
 		m_nerf.training.transforms_gpu.data(),
-		m_nerf.training.dataset.camera_distortion,
+		update_nerf_camera_undistortion(),
 		m_nerf.density_grid_bitfield.data(),
+		m_nerf.get_density_grid_distance(),
 		m_max_level_rand_training,
 		max_level,
 		m_nerf.training.snap_to_pixel_centers,
@@ -2615,10 +2808,10 @@ void Testbed::train_nerf_step(uint32_t target_batch_size, uint32_t n_rays_per_ba
 		m_nerf.cone_angle_constant,
 		m_distortion.map->params(),
 		m_distortion.resolution,
-		sample_focal_plane_proportional_to_error ? m_nerf.training.error_map.cdf_x_cond_y.data() : nullptr,
-		sample_focal_plane_proportional_to_error ? m_nerf.training.error_map.cdf_y.data() : nullptr,
-		sample_image_proportional_to_error ? m_nerf.training.error_map.cdf_img.data() : nullptr,
-		m_nerf.training.error_map.cdf_resolution,
+		sample_focal_plane_proportional_to_error ? m_nerf.training.error_map.alias_x_cond_y.data() : nullptr,
+		sample_focal_plane_proportional_to_error ? m_nerf.training.error_map.alias_y.data() : nullptr,
+		sample_image_proportional_to_error ? m_nerf.training.error_map.alias_img.data() : nullptr,
+		m_nerf.training.error_map.alias_resolution,
 		m_nerf.training.near_distance,
 		m_nerf.training.dataset.images_data.data()
 	);
@@ -2674,11 +2867,11 @@ void Testbed::train_nerf_step(uint32_t target_batch_size, uint32_t n_rays_per_ba
 		m_nerf.density_activation,
 		m_nerf.training.snap_to_pixel_centers,
 		accumulate_error ? m_nerf.training.error_map.data.data() : nullptr,
-		sample_focal_plane_proportional_to_error ? m_nerf.training.error_map.cdf_x_cond_y.data() : nullptr,
-		sample_focal_plane_proportional_to_error ? m_nerf.training.error_map.cdf_y.data() : nullptr,
-		sample_image_proportional_to_error ? m_nerf.training.error_map.cdf_img.data() : nullptr,
+		sample_focal_plane_proportional_to_error ? m_nerf.training.error_map.alias_x_cond_y.data() : nullptr,
+		sample_focal_plane_proportional_to_error ? m_nerf.training.error_map.alias_y.data() : nullptr,
+		sample_image_proportional_to_error ? m_nerf.training.error_map.alias_img.data() : nullptr,
 		m_nerf.training.error_map.resolution,
-		m_nerf.training.error_map.cdf_resolution,
+		m_nerf.training.error_map.alias_resolution,
 		include_sharpness_in_error ? m_nerf.training.dataset.sharpness_data.data() : nullptr,
 		m_nerf.training.dataset.sharpness_resolution,
 		m_nerf.training.sharpness_grid.data(),
@@ -2727,10 +2920,10 @@ void Testbed::train_nerf_step(uint32_t target_batch_size, uint32_t n_rays_per_ba
 			m_nerf.training.optimize_distortion ? m_distortion.map->gradient_weights() : nullptr,
 			m_distortion.resolution,
 			m_nerf.training.optimize_focal_length ? m_nerf.training.cam_focal_length_gradient_gpu.data() : nullptr,
-			sample_focal_plane_proportional_to_error ? m_nerf.training.error_map.cdf_x_cond_y.data() : nullptr,
-			sample_focal_plane_proportional_to_error ? m_nerf.training.error_map.cdf_y.data() : nullptr,
-			sample_image_proportional_to_error ? m_nerf.training.error_map.cdf_img.data() : nullptr,
-			m_nerf.training.error_map.cdf_resolution
+			sample_focal_plane_proportional_to_error ? m_nerf.training.error_map.alias_x_cond_y.data() : nullptr,
+			sample_focal_plane_proportional_to_error ? m_nerf.training.error_map.alias_y.data() : nullptr,
+			sample_image_proportional_to_error ? m_nerf.training.error_map.alias_img.data() : nullptr,
+			m_nerf.training.error_map.alias_resolution
 		);
 	}
 
@@ -2915,6 +3108,10 @@ uint8_t* Testbed::Nerf::get_density_grid_bitfield_mip(uint32_t mip) {
 	return density_grid_bitfield.data() + grid_mip_offset(mip)/8;
 }
 
+const uint8_t* Testbed::Nerf::get_density_grid_distance() {
+	return skip_empty_space && density_grid_distance.size() > 0 ? density_grid_distance.data() : nullptr;
+}
+
 int Testbed::find_best_training_view(int default_view) {
 	int bestimage=default_view;
 	float bestscore=1000.f;
@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+/** @file   training_session.cu
+ *  @author Thomas Müller, NVIDIA
+ */
+
+#include <neural-graphics-primitives/testbed.h>
+#include <neural-graphics-primitives/training_session.h>
+
+#include <chrono>
+
+NGP_NAMESPACE_BEGIN
+
+namespace {
+
+std::string replace_step(std::string path, uint32_t step) {
+	static const std::string placeholder = "{step}";
+	size_t pos = path.find(placeholder);
+	if (pos != std::string::npos) {
+		path.replace(pos, placeholder.size(), std::to_string(step));
+	}
+	return path;
+}
+
+}
+
+TrainingSession::TrainingSession(Testbed& testbed, uint32_t batch_size, uint32_t steps_per_call)
+: m_testbed{testbed}, m_batch_size{batch_size}, m_steps_per_call{std::max(steps_per_call, 1u)} {
+	m_training_step = m_testbed.m_training_step;
+	m_loss = m_testbed.m_loss_scalar;
+}
+
+TrainingSession::~TrainingSession() {
+	stop();
+
+	try {
+		wait();
+	} catch (const std::exception& e) {
+		tlog::error() << "Training session ended with an error: " << e.what();
+	}
+
+	m_hook_thread.waitUntilFinished();
+}
+
+void TrainingSession::start(uint32_t n_steps) {
+	if (m_thread.joinable()) {
+		if (m_running) {
+			throw std::runtime_error{"TrainingSession: training is already running."};
+		}
+
+		m_thread.join();
+	}
+
+	if (!m_testbed.m_training_data_available) {
+		throw std::runtime_error{"TrainingSession: the testbed has no training data."};
+	}
+
+	m_exception = nullptr;
+	m_stop = false;
+	m_running = true;
+
+	// CUDA selects the device per thread; train on the one that is current for the caller.
+	int device;
+	CUDA_CHECK_THROW(cudaGetDevice(&device));
+
+	m_thread = std::thread{[this, n_steps, device]() {
+		try {
+			training_loop(n_steps, device);
+		} catch (...) {
+			m_exception = std::current_exception();
+		}
+
+		m_running = false;
+	}};
+}
+
+void TrainingSession::stop() {
+	m_stop = true;
+
+	{
+		std::lock_guard<std::mutex> lock{m_testbed_mutex};
+		m_pause_condition.notify_all();
+	}
+
+	if (m_thread.joinable()) {
+		m_thread.join();
+	}
+}
+
+void TrainingSession::wait() {
+	if (m_thread.joinable()) {
+		m_thread.join();
+	}
+
+	if (m_exception) {
+		auto exception = m_exception;
+		m_exception = nullptr;
+		std::rethrow_exception(exception);
+	}
+}
+
+bool TrainingSession::poll() {
+	if (m_running) {
+		return true;
+	}
+
+	wait();
+	return false;
+}
+
+void TrainingSession::pause() {
+	std::lock_guard<std::mutex> lock{m_testbed_mutex};
+	++m_n_pauses;
+}
+
+void TrainingSession::resume() {
+	std::lock_guard<std::mutex> lock{m_testbed_mutex};
+	if (m_n_pauses == 0) {
+		throw std::runtime_error{"TrainingSession: resume() without matching pause()."};
+	}
+
+	if (--m_n_pauses == 0) {
+		m_pause_condition.notify_all();
+	}
+}
+
+void TrainingSession::set_snapshot(const std::string& path, uint32_t interval) {
+	std::lock_guard<std::mutex> lock{m_settings_mutex};
+	m_snapshot_path = path;
+	m_snapshot_interval = path.empty() ? 0 : interval;
+}
+
+void TrainingSession::set_hook(const hook_t& hook, uint32_t interval) {
+	std::lock_guard<std::mutex> lock{m_settings_mutex};
+	m_hook = hook ? std::make_shared<hook_t>(hook) : nullptr;
+	m_hook_interval = hook ? interval : 0;
+}
+
+void TrainingSession::training_loop(uint32_t n_steps, int device) {
+	CUDA_CHECK_THROW(cudaSetDevice(device));
+
+	const uint32_t first_step = m_testbed.m_training_step;
+	uint32_t last_snapshot_step = first_step;
+	uint32_t last_hook_step = first_step;
+
+	auto start = std::chrono::steady_clock::now();
+
+	while (!m_stop && (n_steps == 0 || m_training_step - first_step < n_steps)) {
+		std::string snapshot_path;
+		// Held by pointer such that the training thread never copies or destroys the hook itself,
+		// which might require acquiring resources (e.g. the GIL) of whoever provided it.
+		std::shared_ptr<hook_t> hook;
+
+		{
+			std::unique_lock<std::mutex> lock{m_testbed_mutex};
+			m_pause_condition.wait(lock, [this]() { return m_n_pauses == 0 || m_stop; });
+			if (m_stop) {
+				break;
+			}
+
+			uint32_t n_steps_this_call = m_steps_per_call;
+			if (n_steps > 0) {
+				n_steps_this_call = std::min(n_steps_this_call, n_steps - (m_training_step - first_step));
+			}
+
+			m_testbed.train(n_steps_this_call, m_batch_size);
+			if (!m_testbed.m_training_data_available) {
+				throw std::runtime_error{"TrainingSession: the testbed has no training data."};
+			}
+
+			m_training_step = m_testbed.m_training_step;
+			m_loss = m_testbed.m_loss_scalar;
+
+			uint32_t step = m_training_step;
+
+			{
+				std::lock_guard<std::mutex> settings_lock{m_settings_mutex};
+				if (m_snapshot_interval > 0 && step - last_snapshot_step >= m_snapshot_interval) {
+					snapshot_path = replace_step(m_snapshot_path, step);
+					last_snapshot_step = step;
+				}
+
+				if (m_hook_interval > 0 && step - last_hook_step >= m_hook_interval) {
+					if (m_hook_pending.exchange(true)) {
+						++m_n_skipped_hooks;
+					} else {
+						hook = m_hook;
+					}
+					last_hook_step = step;
+				}
+			}
+
+			if (!snapshot_path.empty()) {
+				m_testbed.save_snapshot(snapshot_path, false);
+			}
+		}
+
+		m_steps_per_second = (float)(m_training_step - first_step) / std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+
+		if (hook) {
+			uint32_t step = m_training_step;
+			float loss = m_loss;
+			m_hook_thread.enqueueTask([this, hook{std::move(hook)}, step, loss]() mutable {
+				try {
+					(*hook)(step, loss);
+				} catch (const std::exception& e) {
+					tlog::error() << "Training hook failed at step " << step << ": " << e.what();
+				}
+
+				hook.reset();
+				m_hook_pending = false;
+			});
+		}
+	}
+}
+
+NGP_NAMESPACE_END
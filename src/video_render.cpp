@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+/** @file   video_render.cpp
+ *  @author Thomas Müller, NVIDIA
+ */
+
+#include <neural-graphics-primitives/tinyexr_wrapper.h>
+#include <neural-graphics-primitives/video_render.h>
+
+#include <stb_image/stb_image_write.h>
+
+#include <filesystem/path.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <memory>
+
+using namespace Eigen;
+
+NGP_NAMESPACE_BEGIN
+
+namespace {
+
+inline float linear_to_srgb(float linear) {
+	if (linear < 0.0031308f) {
+		return 12.92f * linear;
+	} else {
+		return 1.055f * std::pow(linear, 0.41666f) - 0.055f;
+	}
+}
+
+inline uint8_t to_uint8(float val) {
+	return (uint8_t)std::min(std::max(val * 255.0f + 0.5f, 0.0f), 255.0f);
+}
+
+bool is_exr(const std::string& path) {
+	std::string extension = filesystem::path{path}.extension();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+	return extension == "exr";
+}
+
+}
+
+std::string video_frame_path(const std::string& pattern, uint32_t frame) {
+	int n = snprintf(nullptr, 0, pattern.c_str(), frame);
+	if (n < 0) {
+		throw std::runtime_error{"Invalid frame path pattern \"" + pattern + "\"."};
+	}
+
+	std::string result(n, '\0');
+	snprintf(&result[0], n + 1, pattern.c_str(), frame);
+	return result;
+}
+
+std::vector<uint8_t> linear_to_srgb8(const float* rgba, size_t n_pixels) {
+	std::vector<uint8_t> pixels(n_pixels * 4);
+	for (size_t i = 0; i < n_pixels; ++i) {
+		const float* src = rgba + i * 4;
+		uint8_t* dst = pixels.data() + i * 4;
+
+		float alpha = src[3];
+		for (int c = 0; c < 3; ++c) {
+			dst[c] = to_uint8(alpha != 0 ? linear_to_srgb(src[c] / alpha) : 0.0f);
+		}
+		dst[3] = to_uint8(alpha);
+	}
+
+	return pixels;
+}
+
+void write_video_frame(const std::string& path, const float* rgba, const Vector2i& resolution) {
+	if (is_exr(path)) {
+		save_exr(rgba, resolution.x(), resolution.y(), 4, 4, path.c_str());
+		return;
+	}
+
+	std::vector<uint8_t> pixels = linear_to_srgb8(rgba, (size_t)resolution.x() * resolution.y());
+	if (!stbi_write_png(path.c_str(), resolution.x(), resolution.y(), 4, pixels.data(), resolution.x() * 4)) {
+		throw std::runtime_error{"Failed to write frame \"" + path + "\"."};
+	}
+}
+
+VideoRenderStats render_video(
+	const VideoRenderSettings& settings,
+	ThreadPool& pool,
+	const std::function<void(const VideoFrame&, uint32_t)>& render_frame,
+	const std::function<void(const VideoFrame&, uint32_t, float*)>& read_back
+) {
+	if (settings.resolution.x() <= 0 || settings.resolution.y() <= 0) {
+		throw std::runtime_error{"Video render: invalid resolution."};
+	}
+
+	if (settings.spp == 0) {
+		throw std::runtime_error{"Video render: spp must be at least 1."};
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	const uint32_t queue_depth = std::max(settings.queue_depth, 1u);
+	const size_t n_floats = (size_t)settings.resolution.x() * settings.resolution.y() * 4;
+
+	// Queue entries are allocated on first use, such that short videos do not pay for the full queue.
+	std::vector<std::vector<float>> frame_buffers(queue_depth);
+	std::vector<std::future<float>> encodes(queue_depth);
+	std::future<void> read_backs[VIDEO_RENDER_N_SLOTS];
+
+	// Pending tasks reference this stack frame; wait for them even if rendering throws.
+	ScopeGuard pending_guard{[&]() {
+		for (auto& f : read_backs) {
+			if (f.valid()) {
+				f.wait();
+			}
+		}
+
+		for (auto& f : encodes) {
+			if (f.valid()) {
+				f.wait();
+			}
+		}
+	}};
+
+	VideoRenderStats stats;
+	auto progress = tlog::progress(settings.n_frames);
+
+	for (uint32_t i = 0; i < settings.n_frames; ++i) {
+		VideoFrame frame;
+		frame.index = i;
+		frame.start_time = (float)i / settings.n_frames;
+		frame.end_time = (float)(i + 1) / settings.n_frames;
+
+		uint32_t slot = i % VIDEO_RENDER_N_SLOTS;
+		uint32_t entry = i % queue_depth;
+
+		// The slot is free once the frame that was last rendered into it has been read back and the queue
+		// entry is free once its frame was written. Retrieving the results rethrows errors of the workers.
+		auto stall_start = std::chrono::steady_clock::now();
+		if (read_backs[slot].valid()) {
+			read_backs[slot].get();
+		}
+
+		if (encodes[entry].valid()) {
+			stats.encode_milliseconds += encodes[entry].get();
+			progress.update(++stats.n_frames);
+		}
+
+		auto render_start = std::chrono::steady_clock::now();
+		stats.stall_milliseconds += std::chrono::duration<float, std::milli>(render_start - stall_start).count();
+
+		render_frame(frame, slot);
+
+		stats.render_milliseconds += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - render_start).count();
+
+		frame_buffers[entry].resize(n_floats);
+		float* dst = frame_buffers[entry].data();
+
+		auto read_back_done = std::make_shared<std::promise<void>>();
+		read_backs[slot] = read_back_done->get_future();
+
+		encodes[entry] = pool.enqueueTask([&settings, &read_back, frame, slot, dst, read_back_done]() {
+			auto encode_start = std::chrono::steady_clock::now();
+
+			try {
+				read_back(frame, slot, dst);
+			} catch (...) {
+				read_back_done->set_exception(std::current_exception());
+				throw;
+			}
+
+			read_back_done->set_value();
+
+			write_video_frame(video_frame_path(settings.output_pattern, frame.index), dst, settings.resolution);
+			return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - encode_start).count();
+		});
+	}
+
+	for (uint32_t i = 0; i < queue_depth; ++i) {
+		// Retrieve in frame order such that progress is reported monotonically.
+		auto& f = encodes[(settings.n_frames + i) % queue_depth];
+		if (f.valid()) {
+			stats.encode_milliseconds += f.get();
+			progress.update(++stats.n_frames);
+		}
+	}
+
+	stats.total_milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return stats;
+}
+
+NGP_NAMESPACE_END